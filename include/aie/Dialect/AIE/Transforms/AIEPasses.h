@@ -23,11 +23,15 @@ namespace xilinx::AIE {
 
 std::unique_ptr<mlir::OperationPass<DeviceOp>>
 createAIEAssignBufferAddressesPass();
+std::unique_ptr<mlir::OperationPass<DeviceOp>>
+createAIEAssignBufferAddressesPass(const std::string &allocScheme);
 std::unique_ptr<mlir::OperationPass<DeviceOp>> createAIEAssignLockIDsPass();
 std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
 createAIECanonicalizeDevicePass();
 std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
 createAIECoreToStandardPass();
+std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>>
+createAIECoreToStandardPass(int tileCol, int tileRow);
 std::unique_ptr<mlir::OperationPass<DeviceOp>> createAIEFindFlowsPass();
 std::unique_ptr<mlir::OperationPass<DeviceOp>> createAIELocalizeLocksPass();
 std::unique_ptr<mlir::OperationPass<DeviceOp>>
@@ -38,9 +42,15 @@ std::unique_ptr<mlir::OperationPass<mlir::func::FuncOp>>
 createAIEVectorOptPass();
 std::unique_ptr<mlir::OperationPass<DeviceOp>> createAIEPathfinderPass();
 std::unique_ptr<mlir::OperationPass<DeviceOp>>
+createAIEPathfinderPass(const std::string &routingCacheDir);
+std::unique_ptr<mlir::OperationPass<DeviceOp>>
 createAIEObjectFifoStatefulTransformPass();
 std::unique_ptr<mlir::OperationPass<DeviceOp>>
+createAIEObjectFifoStatefulTransformPass(bool emitBankConflicts);
+std::unique_ptr<mlir::OperationPass<DeviceOp>>
 createAIEObjectFifoRegisterProcessPass();
+std::unique_ptr<mlir::OperationPass<DeviceOp>>
+createAIEObjectFifoDepthAnalysisPass();
 
 /// Generate the code for registering passes.
 #define GEN_PASS_REGISTRATION
@@ -58,10 +68,13 @@ createAIEObjectFifoRegisterProcessPass();
 struct AIEPathfinderPass : AIERoutePathfinderFlowsBase<AIEPathfinderPass> {
 
   DynamicTileAnalysis analyzer;
+  // Set when the analyzer was given a router other than Pathfinder, which is
+  // then not configured from the pass options.
+  bool hasCustomRouter = false;
 
   AIEPathfinderPass() = default;
   AIEPathfinderPass(DynamicTileAnalysis analyzer)
-      : analyzer(std::move(analyzer)) {}
+      : analyzer(std::move(analyzer)), hasCustomRouter(true) {}
 
   void runOnOperation() override;
 
@@ -65,6 +65,9 @@ using Channel = struct Channel {
   int usedCapacity = 0; // how many flows are actually using this Channel
   std::set<int> fixedCapacity; // channels not available to the algorithm
   int overCapacityCount = 0;   // history of Channel being over capacity
+  std::set<int> usedChannels;  // channels held by flows (incremental routing)
+  // packet IDs of the packet-switched flows sharing each channel
+  std::map<int, std::vector<int>> packetFlows;
 };
 
 struct SwitchboxNode;
@@ -184,6 +187,60 @@ using PathEndPointNode = struct PathEndPointNode : PathEndPoint {
 using FlowNode = struct FlowNode {
   PathEndPointNode src;
   std::vector<PathEndPointNode> dsts;
+  // relative bandwidth hint; hotter flows are routed first and pay more for
+  // every hop
+  int bandwidth = 1;
+  // packet-switched flows share channels with other packet-switched flows,
+  // told apart by their packet ID
+  std::optional<int> packetID;
+};
+
+// Knobs for the Pathfinder router. The defaults give the original
+// negotiated-congestion algorithm.
+using PathfinderOptions = struct PathfinderOptions {
+  // Route a flow with fanout as a tree: each destination is connected to the
+  // part of the tree routed so far, which acts as a zero-cost source, instead
+  // of being traced back to the flow source independently.
+  bool fanoutAware = false;
+  // After the first iteration, only rip up and reroute the flows that use an
+  // over-capacity channel, keeping the rest of the solution in place.
+  bool incremental = false;
+  // When non-zero, route flows in batches of this size: the shortest path
+  // searches of a batch run concurrently on the thread pool of context
+  // against the demand left by the previous batches, then the flows claim
+  // their channels in order. The result does not depend on the thread count.
+  size_t parallelBatchSize = 0;
+  mlir::MLIRContext *context = nullptr;
+  // Use A* search, guided by the Manhattan distance to the destinations, for
+  // flows with at most this many destinations (0 disables A*).
+  size_t aStarMaxDestinations = 0;
+  // When the flows cannot all be routed on dedicated circuits, route the
+  // congested circuit-switched flows with the lowest bandwidth hint as
+  // packet-switched flows with these packet IDs, and try again, until the
+  // flows fit or the IDs run out.
+  std::vector<int> packetFallbackIDs;
+  // The sources whose flows can be demoted: DMA channels whose BDs can be
+  // given a packet header. Flows from any other source keep their circuit.
+  std::set<PathEndPoint> packetFallbackSources;
+  // Demote flows once this many iterations in a row have not reduced the
+  // total overuse of the channels, instead of after maxIterations.
+  int packetFallbackStallIterations = 8;
+};
+
+// Figures describing the routing found by the last call to
+// Pathfinder::findPaths.
+using PathfinderStats = struct PathfinderStats {
+  int iterations = 0;
+  int dijkstraCalls = 0;
+  // switchboxes taken off the queue by all shortest path searches
+  int nodesExpanded = 0;
+  // switchbox-to-switchbox channels used by the routing
+  int channelsUsed = 0;
+  // channels the routing would use if every destination of a flow were
+  // connected to the source through a single shortest-path tree
+  int sourceRootedChannelsUsed = 0;
+  // circuit-switched flows routed as packet-switched flows instead
+  int flowsDemoted = 0;
 };
 
 class Router {
@@ -195,7 +252,13 @@ public:
   virtual void initialize(int maxCol, int maxRow,
                           const AIETargetModel &targetModel) = 0;
   virtual void addFlow(TileID srcCoords, Port srcPort, TileID dstCoords,
-                       Port dstPort) = 0;
+                       Port dstPort, int bandwidth) = 0;
+  // Add a packet-switched flow, to be routed together with the others.
+  // Returns false if the router does not support packet-switched flows.
+  virtual bool addPacketFlow(TileID srcCoords, Port srcPort, TileID dstCoords,
+                             Port dstPort, int packetID) {
+    return false;
+  }
   virtual bool addFixedConnection(ConnectOp connectOp) = 0;
   virtual std::optional<std::map<PathEndPoint, SwitchSettings>>
   findPaths(int maxIterations) = 0;
@@ -205,29 +268,104 @@ public:
 class Pathfinder : public Router {
 public:
   Pathfinder() = default;
+  explicit Pathfinder(PathfinderOptions options) : options(options) {}
   void initialize(int maxCol, int maxRow,
                   const AIETargetModel &targetModel) override;
   void addFlow(TileID srcCoords, Port srcPort, TileID dstCoords,
-               Port dstPort) override;
+               Port dstPort, int bandwidth) override;
+  // Up to MAX_PACKET_FLOWS_PER_CHANNEL packet flows with different IDs share
+  // each channel they use.
+  bool addPacketFlow(TileID srcCoords, Port srcPort, TileID dstCoords,
+                     Port dstPort, int packetID) override;
   bool addFixedConnection(ConnectOp connectOp) override;
   std::optional<std::map<PathEndPoint, SwitchSettings>>
   findPaths(int maxIterations) override;
 
   Switchbox *getSwitchbox(TileID coords) override {
-    auto *sb = std::find_if(graph.begin(), graph.end(), [&](SwitchboxNode *sb) {
-      return sb->col == coords.col && sb->row == coords.row;
-    });
-    assert(sb != graph.end() && "couldn't find sb");
-    return *sb;
+    auto sb = grid.find(coords);
+    assert(sb != grid.end() && "couldn't find sb");
+    return &sb->second;
+  }
+
+  const PathfinderStats &getStats() const { return stats; }
+  const PathfinderOptions &getOptions() const { return options; }
+
+  // The routes of the packet-switched flows found by the last call to
+  // findPaths, by source and packet ID. findPaths only returns the others.
+  const std::map<std::pair<PathEndPoint, int>, SwitchSettings> &
+  getPacketFlowSolutions() const {
+    return packetFlowSolutions;
+  }
+
+  // The sources of the congested flows that the last call to findPaths could
+  // not demote because they are not in packetFallbackSources.
+  const std::set<PathEndPoint> &getUndemotableSources() const {
+    return undemotableSources;
   }
 
 private:
+  // What a flow holds once routed.
+  using FlowRoute = struct FlowRoute {
+    SwitchSettings switchSettings;
+    // (channel, index within the channel) pairs claimed by the flow
+    std::vector<std::pair<ChannelEdge *, int>> channels;
+    // channels a source-rooted routing of the flow would use
+    int sourceRootedChannels = 0;
+  };
+
+  // The channels a flow's route traverses, as found by the shortest path
+  // search: for each destination (index into FlowNode::dsts), in the order
+  // they were connected, the channels from it back to the route found so far.
+  using FlowPath = struct FlowPath {
+    std::vector<std::pair<size_t, std::vector<ChannelEdge *>>> segments;
+    int sourceRootedChannels = 0;
+    int dijkstraCalls = 0;
+    int nodesExpanded = 0;
+  };
+
+  bool demoteCongestedFlows(const std::vector<FlowRoute> &routes);
+  FlowPath findFlowPath(const FlowNode &flow) const;
+  FlowRoute commitFlowPath(const FlowNode &flow, const FlowPath &path);
+  int claimChannel(ChannelEdge *ch, std::optional<int> packetID);
+  void releaseChannel(ChannelEdge *ch, int index,
+                      std::optional<int> packetID);
+
+  // Shortest paths for flow from the nearest of srcs over the dense view of
+  // the graph, using each channel's cost for flow as its weight. Fills, for
+  // every SwitchboxNode::id, the distance to that switchbox and the channel
+  // used to reach it (nullptr for sources and for unreachable switchboxes).
+  // Both searches return the number of switchboxes they expanded.
+  int dijkstraShortestPaths(llvm::ArrayRef<SwitchboxNode *> srcs,
+                            const FlowNode &flow,
+                            std::vector<double> &distance,
+                            std::vector<ChannelEdge *> &preds) const;
+  // Like dijkstraShortestPaths from the source of flow, but directed towards
+  // its destinations; only the paths to them are guaranteed to be complete.
+  int aStarShortestPaths(const FlowNode &flow, std::vector<double> &distance,
+                         std::vector<ChannelEdge *> &preds) const;
+
+  PathfinderOptions options;
+  // smallest demand of any usable channel in the current iteration
+  double minDemand = 0.0;
+  PathfinderStats stats;
   SwitchboxGraph graph;
   std::vector<FlowNode> flows;
+  std::map<std::pair<PathEndPoint, int>, SwitchSettings> packetFlowSolutions;
+  // next unused entry of PathfinderOptions::packetFallbackIDs
+  size_t nextFallbackID = 0;
+  std::set<PathEndPoint> undemotableSources;
   std::map<TileID, SwitchboxNode> grid;
   // Use a list instead of a vector because nodes have an edge list of raw
   // pointers to edges (so growing a vector would invalidate the pointers).
   std::list<ChannelEdge> edges;
+
+  // Dense view of the graph, addressed by SwitchboxNode::id and built once in
+  // initialize: the outgoing channels of node i are
+  // adjacency[adjacencyOffsets[i], adjacencyOffsets[i + 1]), sorted by the id
+  // of their target node.
+  std::vector<SwitchboxNode *> nodes;
+  std::vector<ChannelEdge *> adjacency;
+  std::vector<size_t> adjacencyOffsets;
 };
 
 // DynamicTileAnalysis integrates the Pathfinder class into the MLIR
@@ -248,11 +386,25 @@ public:
 
   const int maxIterations = 1000; // how long until declared unroutable
 
+  // Directory holding the routing solutions of earlier runs, keyed on the
+  // device, its flows and its fixed connections. Empty disables the cache.
+  std::string cacheDir;
+  // Describes the router and its configuration; part of the cache key.
+  std::string routerConfig;
+  // Whether flowSolutions were read from the cache rather than routed.
+  bool loadedFromCache = false;
+  // Route the aie.packet_flow operations together with the aie.flow
+  // operations, so that circuit-switched routes leave room for them.
+  bool routePacketFlows = false;
+
   DynamicTileAnalysis() : pathfinder(std::make_shared<Pathfinder>()) {}
   DynamicTileAnalysis(std::shared_ptr<Router> p) : pathfinder(std::move(p)) {}
 
   mlir::LogicalResult runAnalysis(DeviceOp &device);
 
+  // Route the flows of device with pathfinder, filling flowSolutions.
+  mlir::LogicalResult routeFlows(DeviceOp &device);
+
   int getMaxCol() const { return maxCol; }
   int getMaxRow() const { return maxRow; }
 
@@ -263,6 +415,22 @@ public:
   ShimMuxOp getShimMux(mlir::OpBuilder &builder, int col);
 };
 
+// The connections packet-switched flows make through each switchbox, with the
+// packet ID of the flow making each.
+using PacketSwitchboxConnections =
+    llvm::DenseMap<TileID, llvm::SmallVector<std::pair<Connect, int>, 8>>;
+
+// Realize packet-switched routes in the switchboxes of device, as the arbiters,
+// master sets and packet rules that send each packet arriving on a slave port
+// on to its connections. Master ports in keepPktHeaderPorts keep the packet
+// header. With reassignIDs, the packet IDs are first renamed so that the ports
+// need fewer rules. Adds the number of rules made and of IDs renamed to
+// numPacketRules and numIDsReassigned. Defined in AIECreatePacketFlows.cpp.
+mlir::LogicalResult buildPacketSwitchboxes(
+    DeviceOp device, const PacketSwitchboxConnections &switchboxes,
+    const std::set<std::pair<TileID, Port>> &keepPktHeaderPorts,
+    bool reassignIDs, int &numPacketRules, int &numIDsReassigned);
+
 } // namespace xilinx::AIE
 
 // For some mysterious reason, the only way to get the priorityQueue(cmp)
@@ -20,4 +20,13 @@
 #define GET_OP_CLASSES
 #include "aie/Dialect/AIEX/IR/AIEX.h.inc"
 
+namespace xilinx::AIEX {
+
+/// Return the shim_dma_allocation op that refers to the symbol `symName`, if
+/// any.
+std::optional<AIE::ShimDMAAllocationOp>
+getAllocOpForSymbol(AIE::DeviceOp dev, llvm::StringRef symName);
+
+} // namespace xilinx::AIEX
+
 #endif
@@ -29,6 +29,11 @@ createAIELowerMulticastPass();
 std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>>
 createAIEBroadcastPacketPass();
 std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>> createAIEDmaToIpuPass();
+std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>> createAIEIpuPeepholePass();
+std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>>
+createAIEIpuScheduleDmaPass();
+std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>>
+createAIEIpuLegalizeDmaPass();
 std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>> createAIEXToStandardPass();
 
 /// Generate the code for registering passes.
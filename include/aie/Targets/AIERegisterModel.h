@@ -0,0 +1,97 @@
+//===- AIERegisterModel.h ---------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef AIE_TARGETS_AIEREGISTERMODEL_H
+#define AIE_TARGETS_AIEREGISTERMODEL_H
+
+#include "aie/Dialect/AIE/IR/AIETargetModel.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace xilinx::AIE {
+
+/// The register state of a device, as left by a sequence of register writes:
+/// the last value written to each register, addressed by tile and byte offset
+/// within the tile. It backs the register-state dump and diff tooling: two
+/// models can be hashed, diffed and dumped to check that different outputs
+/// configure a device the same way, and to find the stale configuration of a
+/// delta CDO.
+///
+/// It is not a shared serialization backend. The direct CDO target still emits
+/// its recorded command list, whose order and mask writes the model does not
+/// keep, and applies those commands to a model only for the tooling above.
+/// The airbin target collects its writes in a model as a sparse store.
+class RegisterModel {
+public:
+  static constexpr unsigned PAGE_WORDS = 256;
+
+  struct Difference {
+    TileID tile;
+    uint32_t offset;
+    // The value in each model, std::nullopt if it was never written.
+    std::optional<uint32_t> before, after;
+  };
+
+  void write32(TileID tile, uint32_t offset, uint32_t value);
+  /// Update the bits of `mask`. The other bits of a register that was never
+  /// written read as zero.
+  void maskWrite32(TileID tile, uint32_t offset, uint32_t mask,
+                   uint32_t value);
+  void blockWrite32(TileID tile, uint32_t offset,
+                    llvm::ArrayRef<uint32_t> values);
+  std::optional<uint32_t> read32(TileID tile, uint32_t offset) const;
+
+  /// The number of registers written.
+  size_t size() const;
+  bool empty() const { return tiles.empty(); }
+
+  /// Call `fn` on each run of contiguous written registers of a tile, in
+  /// address order.
+  void forEachRun(
+      llvm::function_ref<void(TileID, uint32_t, llvm::ArrayRef<uint32_t>)> fn)
+      const;
+
+  /// A hash of the written registers and their values, stable across runs.
+  uint64_t hash() const;
+
+  /// The registers whose values differ from `other`, in address order.
+  llvm::SmallVector<Difference> diff(const RegisterModel &other) const;
+
+  void dump(llvm::raw_ostream &os) const;
+  /// Print the registers whose values differ from `other`.
+  void dumpDiff(const RegisterModel &other, llvm::raw_ostream &os) const;
+
+  bool operator==(const RegisterModel &other) const;
+  bool operator!=(const RegisterModel &other) const {
+    return !(*this == other);
+  }
+
+private:
+  struct Page {
+    std::array<uint32_t, PAGE_WORDS> values = {};
+    std::bitset<PAGE_WORDS> written;
+  };
+  using Pages = std::map<uint32_t, Page>;
+
+  std::map<TileID, Pages> tiles;
+};
+
+} // namespace xilinx::AIE
+
+#endif // AIE_TARGETS_AIEREGISTERMODEL_H
@@ -36,8 +36,11 @@ mlir::LogicalResult AIETranslateShimSolution(mlir::ModuleOp module,
 mlir::LogicalResult AIETranslateGraphXPE(mlir::ModuleOp module,
                                          llvm::raw_ostream &);
 mlir::LogicalResult AIETranslateToIPU(mlir::ModuleOp module,
-                                      llvm::raw_ostream &output);
+                                      llvm::raw_ostream &output,
+                                      bool binary = false);
 std::vector<uint32_t> AIETranslateToIPU(mlir::ModuleOp);
+mlir::LogicalResult AIETranslateToIPUPatchTable(mlir::ModuleOp module,
+                                                llvm::raw_ostream &output);
 mlir::LogicalResult AIETranslateToLdScript(mlir::ModuleOp module,
                                            llvm::raw_ostream &output,
                                            int tileCol, int tileRow);
@@ -51,11 +54,36 @@ AIELLVMLink(llvm::raw_ostream &output, std::vector<std::string> Files,
             bool PreserveAssemblyUseListOrder = false, bool Verbose = false);
 
 #ifdef AIE_ENABLE_GENERATE_CDO_DIRECT
+// Emit the CDO files of the design. With `coalesceWrites`, writes that leave a
+// register at its reset value are dropped, so the CDO must be loaded on a
+// freshly reset partition.
 mlir::LogicalResult AIETranslateToCDODirect(mlir::ModuleOp m,
                                             llvm::StringRef workDirPath,
                                             byte_ordering endianness,
                                             bool emitUnified, bool axiDebug,
-                                            bool aieSim);
+                                            bool aieSim,
+                                            bool coalesceWrites = false);
+// Emit aie_cdo_delta.bin, which reconfigures a partition running `base` to run
+// `m` by writing only the registers whose values differ.
+mlir::LogicalResult AIETranslateToCDODelta(mlir::ModuleOp base,
+                                           mlir::ModuleOp m,
+                                           llvm::StringRef baseWorkDirPath,
+                                           llvm::StringRef workDirPath,
+                                           byte_ordering endianness,
+                                           bool axiDebug, bool aieSim);
+// Print the registers configured by the design, as the CDO would write them.
+mlir::LogicalResult AIETranslateToRegisterDump(mlir::ModuleOp m,
+                                               llvm::raw_ostream &output,
+                                               llvm::StringRef workDirPath,
+                                               bool aieSim);
+// Print the registers whose values differ between the designs of `base` and
+// `m`.
+mlir::LogicalResult AIETranslateToRegisterDiff(mlir::ModuleOp base,
+                                               mlir::ModuleOp m,
+                                               llvm::raw_ostream &output,
+                                               llvm::StringRef baseWorkDirPath,
+                                               llvm::StringRef workDirPath,
+                                               bool aieSim);
 #endif
 #ifdef AIE_ENABLE_AIRBIN
 mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
@@ -14,23 +14,263 @@
 #include "mlir/IR/Attributes.h"
 #include "mlir/Pass/Pass.h"
 
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 
+#include <tuple>
+
 #define DEBUG_TYPE "aie-assign-buffers"
 
 using namespace mlir;
 using namespace xilinx;
 using namespace xilinx::AIE;
 
+namespace {
+
+// A tile's data memory while buffers are being placed: the address ranges
+// still free and the number of bytes taken in each bank.
+struct TileMemory {
+  int size;
+  int bankSize;
+  // sorted, disjoint [begin, end) ranges
+  std::vector<std::pair<int, int>> holes;
+  std::vector<int> bankUse;
+
+  TileMemory(int size, int numBanks)
+      : size(size), bankSize(size / numBanks), holes{{0, size}},
+        bankUse(numBanks, 0) {}
+
+  int firstBank(int address) const { return address / bankSize; }
+  int lastBank(int address, int length) const {
+    return (address + length - 1) / bankSize;
+  }
+
+  // Take [address, address + length), which must lie in a single hole.
+  bool reserve(int address, int length) {
+    auto hole = llvm::find_if(holes, [&](auto &h) {
+      return h.first <= address && address + length <= h.second;
+    });
+    if (hole == holes.end())
+      return false;
+    auto [begin, end] = *hole;
+    hole = holes.erase(hole);
+    if (address + length < end)
+      hole = holes.insert(hole, {address + length, end});
+    if (begin < address)
+      holes.insert(hole, {begin, address});
+    for (int bank = firstBank(address); bank <= lastBank(address, length);
+         bank++)
+      bankUse[bank] += std::min(address + length, (bank + 1) * bankSize) -
+                       std::max(address, bank * bankSize);
+    return true;
+  }
+
+  // Best place for a buffer of the given length: the start of the tightest
+  // hole, lowest address first. When spreading over the banks, the start of
+  // any bank inside a hole is a candidate too: the banks shared with the
+  // fewest of the `conflicts` ranges win, then the least used banks.
+  std::optional<int>
+  findPlacement(int length, bool spreadBanks,
+                ArrayRef<std::pair<int, int>> conflicts = {}) const {
+    std::optional<int> best;
+    std::tuple<int, int, int, int> bestCost;
+    for (auto [begin, end] : holes) {
+      if (end - begin < length)
+        continue;
+      int candidate = begin;
+      while (candidate + length <= end) {
+        int use = 0, shared = 0;
+        if (spreadBanks) {
+          int first = firstBank(candidate);
+          int last = lastBank(candidate, length);
+          for (int bank = first; bank <= last; bank++)
+            use += bankUse[bank];
+          for (auto [address, size] : conflicts)
+            if (firstBank(address) <= last && first <= lastBank(address, size))
+              shared++;
+        }
+        std::tuple<int, int, int, int> cost = {shared, use, end - begin,
+                                               candidate};
+        if (!best || cost < bestCost) {
+          best = candidate;
+          bestCost = cost;
+        }
+        if (!spreadBanks)
+          break;
+        candidate = (firstBank(candidate) + 1) * bankSize;
+      }
+    }
+    return best;
+  }
+};
+
+} // namespace
+
 struct AIEAssignBufferAddressesPass
     : AIEAssignBufferAddressesBase<AIEAssignBufferAddressesPass> {
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<func::FuncDialect>();
     registry.insert<AIEDialect>();
   }
+
+  // Attach the memory map of a tile to diag. With a bank size, the buffers
+  // are listed in address order along with the banks they occupy.
+  static Diagnostic &printMemoryMap(InFlightDiagnostic &diag, int stacksize,
+                                    SmallVector<BufferOp, 4> buffers,
+                                    int bankSize) {
+    auto &note = diag.attachNote() << "MemoryMap:\n";
+    auto printbuffer = [&](StringRef name, int address, int size) {
+      note << "\t" << name << " \t"
+           << ": 0x" << llvm::utohexstr(address) << "-0x"
+           << llvm::utohexstr(address + size - 1) << " \t(" << size
+           << " bytes)";
+      if (bankSize) {
+        int first = address / bankSize;
+        int last = (address + size - 1) / bankSize;
+        note << " \tbank " << first;
+        if (last != first)
+          note << "-" << last;
+      }
+      note << "\n";
+    };
+    if (stacksize > 0)
+      printbuffer("(stack)", 0, stacksize);
+    else
+      diag << "(no stack allocated)\n";
+
+    if (bankSize)
+      std::stable_sort(buffers.begin(), buffers.end(),
+                       [](BufferOp a, BufferOp b) {
+                         return a.getAddress().value() < b.getAddress().value();
+                       });
+    for (auto buffer : buffers) {
+      assert(buffer.getAddress().has_value() &&
+             "buffer must have address assigned");
+      printbuffer(buffer.name(), buffer.getAddress().value(),
+                  buffer.getAllocationSize());
+    }
+    return note;
+  }
+
+  // Bump a single address pointer over the buffers, largest first.
+  LogicalResult basicSequentialAllocation(TileOp tile,
+                                          SmallVector<BufferOp, 4> &buffers,
+                                          int stacksize,
+                                          int maxDataMemorySize) {
+    int address = stacksize;
+    for (auto buffer : buffers) {
+      if (buffer.getAddress())
+        buffer->emitWarning("Overriding existing address");
+      buffer.setAddress(address);
+      address += buffer.getAllocationSize();
+    }
+
+    if (address > maxDataMemorySize) {
+      InFlightDiagnostic error =
+          tile.emitOpError("allocated buffers exceeded available memory\n");
+      printMemoryMap(error, stacksize, buffers, 0);
+      return failure();
+    }
+    return success();
+  }
+
+  // Keep the buffers that already have an address in place, then fill the
+  // holes around them best-fit, largest buffer first, spreading the buffers
+  // over the memory banks so that the core and the DMAs (e.g. on the ping and
+  // pong buffers of an objectFifo) access different banks.
+  LogicalResult bankAwareAllocation(TileOp tile,
+                                    SmallVector<BufferOp, 4> &buffers,
+                                    int stacksize, int maxDataMemorySize) {
+    const auto &targetModel = getTargetModel(tile);
+    TileMemory memory(
+        maxDataMemorySize,
+        targetModel.getNumBanks(tile.colIndex(), tile.rowIndex()));
+    if (stacksize > 0 && !memory.reserve(0, stacksize))
+      return tile.emitOpError("stack exceeds available memory");
+
+    for (auto buffer : buffers) {
+      if (!buffer.getAddress())
+        continue;
+      int address = buffer.getAddress().value();
+      if (!memory.reserve(address, buffer.getAllocationSize()))
+        return buffer.emitOpError("at address 0x")
+               << llvm::utohexstr(address)
+               << " overlaps the stack or another buffer, or exceeds the "
+                  "available memory";
+    }
+
+    // Buffers accessed at the same time, in either direction.
+    llvm::StringMap<BufferOp> byName;
+    for (auto buffer : buffers)
+      byName[buffer.name().getValue()] = buffer;
+    DenseMap<BufferOp, SmallVector<BufferOp>> conflicts;
+    for (auto buffer : buffers) {
+      std::optional<ArrayAttr> refs = buffer.getBankConflicts();
+      if (!refs)
+        continue;
+      for (auto ref : refs->getAsRange<FlatSymbolRefAttr>()) {
+        BufferOp other = byName.lookup(ref.getValue());
+        if (!other)
+          return buffer.emitOpError("bank conflict with ")
+                 << ref << ", which is not a buffer of the same tile";
+        conflicts[buffer].push_back(other);
+        conflicts[other].push_back(buffer);
+      }
+    }
+
+    // Spread over the banks if the holes this leaves are large enough for
+    // all the buffers, otherwise just fill the holes best-fit.
+    SmallVector<BufferOp, 4> unplaced(llvm::make_filter_range(
+        buffers, [](BufferOp b) { return !b.getAddress().has_value(); }));
+    for (bool spreadBanks : {true, false}) {
+      TileMemory attempt = memory;
+      DenseMap<BufferOp, int> addresses;
+      for (auto buffer : unplaced) {
+        SmallVector<std::pair<int, int>> avoid;
+        for (BufferOp other : conflicts.lookup(buffer)) {
+          std::optional<int> address = other.getAddress();
+          if (auto it = addresses.find(other); it != addresses.end())
+            address = it->second;
+          if (address)
+            avoid.push_back({*address, other.getAllocationSize()});
+        }
+        std::optional<int> address = attempt.findPlacement(
+            buffer.getAllocationSize(), spreadBanks, avoid);
+        if (!address)
+          break;
+        attempt.reserve(*address, buffer.getAllocationSize());
+        addresses[buffer] = *address;
+      }
+      if (addresses.size() < unplaced.size())
+        continue;
+      for (auto buffer : unplaced)
+        buffer.setAddress(addresses[buffer]);
+      return success();
+    }
+
+    InFlightDiagnostic error =
+        tile.emitOpError("allocated buffers exceeded available memory\n");
+    SmallVector<BufferOp, 4> placed(llvm::make_filter_range(
+        buffers, [](BufferOp b) { return b.getAddress().has_value(); }));
+    auto &note = printMemoryMap(error, stacksize, placed, memory.bankSize);
+    note << "Unplaced:\n";
+    for (auto buffer : unplaced)
+      note << "\t" << buffer.name() << " \t(" << buffer.getAllocationSize()
+           << " bytes)\n";
+    return failure();
+  }
+
   void runOnOperation() override {
     DeviceOp device = getOperation();
     OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
+    bool bankAware = allocScheme == "bank-aware";
+    if (!bankAware && allocScheme != "basic-sequential") {
+      device.emitError("unknown allocation scheme '")
+          << allocScheme << "', expected 'basic-sequential' or 'bank-aware'";
+      return signalPassFailure();
+    }
+
     // Make sure all the buffers have a name
     int counter = 0;
     device.walk<WalkOrder::PreOrder>([&](BufferOp buffer) {
@@ -64,41 +304,22 @@ struct AIEAssignBufferAddressesPass
       // Address range owned by the tile is 0x8000,
       // but we need room at the bottom for stack.
       int stacksize = 0;
-      int address = 0;
-      if (auto core = tile.getCoreOp()) {
+      if (auto core = tile.getCoreOp())
         stacksize = core.getStackSize();
-        address += stacksize;
-      }
-
-      for (auto buffer : buffers) {
-        if (buffer.getAddress())
-          buffer->emitWarning("Overriding existing address");
-        buffer.setAddress(address);
-        address += buffer.getAllocationSize();
-      }
 
-      if (address > maxDataMemorySize) {
-        InFlightDiagnostic error =
-            tile.emitOpError("allocated buffers exceeded available memory\n");
-        auto &note = error.attachNote() << "MemoryMap:\n";
-        auto printbuffer = [&](StringRef name, int address, int size) {
-          note << "\t" << name << " \t"
-               << ": 0x" << llvm::utohexstr(address) << "-0x"
-               << llvm::utohexstr(address + size - 1) << " \t(" << size
-               << " bytes)\n";
-        };
-        if (stacksize > 0)
-          printbuffer("(stack)", 0, stacksize);
-        else
-          error << "(no stack allocated)\n";
-
-        for (auto buffer : buffers) {
-          assert(buffer.getAddress().has_value() &&
-                 "buffer must have address assigned");
-          printbuffer(buffer.name(), buffer.getAddress().value(),
-                      buffer.getAllocationSize());
-        }
+      if (failed(bankAware ? bankAwareAllocation(tile, buffers, stacksize,
+                                                 maxDataMemorySize)
+                           : basicSequentialAllocation(
+                                 tile, buffers, stacksize, maxDataMemorySize)))
         return signalPassFailure();
+
+      if (memoryMapReport && (stacksize > 0 || !buffers.empty())) {
+        int numBanks =
+            targetModel.getNumBanks(tile.colIndex(), tile.rowIndex());
+        InFlightDiagnostic remark =
+            tile.emitRemark("memory map, ") << numBanks << " banks\n";
+        printMemoryMap(remark, stacksize, buffers,
+                       maxDataMemorySize / numBanks);
       }
     }
   }
@@ -108,3 +329,10 @@ std::unique_ptr<OperationPass<DeviceOp>>
 AIE::createAIEAssignBufferAddressesPass() {
   return std::make_unique<AIEAssignBufferAddressesPass>();
 }
+
+std::unique_ptr<OperationPass<DeviceOp>>
+AIE::createAIEAssignBufferAddressesPass(const std::string &allocScheme) {
+  auto pass = std::make_unique<AIEAssignBufferAddressesPass>();
+  pass->allocScheme = allocScheme;
+  return pass;
+}
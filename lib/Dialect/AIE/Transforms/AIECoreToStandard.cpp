@@ -581,3 +581,11 @@ struct AIECoreToStandardPass : AIECoreToStandardBase<AIECoreToStandardPass> {
 std::unique_ptr<OperationPass<ModuleOp>> AIE::createAIECoreToStandardPass() {
   return std::make_unique<AIECoreToStandardPass>();
 }
+
+std::unique_ptr<OperationPass<ModuleOp>>
+AIE::createAIECoreToStandardPass(int tileCol, int tileRow) {
+  auto pass = std::make_unique<AIECoreToStandardPass>();
+  pass->tileCol = tileCol;
+  pass->tileRow = tileRow;
+  return pass;
+}
@@ -9,6 +9,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIE/Transforms/AIEPathFinder.h"
 #include "aie/Dialect/AIE/Transforms/AIEPasses.h"
 
 #include "mlir/IR/Attributes.h"
@@ -17,7 +18,11 @@
 #include "mlir/Tools/mlir-translate/MlirTranslateMain.h"
 #include "mlir/Transforms/DialectConversion.h"
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/ADT/bit.h"
+
+#include <functional>
 
 #define DEBUG_TYPE "aie-create-packet-flows"
 
@@ -254,6 +259,180 @@ void buildPSRoute(
       std::make_pair(Connect{lastPort, destPort}, flowID));
 }
 
+// Packet IDs are 5 bits wide, so a set of IDs fits in a 32-bit word.
+constexpr int NUM_PACKET_IDS = 32;
+constexpr int PACKET_ID_MASK = NUM_PACKET_IDS - 1;
+// The number of aie.rule operations in an aie.packet_rules.
+constexpr int NUM_PACKET_RULES = 4;
+// How many partial covers the search for the fewest rules covering a set of
+// IDs tries before settling for the best found so far.
+constexpr int MAX_COVER_SEARCH_STEPS = 10000;
+
+// The IDs matched by a packet rule: those i with (i & mask) == value.
+struct PacketRuleCube {
+  int mask;
+  int value;
+
+  uint32_t ids() const {
+    uint32_t ids = 0;
+    for (int id = 0; id < NUM_PACKET_IDS; id++)
+      if ((id & mask) == value)
+        ids |= 1u << id;
+    return ids;
+  }
+};
+
+// The smallest rule matching every ID of `ids`.
+PacketRuleCube getEnclosingCube(uint32_t ids) {
+  int ones = PACKET_ID_MASK, zeros = PACKET_ID_MASK;
+  for (int id = 0; id < NUM_PACKET_IDS; id++)
+    if (ids >> id & 1) {
+      ones &= id;
+      zeros &= ~id;
+    }
+  int mask = ones | zeros;
+  return {mask, ones & mask};
+}
+
+// The fewest rules matching every ID of `on` and none of `off`, where IDs in
+// neither set may match either way. The rules are chosen among the prime
+// implicants of `on` and the free IDs, as in Quine-McCluskey minimization,
+// and the smallest cover is searched for by branch and bound. Each chosen rule
+// is then narrowed to the IDs of `on` it is the first to match, so that a set
+// of IDs that a single rule covers gets the same rule as from its differing
+// bits alone.
+SmallVector<PacketRuleCube> minimizePacketRules(uint32_t on, uint32_t off) {
+  assert(!(on & off) && "an ID can't both match and not match");
+  // Enumerate the implicants, widest first, and keep those no wider implicant
+  // contains.
+  SmallVector<std::pair<PacketRuleCube, uint32_t>> primes;
+  SmallVector<int, NUM_PACKET_IDS> masks;
+  for (int mask = 0; mask < NUM_PACKET_IDS; mask++)
+    masks.push_back(mask);
+  llvm::stable_sort(masks, [](int a, int b) {
+    return llvm::popcount(static_cast<unsigned>(a)) <
+           llvm::popcount(static_cast<unsigned>(b));
+  });
+  for (int mask : masks)
+    for (int value = 0; value < NUM_PACKET_IDS; value++) {
+      if (value & ~mask)
+        continue;
+      PacketRuleCube cube = {mask, value};
+      uint32_t ids = cube.ids();
+      if ((ids & off) || !(ids & on))
+        continue;
+      if (llvm::none_of(primes, [&](auto &prime) {
+            return (prime.second & ids) == ids;
+          }))
+        primes.push_back({cube, ids});
+    }
+
+  // Cover the lowest ID left uncovered with each prime matching it in turn.
+  SmallVector<PacketRuleCube> best, chosen;
+  int steps = 0;
+  std::function<void(uint32_t)> cover = [&](uint32_t uncovered) {
+    if (!uncovered) {
+      if (best.empty() || chosen.size() < best.size())
+        best = chosen;
+      return;
+    }
+    if ((!best.empty() && chosen.size() + 1 >= best.size()) ||
+        (++steps > MAX_COVER_SEARCH_STEPS && !best.empty()))
+      return;
+    int lowest = llvm::countr_zero(uncovered);
+    // try the primes covering the most uncovered IDs first
+    SmallVector<std::pair<PacketRuleCube, uint32_t>> candidates;
+    for (auto &prime : primes)
+      if (prime.second >> lowest & 1)
+        candidates.push_back(prime);
+    llvm::stable_sort(candidates, [&](auto &a, auto &b) {
+      return llvm::popcount(a.second & uncovered) >
+             llvm::popcount(b.second & uncovered);
+    });
+    for (auto &[cube, ids] : candidates) {
+      chosen.push_back(cube);
+      cover(uncovered & ~ids);
+      chosen.pop_back();
+    }
+  };
+  cover(on);
+
+  SmallVector<PacketRuleCube> rules;
+  uint32_t covered = 0;
+  for (PacketRuleCube cube : best)
+    if (uint32_t ids = cube.ids() & on & ~covered) {
+      rules.push_back(getEnclosingCube(ids));
+      covered |= ids;
+    }
+  return rules;
+}
+
+// The IDs of the flows of each group sharing an arbiter and msel on a slave
+// port, for each slave port.
+using SlavePortIDs = SmallVector<SmallVector<uint32_t, 4>>;
+
+// The number of rules the slave ports need with IDs renamed by `perm`, and
+// by how many rules they overflow the rule slots in total.
+std::pair<int, int>
+countPacketRules(const SlavePortIDs &ports, ArrayRef<int> perm,
+                 DenseMap<std::pair<uint32_t, uint32_t>, int> &memo) {
+  auto rename = [&](uint32_t ids) {
+    uint32_t renamed = 0;
+    for (int id = 0; id < NUM_PACKET_IDS; id++)
+      if (ids >> id & 1)
+        renamed |= 1u << perm[id];
+    return renamed;
+  };
+  int rules = 0, overflow = 0;
+  for (const auto &groups : ports) {
+    uint32_t all = 0;
+    for (uint32_t ids : groups)
+      all |= rename(ids);
+    int portRules = 0;
+    for (uint32_t ids : groups) {
+      uint32_t on = rename(ids);
+      auto key = std::make_pair(on, all & ~on);
+      auto it = memo.find(key);
+      if (it == memo.end())
+        it = memo.insert({key, static_cast<int>(minimizePacketRules(
+                                         key.first, key.second)
+                                         .size())})
+                 .first;
+      portRules += it->second;
+    }
+    rules += portRules;
+    overflow += std::max(0, portRules - NUM_PACKET_RULES);
+  }
+  return {overflow, rules};
+}
+
+// A renaming of packet IDs, leaving those in `pinned` alone, after which the
+// slave ports overflow their rule slots less, or need fewer rules. Swaps
+// pairs of IDs as long as a swap helps.
+SmallVector<int> reassignPacketIDs(const SlavePortIDs &ports,
+                                   uint32_t pinned) {
+  SmallVector<int> perm;
+  for (int id = 0; id < NUM_PACKET_IDS; id++)
+    perm.push_back(id);
+  DenseMap<std::pair<uint32_t, uint32_t>, int> memo;
+  auto best = countPacketRules(ports, perm, memo);
+  for (bool improved = true; improved;) {
+    improved = false;
+    for (int a = 0; a < NUM_PACKET_IDS; a++)
+      for (int b = a + 1; b < NUM_PACKET_IDS; b++) {
+        if ((pinned >> a & 1) || (pinned >> b & 1))
+          continue;
+        std::swap(perm[a], perm[b]);
+        if (auto cost = countPacketRules(ports, perm, memo); cost < best) {
+          best = cost;
+          improved = true;
+        } else
+          std::swap(perm[a], perm[b]);
+      }
+  }
+  return perm;
+}
+
 SwitchboxOp getOrCreateSwitchbox(OpBuilder &builder, TileOp tile) {
   for (auto i : tile.getResult().getUsers()) {
     if (llvm::isa<SwitchboxOp>(*i)) {
@@ -262,559 +441,704 @@ SwitchboxOp getOrCreateSwitchbox(OpBuilder &builder, TileOp tile) {
   }
   return builder.create<SwitchboxOp>(builder.getUnknownLoc(), tile);
 }
-struct AIERoutePacketFlowsPass
-    : AIERoutePacketFlowsBase<AIERoutePacketFlowsPass> {
-  // Map from tile coordinates to TileOp
-  DenseMap<TileID, Operation *> tiles;
-  Operation *getOrCreateTile(OpBuilder &builder, int col, int row) {
-    TileID index = {col, row};
-    Operation *tileOp = tiles[index];
-    if (!tileOp) {
-      auto tile = builder.create<TileOp>(builder.getUnknownLoc(), col, row);
-      tileOp = tile.getOperation();
-      tiles[index] = tileOp;
-    }
-    return tileOp;
+// A renaming of packet IDs after which the slave ports of `portIDs` need
+// fewer rules, applied to the packet flows of `device` and to the packet IDs
+// its DMAs send. Flows that keep their packet header keep their ID, since
+// their destination may read it. Returns the identity when existing packet
+// rules already match on the IDs. Counts the renamed IDs in
+// `numIDsReassigned`.
+SmallVector<int> getPacketIDReassignment(DeviceOp device,
+                                         const SlavePortIDs &portIDs,
+                                         int &numIDsReassigned) {
+  SmallVector<int> identity;
+  for (int id = 0; id < NUM_PACKET_IDS; id++)
+    identity.push_back(id);
+  uint32_t pinned = 0;
+  for (auto pktflow : device.getOps<PacketFlowOp>()) {
+    if (pktflow.IDInt() >= NUM_PACKET_IDS)
+      return identity;
+    if (pktflow->hasAttr("keep_pkt_header"))
+      pinned |= 1u << pktflow.IDInt();
+  }
+  bool hasRules = false;
+  device.walk([&](PacketRuleOp) { hasRules = true; });
+  if (hasRules) {
+    LLVM_DEBUG(llvm::dbgs() << "Not reassigning packet IDs: existing packet "
+                               "rules match on them\n");
+    return identity;
   }
-  void runOnOperation() override {
-
-    DeviceOp device = getOperation();
-    OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
-
-    ConversionTarget target(getContext());
 
-    // Some communication patterns:
-    //  - one-to-one
-    //  - one-to-many
-    //    + same flow (same port, same ID): broadcast/multicast
-    //    + different flows (same port, differnt IDs)
-    //  - many-to-one
-    //    + timeshare: single arbiter, different msels
-    //  - many-to-many
-    //
-    // Compute the mask for each LUT entry of a slave port
-    // Aim to generate as few LUT entries as possible
+  SmallVector<int> perm = reassignPacketIDs(portIDs, pinned);
+  for (auto pktflow : device.getOps<PacketFlowOp>())
+    pktflow.setIDAttr(IntegerAttr::get(pktflow.getIDAttr().getType(),
+                                       perm[pktflow.IDInt()]));
+  // aie.dma_bd_packet and the runtime sequence's buffer descriptors
+  device.walk([&](Operation *op) {
+    if (auto id = op->getAttrOfType<IntegerAttr>("packet_id");
+        id && id.getInt() >= 0 && id.getInt() < NUM_PACKET_IDS)
+      op->setAttr("packet_id",
+                  IntegerAttr::get(id.getType(), perm[id.getInt()]));
+  });
+  for (int id = 0; id < NUM_PACKET_IDS; id++)
+    if (perm[id] != id) {
+      LLVM_DEBUG(llvm::dbgs() << "Packet ID " << id << " -> " << perm[id]
+                              << "\n");
+      numIDsReassigned++;
+    }
+  return perm;
+}
 
-    // Avoid creating packetswitch config as much as possible
-    // We will use circuit-switch to pre-route the flows from the source swboxes
-    // to the dest swboxes, and only use packet-switch to route at the dest
-    // swboxes
+LogicalResult AIE::buildPacketSwitchboxes(
+    DeviceOp device, const PacketSwitchboxConnections &switchboxes,
+    const std::set<std::pair<TileID, Port>> &keepPktHeaderPorts,
+    bool reassignIDs, int &numPacketRules, int &numIDsReassigned) {
+  OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
 
-    // Map from a port and flowID to
-    DenseMap<std::pair<PhysPort, int>, SmallVector<PhysPort, 4>> packetFlows;
-    SmallVector<std::pair<PhysPort, int>, 4> slavePorts;
-    DenseMap<std::pair<PhysPort, int>, int> slaveAMSels;
-    // Map from a port to
-    DenseMap<PhysPort, Attribute> keepPktHeaderAttr;
-
-    for (auto tileOp : device.getOps<TileOp>()) {
-      int col = tileOp.colIndex();
-      int row = tileOp.rowIndex();
-      tiles[{col, row}] = tileOp;
+  // Map from tile coordinates to TileOp
+  DenseMap<TileID, Operation *> tiles;
+  for (auto tileOp : device.getOps<TileOp>())
+    tiles[tileOp.getTileID()] = tileOp;
+  auto getOrCreateTile = [&](int col, int row) {
+    Operation *&tileOp = tiles[{col, row}];
+    if (!tileOp)
+      tileOp = builder.create<TileOp>(builder.getUnknownLoc(), col, row);
+    return tileOp;
+  };
+
+  // Map from a port and flowID to
+  DenseMap<std::pair<PhysPort, int>, SmallVector<PhysPort, 4>> packetFlows;
+  SmallVector<std::pair<PhysPort, int>, 4> slavePorts;
+  DenseMap<std::pair<PhysPort, int>, int> slaveAMSels;
+
+  LLVM_DEBUG(llvm::dbgs() << "Check switchboxes\n");
+
+  for (const auto &[tileId, connects] : switchboxes) {
+    int col = tileId.col;
+    int row = tileId.row;
+    Operation *tileOp = getOrCreateTile(col, row);
+
+    LLVM_DEBUG(llvm::dbgs() << "***switchbox*** " << col << " " << row
+                            << '\n');
+    for (const auto &[conn, flowID] : connects) {
+      Port sourcePort = conn.src;
+      Port destPort = conn.dst;
+      int nextCol = col, nextRow = row;
+      updateCoordinates(nextCol, nextRow, sourcePort.bundle);
+      LLVM_DEBUG(llvm::dbgs() << "flowID " << flowID << ':'
+                              << stringifyWireBundle(sourcePort.bundle) << " "
+                              << sourcePort.channel << " -> "
+                              << stringifyWireBundle(destPort.bundle) << " "
+                              << destPort.channel << " tile " << nextCol
+                              << " " << nextRow << "\n");
+
+      auto sourceFlow =
+          std::make_pair(std::make_pair(tileOp, sourcePort), flowID);
+      packetFlows[sourceFlow].push_back({tileOp, destPort});
+      slavePorts.push_back(sourceFlow);
     }
+  }
 
-    // The logical model of all the switchboxes.
-    DenseMap<TileID, SmallVector<std::pair<Connect, int>, 8>> switchboxes;
-    for (auto pktflow : device.getOps<PacketFlowOp>()) {
-      Region &r = pktflow.getPorts();
-      Block &b = r.front();
-      int flowID = pktflow.IDInt();
-      int xSrc = 0, ySrc = 0;
-      Port sourcePort;
-
-      for (Operation &Op : b.getOperations()) {
-        if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
-          auto srcTile = dyn_cast<TileOp>(pktSource.getTile().getDefiningOp());
-          xSrc = srcTile.colIndex();
-          ySrc = srcTile.rowIndex();
-          sourcePort = pktSource.port();
-        } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
-          auto destTile = dyn_cast<TileOp>(pktDest.getTile().getDefiningOp());
-          int xDest = destTile.colIndex();
-          int yDest = destTile.rowIndex();
-          Port destPort = pktDest.port();
+  // amsel()
+  // masterset()
+  // packetrules()
+  // rule()
+
+  // Compute arbiter assignments. Each arbiter has four msels.
+  // Therefore, the number of "logical" arbiters is 6 x 4 = 24
+  // A master port can only be associated with one arbiter
+
+  // A map from Tile and master selectValue to the ports targetted by that
+  // master select.
+  DenseMap<std::pair<Operation *, int>, SmallVector<Port, 4>> masterAMSels;
+
+  // Count of currently used logical arbiters for each tile.
+  DenseMap<Operation *, int> amselValues;
+  int numMsels = 4;
+  int numArbiters = 6;
+
+  // Check all multi-cast flows (same source, same ID). They should be
+  // assigned the same arbiter and msel so that the flow can reach all the
+  // destination ports at the same time For destination ports that appear in
+  // different (multicast) flows, it should have a different <arbiterID, msel>
+  // value pair for each flow
+  for (const auto &packetFlow : packetFlows) {
+    // The Source Tile of the flow
+    Operation *tileOp = packetFlow.first.first.first;
+    if (amselValues.count(tileOp) == 0)
+      amselValues[tileOp] = 0;
+
+    // arb0: 6*0,   6*1,   6*2,   6*3
+    // arb1: 6*0+1, 6*1+1, 6*2+1, 6*3+1
+    // arb2: 6*0+2, 6*1+2, 6*2+2, 6*3+2
+    // arb3: 6*0+3, 6*1+3, 6*2+3, 6*3+3
+    // arb4: 6*0+4, 6*1+4, 6*2+4, 6*3+4
+    // arb5: 6*0+5, 6*1+5, 6*2+5, 6*3+5
+
+    int amselValue = amselValues[tileOp];
+    assert(amselValue < numArbiters && "Could not allocate new arbiter!");
+
+    // Find existing arbiter assignment
+    // If there is an assignment of an arbiter to a master port before, we
+    // assign all the master ports here with the same arbiter but different
+    // msel
+    bool foundMatchedDest = false;
+    for (const auto &map : masterAMSels) {
+      if (map.first.first != tileOp)
+        continue;
+      amselValue = map.first.second;
 
-          buildPSRoute(xSrc, ySrc, sourcePort, xDest, yDest, destPort, flowID,
-                       switchboxes, true);
+      // check if same destinations
+      SmallVector<Port, 4> ports(masterAMSels[{tileOp, amselValue}]);
+      if (ports.size() != packetFlow.second.size())
+        continue;
 
-          // Assign "keep_pkt_header flag"
-          if (pktflow->hasAttr("keep_pkt_header"))
-            keepPktHeaderAttr[{destTile, destPort}] =
-                StringAttr::get(Op.getContext(), "true");
+      bool matched = true;
+      for (auto dest : packetFlow.second) {
+        if (Port port = dest.second;
+            std::find(ports.begin(), ports.end(), port) == ports.end()) {
+          matched = false;
+          break;
         }
       }
-    }
 
-    LLVM_DEBUG(llvm::dbgs() << "Check switchboxes\n");
-
-    for (const auto &[tileId, connects] : switchboxes) {
-      int col = tileId.col;
-      int row = tileId.row;
-      Operation *tileOp = getOrCreateTile(builder, col, row);
-
-      LLVM_DEBUG(llvm::dbgs()
-                 << "***switchbox*** " << col << " " << row << '\n');
-      for (const auto &[conn, flowID] : connects) {
-        Port sourcePort = conn.src;
-        Port destPort = conn.dst;
-        int nextCol = col, nextRow = row;
-        updateCoordinates(nextCol, nextRow, sourcePort.bundle);
-        LLVM_DEBUG(llvm::dbgs() << "flowID " << flowID << ':'
-                                << stringifyWireBundle(sourcePort.bundle) << " "
-                                << sourcePort.channel << " -> "
-                                << stringifyWireBundle(destPort.bundle) << " "
-                                << destPort.channel << " tile " << nextCol
-                                << " " << nextRow << "\n");
-
-        auto sourceFlow =
-            std::make_pair(std::make_pair(tileOp, sourcePort), flowID);
-        packetFlows[sourceFlow].push_back({tileOp, destPort});
-        slavePorts.push_back(sourceFlow);
+      if (matched) {
+        foundMatchedDest = true;
+        break;
       }
     }
 
-    // amsel()
-    // masterset()
-    // packetrules()
-    // rule()
-
-    // Compute arbiter assignments. Each arbiter has four msels.
-    // Therefore, the number of "logical" arbiters is 6 x 4 = 24
-    // A master port can only be associated with one arbiter
-
-    // A map from Tile and master selectValue to the ports targetted by that
-    // master select.
-    DenseMap<std::pair<Operation *, int>, SmallVector<Port, 4>> masterAMSels;
-
-    // Count of currently used logical arbiters for each tile.
-    DenseMap<Operation *, int> amselValues;
-    int numMsels = 4;
-    int numArbiters = 6;
-
-    // Check all multi-cast flows (same source, same ID). They should be
-    // assigned the same arbiter and msel so that the flow can reach all the
-    // destination ports at the same time For destination ports that appear in
-    // different (multicast) flows, it should have a different <arbiterID, msel>
-    // value pair for each flow
-    for (const auto &packetFlow : packetFlows) {
-      // The Source Tile of the flow
-      Operation *tileOp = packetFlow.first.first.first;
-      if (amselValues.count(tileOp) == 0)
-        amselValues[tileOp] = 0;
-
-      // arb0: 6*0,   6*1,   6*2,   6*3
-      // arb1: 6*0+1, 6*1+1, 6*2+1, 6*3+1
-      // arb2: 6*0+2, 6*1+2, 6*2+2, 6*3+2
-      // arb3: 6*0+3, 6*1+3, 6*2+3, 6*3+3
-      // arb4: 6*0+4, 6*1+4, 6*2+4, 6*3+4
-      // arb5: 6*0+5, 6*1+5, 6*2+5, 6*3+5
-
-      int amselValue = amselValues[tileOp];
-      assert(amselValue < numArbiters && "Could not allocate new arbiter!");
-
-      // Find existing arbiter assignment
-      // If there is an assignment of an arbiter to a master port before, we
-      // assign all the master ports here with the same arbiter but different
-      // msel
-      bool foundMatchedDest = false;
-      for (const auto &map : masterAMSels) {
-        if (map.first.first != tileOp)
-          continue;
-        amselValue = map.first.second;
-
-        // check if same destinations
-        SmallVector<Port, 4> ports(masterAMSels[{tileOp, amselValue}]);
-        if (ports.size() != packetFlow.second.size())
-          continue;
-
-        bool matched = true;
-        for (auto dest : packetFlow.second) {
-          if (Port port = dest.second;
-              std::find(ports.begin(), ports.end(), port) == ports.end()) {
-            matched = false;
+    if (!foundMatchedDest) {
+      bool foundAMSelValue = false;
+      for (int a = 0; a < numArbiters; a++) {
+        for (int i = 0; i < numMsels; i++) {
+          amselValue = a + i * numArbiters;
+          if (masterAMSels.count({tileOp, amselValue}) == 0) {
+            foundAMSelValue = true;
             break;
           }
         }
 
-        if (matched) {
-          foundMatchedDest = true;
+        if (foundAMSelValue)
           break;
-        }
       }
-
-      if (!foundMatchedDest) {
-        bool foundAMSelValue = false;
-        for (int a = 0; a < numArbiters; a++) {
-          for (int i = 0; i < numMsels; i++) {
-            amselValue = a + i * numArbiters;
-            if (masterAMSels.count({tileOp, amselValue}) == 0) {
-              foundAMSelValue = true;
-              break;
-            }
-          }
-
-          if (foundAMSelValue)
-            break;
-        }
-
-        for (auto dest : packetFlow.second) {
-          Port port = dest.second;
-          masterAMSels[{tileOp, amselValue}].push_back(port);
-        }
+      if (!foundAMSelValue) {
+        tileOp->emitOpError("could not allocate an arbiter and msel for "
+                            "packet flow ")
+            << packetFlow.first.second;
+        return failure();
       }
 
-      slaveAMSels[packetFlow.first] = amselValue;
-      amselValues[tileOp] = amselValue % numArbiters;
+      for (auto dest : packetFlow.second) {
+        Port port = dest.second;
+        masterAMSels[{tileOp, amselValue}].push_back(port);
+      }
     }
 
-    // Compute the master set IDs
-    // A map from a switchbox output port to the number of that port.
-    DenseMap<PhysPort, SmallVector<int, 4>> mastersets;
-    for (const auto &[physPort, ports] : masterAMSels) {
-      Operation *tileOp = physPort.first;
-      assert(tileOp);
-      int amselValue = physPort.second;
-      for (auto port : ports) {
-        PhysPort physPort = {tileOp, port};
-        mastersets[physPort].push_back(amselValue);
-      }
+    slaveAMSels[packetFlow.first] = amselValue;
+    amselValues[tileOp] = amselValue % numArbiters;
+  }
+
+  // Compute the master set IDs
+  // A map from a switchbox output port to the number of that port.
+  DenseMap<PhysPort, SmallVector<int, 4>> mastersets;
+  for (const auto &[physPort, ports] : masterAMSels) {
+    Operation *tileOp = physPort.first;
+    assert(tileOp);
+    int amselValue = physPort.second;
+    for (auto port : ports) {
+      PhysPort physPort = {tileOp, port};
+      mastersets[physPort].push_back(amselValue);
     }
+  }
 
-    LLVM_DEBUG(llvm::dbgs() << "CHECK mastersets\n");
+  LLVM_DEBUG(llvm::dbgs() << "CHECK mastersets\n");
 #ifndef NDEBUG
-    for (const auto &[physPort, values] : mastersets) {
-      Operation *tileOp = physPort.first;
-      WireBundle bundle = physPort.second.bundle;
-      int channel = physPort.second.channel;
-      assert(tileOp);
-      auto tile = dyn_cast<TileOp>(tileOp);
-      LLVM_DEBUG(llvm::dbgs()
-                 << "master " << tile << " " << stringifyWireBundle(bundle)
-                 << " : " << channel << '\n');
-      for (auto value : values)
-        LLVM_DEBUG(llvm::dbgs() << "amsel: " << value << '\n');
-    }
+  for (const auto &[physPort, values] : mastersets) {
+    Operation *tileOp = physPort.first;
+    WireBundle bundle = physPort.second.bundle;
+    int channel = physPort.second.channel;
+    assert(tileOp);
+    auto tile = dyn_cast<TileOp>(tileOp);
+    LLVM_DEBUG(llvm::dbgs()
+               << "master " << tile << " " << stringifyWireBundle(bundle)
+               << " : " << channel << '\n');
+    for (auto value : values)
+      LLVM_DEBUG(llvm::dbgs() << "amsel: " << value << '\n');
+  }
 #endif
 
-    // Compute mask values
-    // Merging as many stream flows as possible
-    // The flows must originate from the same source port and have different IDs
-    // Two flows can be merged if they share the same destinations
-    SmallVector<SmallVector<std::pair<PhysPort, int>, 4>, 4> slaveGroups;
-    SmallVector<std::pair<PhysPort, int>, 4> workList(slavePorts);
-    while (!workList.empty()) {
-      auto slave1 = workList.pop_back_val();
-      Port slavePort1 = slave1.first.second;
-
-      bool foundgroup = false;
-      for (auto &group : slaveGroups) {
-        auto slave2 = group.front();
-        if (Port slavePort2 = slave2.first.second; slavePort1 != slavePort2)
-          continue;
-
-        bool matched = true;
-        auto dests1 = packetFlows[slave1];
-        auto dests2 = packetFlows[slave2];
-        if (dests1.size() != dests2.size())
-          continue;
+  // Compute mask values
+  // Merging as many stream flows as possible
+  // The flows must originate from the same source port and have different IDs
+  // Two flows can be merged if they share the same destinations
+  SmallVector<SmallVector<std::pair<PhysPort, int>, 4>, 4> slaveGroups;
+  SmallVector<std::pair<PhysPort, int>, 4> workList(slavePorts);
+  while (!workList.empty()) {
+    auto slave1 = workList.pop_back_val();
+    Port slavePort1 = slave1.first.second;
+
+    bool foundgroup = false;
+    for (auto &group : slaveGroups) {
+      auto slave2 = group.front();
+      if (Port slavePort2 = slave2.first.second; slavePort1 != slavePort2)
+        continue;
 
-        for (auto dest1 : dests1) {
-          if (std::find(dests2.begin(), dests2.end(), dest1) == dests2.end()) {
-            matched = false;
-            break;
-          }
-        }
+      bool matched = true;
+      auto dests1 = packetFlows[slave1];
+      auto dests2 = packetFlows[slave2];
+      if (dests1.size() != dests2.size())
+        continue;
 
-        if (matched) {
-          group.push_back(slave1);
-          foundgroup = true;
+      for (auto dest1 : dests1) {
+        if (std::find(dests2.begin(), dests2.end(), dest1) == dests2.end()) {
+          matched = false;
           break;
         }
       }
 
-      if (!foundgroup) {
-        SmallVector<std::pair<PhysPort, int>, 4> group({slave1});
-        slaveGroups.push_back(group);
+      if (matched) {
+        group.push_back(slave1);
+        foundgroup = true;
+        break;
       }
     }
 
-    DenseMap<std::pair<PhysPort, int>, int> slaveMasks;
-    for (const auto &group : slaveGroups) {
-      // Iterate over all the ID values in a group
-      // If bit n-th (n <= 5) of an ID value differs from bit n-th of another ID
-      // value, the bit position should be "don't care", and we will set the
-      // mask bit of that position to 0
-      int mask[5] = {-1, -1, -1, -1, -1};
-      for (auto port : group) {
-        int ID = port.second;
-        for (int i = 0; i < 5; i++) {
-          if (mask[i] == -1)
-            mask[i] = ID >> i & 0x1;
-          else if (mask[i] != (ID >> i & 0x1))
-            mask[i] = 2; // found bit difference --> mark as "don't care"
-        }
-      }
+    if (!foundgroup) {
+      SmallVector<std::pair<PhysPort, int>, 4> group({slave1});
+      slaveGroups.push_back(group);
+    }
+  }
 
-      int maskValue = 0;
-      for (int i = 4; i >= 0; i--) {
-        if (mask[i] == 2) // don't care
-          mask[i] = 0;
-        else
-          mask[i] = 1;
-        maskValue = (maskValue << 1) + mask[i];
-      }
-      for (auto port : group)
-        slaveMasks[port] = maskValue;
+  // Cover the IDs of each group with as few rules as possible. The rules of
+  // a group must not match the IDs of the other groups on the same slave
+  // port, but may match IDs no flow through the port uses.
+  llvm::MapVector<PhysPort, SmallVector<size_t, 4>> portGroups;
+  for (auto [i, group] : llvm::enumerate(slaveGroups))
+    portGroups[group.front().first].push_back(i);
+  auto getGroupIDs = [&](size_t i) {
+    uint32_t ids = 0;
+    for (auto &slave : slaveGroups[i])
+      ids |= 1u << (slave.second & PACKET_ID_MASK);
+    return ids;
+  };
+  SlavePortIDs portIDs;
+  for (const auto &[port, groupIndices] : portGroups) {
+    auto &ids = portIDs.emplace_back();
+    for (size_t i : groupIndices)
+      ids.push_back(getGroupIDs(i));
+  }
+
+  // Arbiter and msel of each group, before the IDs the map is keyed on
+  // change.
+  SmallVector<int> groupAMSels;
+  for (auto &group : slaveGroups)
+    groupAMSels.push_back(slaveAMSels[group.front()]);
+
+  if (reassignIDs) {
+    SmallVector<int> perm =
+        getPacketIDReassignment(device, portIDs, numIDsReassigned);
+    for (auto &group : slaveGroups)
+      for (auto &slave : group)
+        slave.second = perm[slave.second & PACKET_ID_MASK];
+  }
+
+  SmallVector<SmallVector<PacketRuleCube>> groupRules(slaveGroups.size());
+  for (const auto &[port, groupIndices] : portGroups) {
+    uint32_t usedIDs = 0;
+    for (size_t i : groupIndices)
+      usedIDs |= getGroupIDs(i);
+    size_t numRules = 0;
+    for (size_t i : groupIndices) {
+      uint32_t ids = getGroupIDs(i);
+      groupRules[i] = minimizePacketRules(ids, usedIDs & ~ids);
+      numRules += groupRules[i].size();
     }
+    numPacketRules += numRules;
+    if (numRules > NUM_PACKET_RULES) {
+      port.first->emitOpError("needs ")
+          << numRules << " packet rules on "
+          << stringifyWireBundle(port.second.bundle) << " : "
+          << port.second.channel << ", but a port has " << NUM_PACKET_RULES;
+      return failure();
+    }
+  }
 
 #ifndef NDEBUG
-    LLVM_DEBUG(llvm::dbgs() << "CHECK Slave Masks\n");
-    for (auto map : slaveMasks) {
-      auto port = map.first.first;
-      auto tile = dyn_cast<TileOp>(port.first);
-      WireBundle bundle = port.second.bundle;
-      int channel = port.second.channel;
-      int ID = map.first.second;
-      int mask = map.second;
-
-      LLVM_DEBUG(llvm::dbgs()
-                 << "Port " << tile << " " << stringifyWireBundle(bundle) << " "
-                 << channel << '\n');
-      LLVM_DEBUG(llvm::dbgs() << "Mask "
-                              << "0x" << llvm::Twine::utohexstr(mask) << '\n');
+  LLVM_DEBUG(llvm::dbgs() << "CHECK Slave Rules\n");
+  for (auto [group, rules] : llvm::zip(slaveGroups, groupRules)) {
+    auto port = group.front().first;
+    auto tile = dyn_cast<TileOp>(port.first);
+    LLVM_DEBUG(llvm::dbgs() << "Port " << tile << " "
+                            << stringifyWireBundle(port.second.bundle) << " "
+                            << port.second.channel << '\n');
+    for (auto slave : group)
       LLVM_DEBUG(llvm::dbgs() << "ID "
-                              << "0x" << llvm::Twine::utohexstr(ID) << '\n');
-      for (int i = 0; i < 31; i++) {
-        if ((i & mask) == (ID & mask))
-          LLVM_DEBUG(llvm::dbgs() << "matches flow ID "
-                                  << "0x" << llvm::Twine::utohexstr(i) << '\n');
-      }
-    }
+                              << "0x" << llvm::Twine::utohexstr(slave.second)
+                              << '\n');
+    for (PacketRuleCube rule : rules)
+      LLVM_DEBUG(llvm::dbgs() << "Mask 0x" << llvm::Twine::utohexstr(rule.mask)
+                              << " value 0x"
+                              << llvm::Twine::utohexstr(rule.value) << '\n');
+  }
 #endif
 
-    // Realize the routes in MLIR
-    for (auto map : tiles) {
-      Operation *tileOp = map.second;
-      auto tile = dyn_cast<TileOp>(tileOp);
-
-      // Create a switchbox for the routes and insert inside it.
-      builder.setInsertionPointAfter(tileOp);
-      SwitchboxOp swbox = getOrCreateSwitchbox(builder, tile);
-      SwitchboxOp::ensureTerminator(swbox.getConnections(), builder,
-                                    builder.getUnknownLoc());
-      Block &b = swbox.getConnections().front();
-      builder.setInsertionPoint(b.getTerminator());
-
-      std::vector<bool> amselOpNeededVector(32);
-      for (const auto &map : mastersets) {
-        if (tileOp != map.first.first)
-          continue;
+  // Realize the routes in MLIR
+  for (auto map : tiles) {
+    if (!switchboxes.count(map.first))
+      continue;
+    Operation *tileOp = map.second;
+    auto tile = dyn_cast<TileOp>(tileOp);
+
+    // Create a switchbox for the routes and insert inside it.
+    builder.setInsertionPointAfter(tileOp);
+    SwitchboxOp swbox = getOrCreateSwitchbox(builder, tile);
+    SwitchboxOp::ensureTerminator(swbox.getConnections(), builder,
+                                  builder.getUnknownLoc());
+    Block &b = swbox.getConnections().front();
+    builder.setInsertionPoint(b.getTerminator());
+
+    std::vector<bool> amselOpNeededVector(32);
+    for (const auto &map : mastersets) {
+      if (tileOp != map.first.first)
+        continue;
 
-        for (auto value : map.second) {
-          amselOpNeededVector[value] = true;
-        }
+      for (auto value : map.second) {
+        amselOpNeededVector[value] = true;
       }
-      // Create all the amsel Ops
-      DenseMap<int, AMSelOp> amselOps;
-      for (int i = 0; i < 32; i++) {
-        if (amselOpNeededVector[i]) {
-          int arbiterID = i % numArbiters;
-          int msel = i / numArbiters;
-          auto amsel =
-              builder.create<AMSelOp>(builder.getUnknownLoc(), arbiterID, msel);
-          amselOps[i] = amsel;
-        }
-      }
-      // Create all the master set Ops
-      // First collect the master sets for this tile.
-      SmallVector<Port, 4> tileMasters;
-      for (const auto &map : mastersets) {
-        if (tileOp != map.first.first)
-          continue;
-        tileMasters.push_back(map.first.second);
+    }
+    // Create all the amsel Ops
+    DenseMap<int, AMSelOp> amselOps;
+    for (int i = 0; i < 32; i++) {
+      if (amselOpNeededVector[i]) {
+        int arbiterID = i % numArbiters;
+        int msel = i / numArbiters;
+        auto amsel =
+            builder.create<AMSelOp>(builder.getUnknownLoc(), arbiterID, msel);
+        amselOps[i] = amsel;
       }
-      // Sort them so we get a reasonable order
-      std::sort(tileMasters.begin(), tileMasters.end());
-      for (auto tileMaster : tileMasters) {
-        WireBundle bundle = tileMaster.bundle;
-        int channel = tileMaster.channel;
-        SmallVector<int, 4> msels = mastersets[{tileOp, tileMaster}];
-        SmallVector<Value, 4> amsels;
-        for (auto msel : msels) {
-          assert(amselOps.count(msel) == 1);
-          amsels.push_back(amselOps[msel]);
-        }
-
-        auto msOp = builder.create<MasterSetOp>(builder.getUnknownLoc(),
-                                                builder.getIndexType(), bundle,
-                                                channel, amsels);
-        if (auto pktFlowAttrs = keepPktHeaderAttr[{tileOp, tileMaster}])
-          msOp->setAttr("keep_pkt_header", pktFlowAttrs);
+    }
+    // Create all the master set Ops
+    // First collect the master sets for this tile.
+    SmallVector<Port, 4> tileMasters;
+    for (const auto &map : mastersets) {
+      if (tileOp != map.first.first)
+        continue;
+      tileMasters.push_back(map.first.second);
+    }
+    // Sort them so we get a reasonable order
+    std::sort(tileMasters.begin(), tileMasters.end());
+    for (auto tileMaster : tileMasters) {
+      WireBundle bundle = tileMaster.bundle;
+      int channel = tileMaster.channel;
+      SmallVector<int, 4> msels = mastersets[{tileOp, tileMaster}];
+      SmallVector<Value, 4> amsels;
+      for (auto msel : msels) {
+        assert(amselOps.count(msel) == 1);
+        amsels.push_back(amselOps[msel]);
       }
 
-      // Generate the packet rules
-      DenseMap<Port, PacketRulesOp> slaveRules;
-      for (auto group : slaveGroups) {
-        builder.setInsertionPoint(b.getTerminator());
+      auto msOp = builder.create<MasterSetOp>(builder.getUnknownLoc(),
+                                              builder.getIndexType(), bundle,
+                                              channel, amsels);
+      if (keepPktHeaderPorts.count({tile.getTileID(), tileMaster}))
+        msOp->setAttr("keep_pkt_header",
+                      StringAttr::get(msOp->getContext(), "true"));
+    }
 
-        auto port = group.front().first;
-        if (tileOp != port.first)
-          continue;
+    // Generate the packet rules
+    DenseMap<Port, PacketRulesOp> slaveRules;
+    for (auto [group, rules, amselValue] :
+         llvm::zip(slaveGroups, groupRules, groupAMSels)) {
+      builder.setInsertionPoint(b.getTerminator());
 
-        WireBundle bundle = port.second.bundle;
-        int channel = port.second.channel;
-        auto slave = port.second;
+      auto port = group.front().first;
+      if (tileOp != port.first)
+        continue;
 
-        int mask = slaveMasks[group.front()];
-        int ID = group.front().second & mask;
+      WireBundle bundle = port.second.bundle;
+      int channel = port.second.channel;
+      auto slave = port.second;
 
-        // Verify that we actually map all the ID's correctly.
+      // Verify that we actually map all the ID's correctly.
 #ifndef NDEBUG
-        for (auto slave : group)
-          assert((slave.second & mask) == ID);
+      for (auto slave : group)
+        assert(llvm::any_of(rules, [&](PacketRuleCube rule) {
+          return (slave.second & rule.mask) == rule.value;
+        }));
 #endif
-        Value amsel = amselOps[slaveAMSels[group.front()]];
-
-        PacketRulesOp packetrules;
-        if (slaveRules.count(slave) == 0) {
-          packetrules = builder.create<PacketRulesOp>(builder.getUnknownLoc(),
-                                                      bundle, channel);
-          PacketRulesOp::ensureTerminator(packetrules.getRules(), builder,
-                                          builder.getUnknownLoc());
-          slaveRules[slave] = packetrules;
-        } else
-          packetrules = slaveRules[slave];
+      Value amsel = amselOps[amselValue];
+
+      PacketRulesOp packetrules;
+      if (slaveRules.count(slave) == 0) {
+        packetrules = builder.create<PacketRulesOp>(builder.getUnknownLoc(),
+                                                    bundle, channel);
+        PacketRulesOp::ensureTerminator(packetrules.getRules(), builder,
+                                        builder.getUnknownLoc());
+        slaveRules[slave] = packetrules;
+      } else
+        packetrules = slaveRules[slave];
+
+      Block &rules = packetrules.getRules().front();
+      builder.setInsertionPoint(rules.getTerminator());
+      for (PacketRuleCube rule : rules)
+        builder.create<PacketRuleOp>(builder.getUnknownLoc(), rule.mask,
+                                     rule.value, amsel);
+    }
+  }
 
-        Block &rules = packetrules.getRules().front();
-        builder.setInsertionPoint(rules.getTerminator());
-        builder.create<PacketRuleOp>(builder.getUnknownLoc(), mask, ID, amsel);
+  // Add support for shimDMA
+  // From shimDMA to BLI: 1) shimDMA 0 --> North 3
+  //                      2) shimDMA 1 --> North 7
+  // From BLI to shimDMA: 1) North   2 --> shimDMA 0
+  //                      2) North   3 --> shimDMA 1
+
+  for (auto switchbox : make_early_inc_range(device.getOps<SwitchboxOp>())) {
+    auto retVal = switchbox->getOperand(0);
+    auto tileOp = retVal.getDefiningOp<TileOp>();
+
+    // Check if it is a shim Tile
+    if (!tileOp.isShimNOCTile())
+      continue;
+
+    // Check if the switchbox is empty
+    if (&switchbox.getBody()->front() == switchbox.getBody()->getTerminator())
+      continue;
+
+    Region &r = switchbox.getConnections();
+    Block &b = r.front();
+
+    // Find if the corresponding shimmux exsists or not
+    int shimExist = 0;
+    ShimMuxOp shimOp;
+    for (auto shimmux : device.getOps<ShimMuxOp>()) {
+      if (shimmux.getTile() == tileOp) {
+        shimExist = 1;
+        shimOp = shimmux;
+        break;
       }
     }
 
-    // Add support for shimDMA
-    // From shimDMA to BLI: 1) shimDMA 0 --> North 3
-    //                      2) shimDMA 1 --> North 7
-    // From BLI to shimDMA: 1) North   2 --> shimDMA 0
-    //                      2) North   3 --> shimDMA 1
+    for (Operation &Op : b.getOperations()) {
+      if (auto pktrules = dyn_cast<PacketRulesOp>(Op)) {
+
+        // check if there is MM2S DMA in the switchbox of the 0th row
+        if (pktrules.getSourceBundle() == WireBundle::DMA) {
+
+          // If there is, then it should be put into the corresponding shimmux
+          // If shimmux not defined then create shimmux
+          if (!shimExist) {
+            builder.setInsertionPointAfter(tileOp);
+            shimOp = builder.create<ShimMuxOp>(builder.getUnknownLoc(), tileOp);
+            Region &r1 = shimOp.getConnections();
+            Block *b1 = builder.createBlock(&r1);
+            builder.setInsertionPointToEnd(b1);
+            builder.create<EndOp>(builder.getUnknownLoc());
+            shimExist = 1;
+          }
 
-    for (auto switchbox : make_early_inc_range(device.getOps<SwitchboxOp>())) {
-      auto retVal = switchbox->getOperand(0);
-      auto tileOp = retVal.getDefiningOp<TileOp>();
+          Region &r0 = shimOp.getConnections();
+          Block &b0 = r0.front();
+          builder.setInsertionPointToStart(&b0);
+
+          pktrules->removeAttr("sourceBundle");
+          pktrules->setAttr("sourceBundle",
+                            builder.getI32IntegerAttr(3)); // WireBundle::South
+          if (pktrules.getSourceChannel() == 0) {
+            pktrules->removeAttr("sourceChannel");
+            pktrules->setAttr("sourceChannel",
+                              builder.getI32IntegerAttr(3)); // Channel 3
+            builder.create<ConnectOp>(builder.getUnknownLoc(), WireBundle::DMA,
+                                      0, WireBundle::North, 3);
+          }
+          if (pktrules.getSourceChannel() == 1) {
+            pktrules->removeAttr("sourceChannel");
+            pktrules->setAttr("sourceChannel",
+                              builder.getI32IntegerAttr(7)); // Channel 7
+            builder.create<ConnectOp>(builder.getUnknownLoc(), WireBundle::DMA,
+                                      1, WireBundle::North, 7);
+          }
+        }
+      }
 
-      // Check if it is a shim Tile
-      if (!tileOp.isShimNOCTile())
-        continue;
+      if (auto mtset = dyn_cast<MasterSetOp>(Op)) {
+
+        // check if there is S2MM DMA in the switchbox of the 0th row
+        if (mtset.getDestBundle() == WireBundle::DMA) {
+
+          // If there is, then it should be put into the corresponding shimmux
+          // If shimmux not defined then create shimmux
+          if (!shimExist) {
+            builder.setInsertionPointAfter(tileOp);
+            shimOp = builder.create<ShimMuxOp>(builder.getUnknownLoc(), tileOp);
+            Region &r1 = shimOp.getConnections();
+            Block *b1 = builder.createBlock(&r1);
+            builder.setInsertionPointToEnd(b1);
+            builder.create<EndOp>(builder.getUnknownLoc());
+            shimExist = 1;
+          }
 
-      // Check if the switchbox is empty
-      if (&switchbox.getBody()->front() == switchbox.getBody()->getTerminator())
-        continue;
+          Region &r0 = shimOp.getConnections();
+          Block &b0 = r0.front();
+          builder.setInsertionPointToStart(&b0);
+
+          mtset->removeAttr("destBundle");
+          mtset->setAttr("destBundle",
+                         builder.getI32IntegerAttr(3)); // WireBundle::South
+          if (mtset.getDestChannel() == 0) {
+            mtset->removeAttr("destChannel");
+            mtset->setAttr("destChannel",
+                           builder.getI32IntegerAttr(2)); // Channel 2
+            builder.create<ConnectOp>(builder.getUnknownLoc(),
+                                      WireBundle::North, 2, WireBundle::DMA, 0);
+          }
+          if (mtset.getDestChannel() == 1) {
+            mtset->removeAttr("destChannel");
+            mtset->setAttr("destChannel",
+                           builder.getI32IntegerAttr(3)); // Channel 3
+            builder.create<ConnectOp>(builder.getUnknownLoc(),
+                                      WireBundle::North, 3, WireBundle::DMA, 1);
+          }
+        }
+      }
+    }
+  }
+  return success();
+}
 
-      Region &r = switchbox.getConnections();
-      Block &b = r.front();
+struct AIERoutePacketFlowsPass
+    : AIERoutePacketFlowsBase<AIERoutePacketFlowsPass> {
+  const int maxIterations = 1000; // how long until declared unroutable
+
+  // Route all the packet flows together with Pathfinder, around the
+  // connections of existing switchboxes, and record the routes in the given
+  // map of switchboxes.
+  LogicalResult routeWithPathfinder(
+      DeviceOp device, PacketSwitchboxConnections &switchboxes) {
+    int maxCol = 0, maxRow = 0;
+    for (TileOp tileOp : device.getOps<TileOp>()) {
+      maxCol = std::max(maxCol, tileOp.colIndex());
+      maxRow = std::max(maxRow, tileOp.rowIndex());
+    }
+    Pathfinder pathfinder;
+    pathfinder.initialize(maxCol, maxRow, device.getTargetModel());
 
-      // Find if the corresponding shimmux exsists or not
-      int shimExist = 0;
-      ShimMuxOp shimOp;
-      for (auto shimmux : device.getOps<ShimMuxOp>()) {
-        if (shimmux.getTile() == tileOp) {
-          shimExist = 1;
-          shimOp = shimmux;
-          break;
+    for (auto pktflow : device.getOps<PacketFlowOp>()) {
+      int flowID = pktflow.IDInt();
+      TileID srcCoords = {0, 0};
+      Port sourcePort;
+      for (Operation &Op : pktflow.getPorts().front().getOperations()) {
+        if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
+          srcCoords = pktSource.getTile().getDefiningOp<TileOp>().getTileID();
+          sourcePort = pktSource.port();
+        } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
+          TileID destCoords =
+              pktDest.getTile().getDefiningOp<TileOp>().getTileID();
+          pathfinder.addPacketFlow(srcCoords, sourcePort, destCoords,
+                                   pktDest.port(), flowID);
+        }
+      }
+    }
+
+    for (SwitchboxOp switchboxOp : device.getOps<SwitchboxOp>())
+      for (ConnectOp connectOp : switchboxOp.getOps<ConnectOp>())
+        if (!pathfinder.addFixedConnection(connectOp))
+          return switchboxOp.emitOpError() << "Couldn't connect " << connectOp;
+
+    if (!pathfinder.findPaths(maxIterations))
+      return device.emitError("Unable to find a legal routing");
+    numIterations = pathfinder.getStats().iterations;
+    numChannelsUsed = pathfinder.getStats().channelsUsed;
+
+    for (const auto &[flow, settings] : pathfinder.getPacketFlowSolutions()) {
+      int flowID = flow.second;
+      for (const auto &[sb, setting] : settings) {
+        auto &connects = switchboxes[sb];
+        for (Port dest : setting.dsts) {
+          std::pair<Connect, int> connect = {{setting.src, dest}, flowID};
+          if (!llvm::is_contained(connects, connect))
+            connects.push_back(connect);
         }
       }
+    }
+    return success();
+  }
+
+  void runOnOperation() override {
+
+    DeviceOp device = getOperation();
+    OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
+
+    ConversionTarget target(getContext());
+
+    // Some communication patterns:
+    //  - one-to-one
+    //  - one-to-many
+    //    + same flow (same port, same ID): broadcast/multicast
+    //    + different flows (same port, differnt IDs)
+    //  - many-to-one
+    //    + timeshare: single arbiter, different msels
+    //  - many-to-many
+    //
+    // Compute the mask for each LUT entry of a slave port
+    // Aim to generate as few LUT entries as possible
+
+    // Avoid creating packetswitch config as much as possible
+    // We will use circuit-switch to pre-route the flows from the source swboxes
+    // to the dest swboxes, and only use packet-switch to route at the dest
+    // swboxes
+
+    // Master ports whose packets keep their header
+    std::set<std::pair<TileID, Port>> keepPktHeaderPorts;
+
+    // The logical model of all the switchboxes.
+    PacketSwitchboxConnections switchboxes;
+    if (usePathfinder && failed(routeWithPathfinder(device, switchboxes)))
+      return signalPassFailure();
+    for (auto pktflow : device.getOps<PacketFlowOp>()) {
+      Region &r = pktflow.getPorts();
+      Block &b = r.front();
+      int flowID = pktflow.IDInt();
+      int xSrc = 0, ySrc = 0;
+      Port sourcePort;
 
       for (Operation &Op : b.getOperations()) {
-        if (auto pktrules = dyn_cast<PacketRulesOp>(Op)) {
-
-          // check if there is MM2S DMA in the switchbox of the 0th row
-          if (pktrules.getSourceBundle() == WireBundle::DMA) {
-
-            // If there is, then it should be put into the corresponding shimmux
-            // If shimmux not defined then create shimmux
-            if (!shimExist) {
-              builder.setInsertionPointAfter(tileOp);
-              shimOp =
-                  builder.create<ShimMuxOp>(builder.getUnknownLoc(), tileOp);
-              Region &r1 = shimOp.getConnections();
-              Block *b1 = builder.createBlock(&r1);
-              builder.setInsertionPointToEnd(b1);
-              builder.create<EndOp>(builder.getUnknownLoc());
-              shimExist = 1;
-            }
-
-            Region &r0 = shimOp.getConnections();
-            Block &b0 = r0.front();
-            builder.setInsertionPointToStart(&b0);
-
-            pktrules->removeAttr("sourceBundle");
-            pktrules->setAttr(
-                "sourceBundle",
-                builder.getI32IntegerAttr(3)); // WireBundle::South
-            if (pktrules.getSourceChannel() == 0) {
-              pktrules->removeAttr("sourceChannel");
-              pktrules->setAttr("sourceChannel",
-                                builder.getI32IntegerAttr(3)); // Channel 3
-              builder.create<ConnectOp>(builder.getUnknownLoc(),
-                                        WireBundle::DMA, 0, WireBundle::North,
-                                        3);
-            }
-            if (pktrules.getSourceChannel() == 1) {
-              pktrules->removeAttr("sourceChannel");
-              pktrules->setAttr("sourceChannel",
-                                builder.getI32IntegerAttr(7)); // Channel 7
-              builder.create<ConnectOp>(builder.getUnknownLoc(),
-                                        WireBundle::DMA, 1, WireBundle::North,
-                                        7);
-            }
-          }
-        }
+        if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
+          auto srcTile = dyn_cast<TileOp>(pktSource.getTile().getDefiningOp());
+          xSrc = srcTile.colIndex();
+          ySrc = srcTile.rowIndex();
+          sourcePort = pktSource.port();
+        } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
+          auto destTile = dyn_cast<TileOp>(pktDest.getTile().getDefiningOp());
+          int xDest = destTile.colIndex();
+          int yDest = destTile.rowIndex();
+          Port destPort = pktDest.port();
 
-        if (auto mtset = dyn_cast<MasterSetOp>(Op)) {
-
-          // check if there is S2MM DMA in the switchbox of the 0th row
-          if (mtset.getDestBundle() == WireBundle::DMA) {
-
-            // If there is, then it should be put into the corresponding shimmux
-            // If shimmux not defined then create shimmux
-            if (!shimExist) {
-              builder.setInsertionPointAfter(tileOp);
-              shimOp =
-                  builder.create<ShimMuxOp>(builder.getUnknownLoc(), tileOp);
-              Region &r1 = shimOp.getConnections();
-              Block *b1 = builder.createBlock(&r1);
-              builder.setInsertionPointToEnd(b1);
-              builder.create<EndOp>(builder.getUnknownLoc());
-              shimExist = 1;
-            }
-
-            Region &r0 = shimOp.getConnections();
-            Block &b0 = r0.front();
-            builder.setInsertionPointToStart(&b0);
-
-            mtset->removeAttr("destBundle");
-            mtset->setAttr("destBundle",
-                           builder.getI32IntegerAttr(3)); // WireBundle::South
-            if (mtset.getDestChannel() == 0) {
-              mtset->removeAttr("destChannel");
-              mtset->setAttr("destChannel",
-                             builder.getI32IntegerAttr(2)); // Channel 2
-              builder.create<ConnectOp>(builder.getUnknownLoc(),
-                                        WireBundle::North, 2, WireBundle::DMA,
-                                        0);
-            }
-            if (mtset.getDestChannel() == 1) {
-              mtset->removeAttr("destChannel");
-              mtset->setAttr("destChannel",
-                             builder.getI32IntegerAttr(3)); // Channel 3
-              builder.create<ConnectOp>(builder.getUnknownLoc(),
-                                        WireBundle::North, 3, WireBundle::DMA,
-                                        1);
-            }
-          }
+          if (!usePathfinder)
+            buildPSRoute(xSrc, ySrc, sourcePort, xDest, yDest, destPort,
+                         flowID, switchboxes, true);
+
+          // Assign "keep_pkt_header flag"
+          if (pktflow->hasAttr("keep_pkt_header"))
+            keepPktHeaderPorts.insert({destTile.getTileID(), destPort});
         }
       }
     }
 
+    // Every tile gets a switchbox, even those no packet flow goes through.
+    for (auto tile : llvm::to_vector(device.getOps<TileOp>())) {
+      builder.setInsertionPointAfter(tile);
+      SwitchboxOp swbox = getOrCreateSwitchbox(builder, tile);
+      SwitchboxOp::ensureTerminator(swbox.getConnections(), builder,
+                                    builder.getUnknownLoc());
+    }
+
+    int numRules = 0, numReassigned = 0;
+    if (failed(buildPacketSwitchboxes(device, switchboxes, keepPktHeaderPorts,
+                                      reassignIDs, numRules, numReassigned)))
+      return signalPassFailure();
+    numPacketRules += numRules;
+    numIDsReassigned += numReassigned;
+
     RewritePatternSet patterns(&getContext());
     patterns.add<AIEOpRemoval<PacketFlowOp>>(device.getContext());
 
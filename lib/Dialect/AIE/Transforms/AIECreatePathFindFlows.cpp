@@ -17,7 +17,9 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Tools/mlir-translate/MlirTranslateMain.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FormatVariadic.h"
 
 using namespace mlir;
 using namespace xilinx;
@@ -186,6 +188,167 @@ struct ConvertFlowsToInterconnect : OpConversionPattern<FlowOp> {
   }
 };
 
+// Collect in `freeIDs` the packet IDs not used by the aie.packet_flow
+// operations of `device` or matched by the packet rules already in it.
+LogicalResult getFreePacketIDs(DeviceOp device, std::vector<int> &freeIDs) {
+  std::vector<bool> used(32, false);
+  for (auto pktFlowOp : device.getOps<PacketFlowOp>()) {
+    int id = pktFlowOp.IDInt();
+    if (id < 0 || id >= static_cast<int>(used.size()))
+      return pktFlowOp.emitOpError("packet ID ")
+             << id << " does not fit in 5 bits";
+    used[id] = true;
+  }
+  device.walk([&](PacketRuleOp ruleOp) {
+    for (int id = 0; id < static_cast<int>(used.size()); id++)
+      if ((id & ruleOp.maskInt()) == ruleOp.valueInt())
+        used[id] = true;
+  });
+  for (int id = 0; id < static_cast<int>(used.size()); id++)
+    if (!used[id])
+      freeIDs.push_back(id);
+  return success();
+}
+
+// The blocks holding the BDs of each MM2S channel of the DMAs of `device`,
+// keyed by the channel as a flow source. Channels without BDs are left out.
+std::map<PathEndPoint, SmallVector<Block *>> getSendBDs(DeviceOp device) {
+  std::map<PathEndPoint, SmallVector<Block *>> sendBDs;
+  for (Operation &op : device.getOps()) {
+    if (!isa<MemOp, MemTileDMAOp, ShimDMAOp>(&op))
+      continue;
+    TileID tile = cast<TileElement>(&op).getTileID();
+    auto addBDs = [&](int channel, ArrayRef<Block *> blocks) {
+      for (Block *block : blocks)
+        if (!block->getOps<DMABDOp>().empty())
+          sendBDs[{{tile.col, tile.row}, {WireBundle::DMA, channel}}]
+              .push_back(block);
+    };
+    for (auto dmaStart : op.getRegion(0).getOps<DMAStartOp>()) {
+      if (!dmaStart.isSend())
+        continue;
+      // the BDs of a channel are the blocks reachable from its dma_start
+      SetVector<Block *> reachable;
+      reachable.insert(dmaStart.getDest());
+      for (size_t i = 0; i < reachable.size(); i++)
+        if (!reachable[i]->empty())
+          for (Block *next : reachable[i]->getTerminator()->getSuccessors())
+            reachable.insert(next);
+      addBDs(dmaStart.getChannelIndex(), reachable.getArrayRef());
+    }
+    for (auto dma : op.getRegion(0).getOps<DMAOp>()) {
+      if (dma.getChannelDir() != DMAChannelDir::MM2S)
+        continue;
+      SmallVector<Block *> blocks;
+      for (Region &bd : dma.getBds())
+        for (Block &block : bd)
+          blocks.push_back(&block);
+      addBDs(dma.getChannelIndex(), blocks);
+    }
+  }
+  return sendBDs;
+}
+
+// The sources whose flows the router may demote to packet flows: DMA
+// channels with BDs that do not send packet headers already, so that they can
+// be made to send the header of the new packet flow.
+std::set<PathEndPoint> getPacketFallbackSources(
+    const std::map<PathEndPoint, SmallVector<Block *>> &sendBDs) {
+  std::set<PathEndPoint> sources;
+  for (const auto &[src, blocks] : sendBDs)
+    if (llvm::none_of(blocks, [](Block *block) {
+          return !block->getOps<DMABDPACKETOp>().empty();
+        }))
+      sources.insert(src);
+  return sources;
+}
+
+// Name the flows that the router found congested but could not demote, since
+// their source cannot send packet headers.
+void remarkUndemotableFlows(DeviceOp device, const Pathfinder &pathfinder) {
+  const std::set<PathEndPoint> &undemotable =
+      pathfinder.getUndemotableSources();
+  for (FlowOp flowOp : device.getOps<FlowOp>()) {
+    auto srcTile = cast<TileOp>(flowOp.getSource().getDefiningOp());
+    PathEndPoint srcPoint = {{srcTile.colIndex(), srcTile.rowIndex()},
+                             {flowOp.getSourceBundle(),
+                              flowOp.getSourceChannel()}};
+    if (undemotable.count(srcPoint))
+      flowOp.emitRemark("was congested but could not become a packet flow: "
+                        "only DMA channels with BDs can send a packet header");
+  }
+}
+
+// Erase the aie.flow operations that the router demoted to packet-switched
+// flows with the packet IDs in `fallbackIDs`, and make every BD of their
+// source send the header of the new packet flow.
+void lowerDemotedFlows(
+    DeviceOp device, const Pathfinder &pathfinder, ArrayRef<int> fallbackIDs,
+    const std::map<PathEndPoint, SmallVector<Block *>> &sendBDs) {
+  std::map<PathEndPoint, int> demoted;
+  for (const auto &[key, settings] : pathfinder.getPacketFlowSolutions())
+    if (llvm::is_contained(fallbackIDs, key.second))
+      demoted[key.first] = key.second;
+  for (FlowOp flowOp : llvm::make_early_inc_range(device.getOps<FlowOp>())) {
+    auto srcTile = cast<TileOp>(flowOp.getSource().getDefiningOp());
+    PathEndPoint srcPoint = {{srcTile.colIndex(), srcTile.rowIndex()},
+                             {flowOp.getSourceBundle(),
+                              flowOp.getSourceChannel()}};
+    if (demoted.count(srcPoint))
+      flowOp.erase();
+  }
+  for (const auto &[src, id] : demoted)
+    for (Block *block : sendBDs.at(src)) {
+      DMABDOp bd = *block->getOps<DMABDOp>().begin();
+      OpBuilder builder(bd);
+      builder.create<DMABDPACKETOp>(bd.getLoc(), builder.getI32IntegerAttr(0),
+                                    builder.getI32IntegerAttr(id));
+    }
+}
+
+// Configure the switchboxes of `device` for the packet-switched routes the
+// router found, for the demoted flows and the aie.packet_flow operations
+// alike, and erase the aie.packet_flow operations.
+LogicalResult buildPacketFlows(DeviceOp device, DynamicTileAnalysis &analyzer,
+                               const Pathfinder &pathfinder) {
+  OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
+  PacketSwitchboxConnections switchboxes;
+  for (const auto &[flow, settings] : pathfinder.getPacketFlowSolutions()) {
+    int flowID = flow.second;
+    for (const auto &[sb, setting] : settings) {
+      // make the switchbox known to the analysis, which wires it up
+      analyzer.getSwitchbox(builder, sb.col, sb.row);
+      auto &connects = switchboxes[sb];
+      for (Port dest : setting.dsts) {
+        std::pair<Connect, int> connect = {{setting.src, dest}, flowID};
+        if (!llvm::is_contained(connects, connect))
+          connects.push_back(connect);
+      }
+    }
+  }
+
+  std::set<std::pair<TileID, Port>> keepPktHeaderPorts;
+  for (auto pktFlowOp : device.getOps<PacketFlowOp>())
+    if (pktFlowOp->hasAttr("keep_pkt_header"))
+      for (auto pktDest : pktFlowOp.getPorts().getOps<PacketDestOp>())
+        keepPktHeaderPorts.insert(
+            {pktDest.getTile().getDefiningOp<TileOp>().getTileID(),
+             pktDest.port()});
+
+  int numPacketRules = 0, numIDsReassigned = 0;
+  if (failed(buildPacketSwitchboxes(device, switchboxes, keepPktHeaderPorts,
+                                    /*reassignIDs=*/false, numPacketRules,
+                                    numIDsReassigned)))
+    return failure();
+  for (auto pktFlowOp :
+       llvm::make_early_inc_range(device.getOps<PacketFlowOp>()))
+    pktFlowOp.erase();
+  // shim DMA packet ports go through a shim mux, which may be new
+  for (auto shimMux : device.getOps<ShimMuxOp>())
+    analyzer.coordToShimMux.try_emplace({shimMux.colIndex(), 0}, shimMux);
+  return success();
+}
+
 } // namespace
 
 namespace xilinx::AIE {
@@ -196,8 +359,51 @@ void AIEPathfinderPass::runOnOperation() {
   LLVM_DEBUG(llvm::dbgs() << "---Begin AIEPathfinderPass---\n");
 
   DeviceOp d = getOperation();
-  if (failed(analyzer.runAnalysis(d)))
+  std::shared_ptr<Pathfinder> pathfinder;
+  // the BDs of the DMA channels whose flows may become packet flows
+  std::map<PathEndPoint, SmallVector<Block *>> sendBDs;
+  if (!hasCustomRouter) {
+    PathfinderOptions options;
+    options.fanoutAware = fanoutAware;
+    options.incremental = incremental;
+    options.parallelBatchSize = parallelBatchSize;
+    options.context = &getContext();
+    options.aStarMaxDestinations = aStarMaxDestinations;
+    if (packetFallback) {
+      if (failed(getFreePacketIDs(d, options.packetFallbackIDs)))
+        return signalPassFailure();
+      sendBDs = getSendBDs(d);
+      options.packetFallbackSources = getPacketFallbackSources(sendBDs);
+      analyzer.routePacketFlows = true;
+    }
+    pathfinder = std::make_shared<Pathfinder>(options);
+    analyzer.pathfinder = pathfinder;
+    // the cache only holds circuit-switched routes
+    analyzer.cacheDir = packetFallback ? "" : routingCacheDir;
+    analyzer.routerConfig =
+        llvm::formatv("pathfinder fanout-aware={0} incremental={1} "
+                      "parallel-batch-size={2} astar-max-destinations={3}",
+                      options.fanoutAware, options.incremental,
+                      options.parallelBatchSize, options.aStarMaxDestinations)
+            .str();
+  }
+  LogicalResult routed = analyzer.runAnalysis(d);
+  if (pathfinder && packetFallback && !analyzer.loadedFromCache)
+    remarkUndemotableFlows(d, *pathfinder);
+  if (failed(routed))
     return signalPassFailure();
+  if (pathfinder && !analyzer.loadedFromCache) {
+    numIterations = pathfinder->getStats().iterations;
+    numDijkstraCalls = pathfinder->getStats().dijkstraCalls;
+    numNodesExpanded = pathfinder->getStats().nodesExpanded;
+    numChannelsUsed = pathfinder->getStats().channelsUsed;
+    numSourceRootedChannelsUsed =
+        pathfinder->getStats().sourceRootedChannelsUsed;
+    numFlowsDemoted = pathfinder->getStats().flowsDemoted;
+    if (packetFallback)
+      lowerDemotedFlows(d, *pathfinder,
+                        pathfinder->getOptions().packetFallbackIDs, sendBDs);
+  }
   OpBuilder builder = OpBuilder::atBlockEnd(d.getBody());
 
   // Apply rewrite rule to switchboxes to add assignments to every 'connect'
@@ -214,6 +420,10 @@ void AIEPathfinderPass::runOnOperation() {
   if (failed(applyPartialConversion(d, target, std::move(patterns))))
     return signalPassFailure();
 
+  if (pathfinder && packetFallback &&
+      failed(buildPacketFlows(d, analyzer, *pathfinder)))
+    return signalPassFailure();
+
   // Populate wires between switchboxes and tiles.
   for (int col = 0; col <= analyzer.getMaxCol(); col++) {
     for (int row = 0; row <= analyzer.getMaxRow(); row++) {
@@ -441,4 +651,11 @@ std::unique_ptr<OperationPass<DeviceOp>> createAIEPathfinderPass() {
   return std::make_unique<AIEPathfinderPass>();
 }
 
+std::unique_ptr<OperationPass<DeviceOp>>
+createAIEPathfinderPass(const std::string &routingCacheDir) {
+  auto pass = std::make_unique<AIEPathfinderPass>();
+  pass->routingCacheDir = routingCacheDir;
+  return pass;
+}
+
 } // namespace xilinx::AIE
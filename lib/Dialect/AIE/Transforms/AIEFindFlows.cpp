@@ -246,7 +246,7 @@ static void findFlowsFrom(TileOp op, ConnectivityAnalysis &analysis,
         if (maskValue.mask == 0) {
           rewriter.create<FlowOp>(Op->getLoc(), Op->getResult(0), bundle, i,
                                   destOp->getResult(0), destPort.bundle,
-                                  destPort.channel);
+                                  destPort.channel, nullptr);
         } else {
           auto flowOp =
               rewriter.create<PacketFlowOp>(Op->getLoc(), maskValue.value);
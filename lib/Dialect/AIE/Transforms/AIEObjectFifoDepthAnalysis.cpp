@@ -0,0 +1,279 @@
+//===- AIEObjectFifoDepthAnalysis.cpp ---------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIE/Transforms/AIEPasses.h"
+
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/Pass/Pass.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <map>
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIE;
+
+#define DEBUG_TYPE "aie-objectFifo-depth"
+
+namespace {
+
+// How a process on one end of an objectFifo uses it.
+struct Endpoint {
+  TileOp tile;
+  // The most objects the process holds in one iteration: the largest
+  // acquire of a core, as acquires count the objects held rather than add to
+  // them, or a single object for a DMA.
+  int hold = 0;
+  bool hasCore = false;
+  // Objects released by one run of the core, std::nullopt if a loop trip
+  // count is not a constant.
+  std::optional<uint64_t> objects;
+};
+
+// The number of iterations of `forOp`, std::nullopt if it is not constant.
+std::optional<uint64_t> getTripCount(scf::ForOp forOp) {
+  auto lb = getConstantIntValue(forOp.getLowerBound());
+  auto ub = getConstantIntValue(forOp.getUpperBound());
+  auto step = getConstantIntValue(forOp.getStep());
+  if (!lb || !ub || !step || *step <= 0)
+    return std::nullopt;
+  if (*ub <= *lb)
+    return 0;
+  return llvm::divideCeil(*ub - *lb, *step);
+}
+
+// The number of times `op` runs per run of its core.
+std::optional<uint64_t> getRunCount(Operation *op) {
+  uint64_t count = 1;
+  for (auto forOp = op->getParentOfType<scf::ForOp>(); forOp;
+       forOp = forOp->getParentOfType<scf::ForOp>()) {
+    auto tripCount = getTripCount(forOp);
+    if (!tripCount)
+      return std::nullopt;
+    count = llvm::SaturatingMultiply(count, *tripCount);
+  }
+  return count;
+}
+
+uint64_t getElementBytes(ObjectFifoCreateOp op) {
+  auto memref = op.getElemType()
+                    .cast<AIEObjectFifoType>()
+                    .getElementType()
+                    .cast<MemRefType>();
+  return memref.getNumElements() * memref.getElementTypeBitWidth() / 8;
+}
+
+} // namespace
+
+struct AIEObjectFifoDepthAnalysisPass
+    : AIEObjectFifoDepthAnalysisBase<AIEObjectFifoDepthAnalysisPass> {
+
+  // Analyse the processes using `op` from `port` on `tile`.
+  Endpoint analyseEndpoint(DeviceOp device, ObjectFifoCreateOp op,
+                           ObjectFifoPort port, TileOp tile) {
+    Endpoint endpoint;
+    endpoint.tile = tile;
+    endpoint.objects = 0;
+    for (auto coreOp : device.getOps<CoreOp>()) {
+      if (coreOp.getTileOp() != tile)
+        continue;
+      coreOp.walk([&](Operation *nested) {
+        if (auto acqOp = dyn_cast<ObjectFifoAcquireOp>(nested);
+            acqOp && acqOp.getObjectFifo() == op &&
+            acqOp.getPortValue() == port) {
+          endpoint.hasCore = true;
+          endpoint.hold = std::max(endpoint.hold, acqOp.acqNumber());
+        } else if (auto relOp = dyn_cast<ObjectFifoReleaseOp>(nested);
+                   relOp && relOp.getObjectFifo() == op &&
+                   relOp.getPortValue() == port && endpoint.objects) {
+          if (auto count = getRunCount(relOp))
+            *endpoint.objects += llvm::SaturatingMultiply(
+                *count, static_cast<uint64_t>(relOp.relNumber()));
+          else
+            endpoint.objects = std::nullopt;
+        }
+      });
+    }
+    if (!endpoint.hasCore) {
+      endpoint.objects = std::nullopt;
+      // Only shim and memtiles are accessed by DMAs alone.
+      if (tile.isShimTile() || tile.isMemTile())
+        endpoint.hold = 1;
+    }
+    return endpoint;
+  }
+
+  // The tile of the single pool of objects shared by adjacent tiles that
+  // `op` is lowered to, or a null tile if it is lowered to a pool per tile
+  // connected by DMAs. Mirrors the choice of the objectFifo stateful
+  // transform.
+  TileOp getSharedMemoryTile(ObjectFifoCreateOp op) {
+    if (op.getConsumerTiles().size() != 1 ||
+        !op.getDimensionsToStream().empty())
+      return {};
+    for (BDDimLayoutArrayAttr dims : op.getDimensionsFromStreamPerConsumer())
+      if (!dims.empty())
+        return {};
+    TileOp a = op.getProducerTileOp();
+    auto b = cast<TileOp>(op.getConsumerTiles()[0].getDefiningOp());
+    if (a.isShimTile() || b.isShimTile() || a.isMemTile() || b.isMemTile())
+      return {};
+    const auto &targetModel = getTargetModel(op);
+    if (targetModel.isLegalMemAffinity(b.colIndex(), b.rowIndex(),
+                                       a.colIndex(), a.rowIndex()))
+      return a;
+    if (targetModel.isLegalMemAffinity(a.colIndex(), a.rowIndex(),
+                                       b.colIndex(), b.rowIndex()))
+      return b;
+    return {};
+  }
+
+  // The objects the objectFifo stateful transform allocates for `endpoint`
+  // when the objectFifo is split and has the given depth. As in its
+  // findObjectFifoSize, a core that acquires the objectFifo gets one more
+  // object than its largest acquire whatever the depth, and only memtiles
+  // and tiles accessed by DMAs alone are sized by the depth.
+  static int getPoolSize(const Endpoint &endpoint, int depth) {
+    if (endpoint.tile.isMemTile() || !endpoint.hasCore)
+      return depth;
+    if (endpoint.hold == 1 && depth == 1)
+      return 1;
+    return endpoint.hold + 1;
+  }
+
+  // The objects allocated in each tile when `op` has the given depth, as
+  // the objectFifo stateful transform sizes its pools.
+  std::map<TileID, int> getPools(TileOp sharedTile, const Endpoint &producer,
+                                 ArrayRef<Endpoint> consumers, int depth) {
+    std::map<TileID, int> pools;
+    if (sharedTile) {
+      pools[sharedTile.getTileID()] += depth;
+      return pools;
+    }
+    if (!producer.tile.isShimTile())
+      pools[producer.tile.getTileID()] += getPoolSize(producer, depth);
+    for (const Endpoint &consumer : consumers)
+      if (!consumer.tile.isShimTile())
+        pools[consumer.tile.getTileID()] += getPoolSize(consumer, depth);
+    return pools;
+  }
+
+  void runOnOperation() override {
+    DeviceOp device = getOperation();
+
+    // Linked objectFifos share the pool of the larger one.
+    DenseSet<ObjectFifoCreateOp> linked;
+    for (auto linkOp : device.getOps<ObjectFifoLinkOp>()) {
+      for (auto fifo : linkOp.getInputObjectFifos())
+        linked.insert(fifo);
+      for (auto fifo : linkOp.getOutputObjectFifos())
+        linked.insert(fifo);
+    }
+
+    std::map<TileID, int64_t> savedPerTile;
+    std::map<TileID, TileOp> tiles;
+    for (auto op : device.getOps<ObjectFifoCreateOp>()) {
+      // Explicit per-tile depths already override the transform's sizing.
+      if (isa<ArrayAttr>(op.getElemNumber()) || linked.contains(op)) {
+        LLVM_DEBUG(llvm::dbgs() << "skipping " << op.name() << "\n");
+        continue;
+      }
+
+      Endpoint producer = analyseEndpoint(device, op, ObjectFifoPort::Produce,
+                                          op.getProducerTileOp());
+      SmallVector<Endpoint> consumers;
+      for (Value tile : op.getConsumerTiles())
+        consumers.push_back(analyseEndpoint(
+            device, op, ObjectFifoPort::Consume,
+            cast<TileOp>(tile.getDefiningOp())));
+      if (producer.hold == 0 ||
+          llvm::any_of(consumers, [](auto &c) { return c.hold == 0; })) {
+        LLVM_DEBUG(llvm::dbgs()
+                   << "no acquires of " << op.name() << " to analyse\n");
+        continue;
+      }
+
+      // Every consumer must see each object the producer releases.
+      for (const Endpoint &consumer : consumers)
+        if (producer.objects && consumer.objects &&
+            *producer.objects != *consumer.objects)
+          op.emitWarning("producer releases ")
+              << *producer.objects << " objects per run, but the consumer in "
+              << "tile(" << consumer.tile.getCol() << ", "
+              << consumer.tile.getRow() << ") releases " << *consumer.objects;
+
+      // The producer fully overlaps with a consumer when it can fill the
+      // objects it holds in an iteration while the consumer holds those of
+      // its own iteration. In shared memory both windows come from the one
+      // pool. Over DMAs, each end is a pool of its own where a DMA moves one
+      // object while the process holds its window: the pools of cores are
+      // sized from their acquires, and those of DMA-only ends need a
+      // ping-pong pair, which a depth of 2 gives.
+      TileOp sharedTile = getSharedMemoryTile(op);
+      int depth = sharedTile ? producer.hold + consumers[0].hold : 2;
+
+      int current = op.size();
+      auto before = getPools(sharedTile, producer, consumers, current);
+      auto after = getPools(sharedTile, producer, consumers, depth);
+      int64_t elementBytes = getElementBytes(op);
+      int64_t saved = 0;
+      for (auto [tile, elements] : before) {
+        int64_t bytes = (elements - after[tile]) * elementBytes;
+        savedPerTile[tile] += bytes;
+        saved += bytes;
+      }
+      for (const Endpoint &e : consumers)
+        tiles[e.tile.getTileID()] = e.tile;
+      tiles[producer.tile.getTileID()] = producer.tile;
+
+      auto remark = op.emitRemark("depth ")
+                    << current << ", " << depth
+                    << " for full overlap (producer holds " << producer.hold
+                    << ", consumers hold ";
+      llvm::interleaveComma(consumers, remark,
+                            [&](const Endpoint &c) { remark << c.hold; });
+      remark << ")";
+      if (producer.objects)
+        remark << ", " << *producer.objects << " objects per run";
+      if (saved >= 0)
+        remark << ", saves " << saved << " bytes";
+      else
+        remark << ", costs " << -saved << " bytes";
+
+      if (depth != current) {
+        numObjectFifosResized++;
+        if (rewrite)
+          op.setElemNumberAttr(
+              IntegerAttr::get(IntegerType::get(&getContext(), 32), depth));
+      }
+    }
+
+    int64_t totalSaved = 0;
+    for (auto [tileID, saved] : savedPerTile) {
+      totalSaved += saved;
+      if (saved > 0)
+        tiles[tileID].emitRemark("objectFifo depths save ")
+            << saved << " bytes";
+      else if (saved < 0)
+        tiles[tileID].emitRemark("objectFifo depths cost ")
+            << -saved << " bytes";
+    }
+    if (totalSaved > 0)
+      numBytesSaved += totalSaved;
+  }
+};
+
+std::unique_ptr<OperationPass<DeviceOp>>
+AIE::createAIEObjectFifoDepthAnalysisPass() {
+  return std::make_unique<AIEObjectFifoDepthAnalysisPass>();
+}
@@ -310,8 +310,11 @@ struct AIEObjectFifoStatefulTransformPass
 
   /// Function used to create objectFifo elements and their locks.
   /// It maps the input objectFifo to associated buffers and locks.
+  /// coreInputs holds the buffers of the other objectFifos read by the core
+  /// that reads this one, or is null if no core reads its elements.
   void createObjectFifoElements(OpBuilder &builder, LockAnalysis &lockAnalysis,
-                                ObjectFifoCreateOp op, int share_direction) {
+                                ObjectFifoCreateOp op, int share_direction,
+                                std::vector<BufferOp> *coreInputs) {
     if (!op.size())
       return;
 
@@ -382,15 +385,29 @@ struct AIEObjectFifoStatefulTransformPass
       // if shimTile external buffers are collected from input code
       // create as many locks as there are external buffers
       if (!creation_tile.isShimTile()) {
+        // The producer and the consumer work on different elements of a FIFO
+        // concurrently, and a core reads from all of its inputs at once.
+        SmallVector<Attribute> conflicts;
+        if (emitBankConflicts) {
+          for (BufferOp b : buffers)
+            conflicts.push_back(FlatSymbolRefAttr::get(b.name()));
+          if (coreInputs)
+            for (BufferOp b : *coreInputs)
+              if (b.getTile() == creation_tile.getResult())
+                conflicts.push_back(FlatSymbolRefAttr::get(b.name()));
+        }
         auto buff = builder.create<BufferOp>(
             builder.getUnknownLoc(), elemType, creation_tile,
             builder.getStringAttr(op.name().str() + "_buff_" +
                                   std::to_string(of_elem_index)),
-            nullptr);
+            nullptr,
+            conflicts.empty() ? nullptr : builder.getArrayAttr(conflicts));
         buffers.push_back(buff);
       }
       of_elem_index++;
     }
+    if (coreInputs)
+      coreInputs->insert(coreInputs->end(), buffers.begin(), buffers.end());
     if (linked) {
       if (linkOp->isDistribute())
         numElem *= linkOp->getFifoOuts().size();
@@ -1177,6 +1194,8 @@ struct AIEObjectFifoStatefulTransformPass
     auto ctx = device->getContext();
     std::set<TileOp>
         objectFifoTiles; // track cores to check for loops during unrolling
+    DenseMap<TileOp, std::vector<BufferOp>>
+        coreInputBuffers; // objFifo buffers read by each core so far
 
     //===------------------------------------------------------------------===//
     // Split objectFifos into a consumer end and producer end if needed
@@ -1283,10 +1302,21 @@ struct AIEObjectFifoStatefulTransformPass
         detectExternalBuffers(device, createOp, createOp,
                               createOp.getProducerTile());
 
+      // The core that reads the elements, if any: the consumer of a FIFO in
+      // shared memory, or the tile of the consumer end of a split FIFO.
+      std::vector<BufferOp> *coreInputs = nullptr;
+      if (createOp.getConsumerTiles().size() == 1) {
+        auto consumerTileOp =
+            createOp.getConsumerTiles()[0].getDefiningOp<TileOp>();
+        if ((shared || consumerTileOp == createOp.getProducerTileOp()) &&
+            !consumerTileOp.isShimTile() && !consumerTileOp.isMemTile())
+          coreInputs = &coreInputBuffers[consumerTileOp];
+      }
+
       // if split, the necessary size for producer fifo might change
       if (shared) {
         createObjectFifoElements(builder, lockAnalysis, createOp,
-                                 share_direction);
+                                 share_direction, coreInputs);
       } else {
         if (isa<ArrayAttr>(createOp.getElemNumber())) {
           createOp->setAttr("elemNumber",
@@ -1298,7 +1328,7 @@ struct AIEObjectFifoStatefulTransformPass
                             builder.getI32IntegerAttr(prodMaxAcquire));
         }
         createObjectFifoElements(builder, lockAnalysis, createOp,
-                                 share_direction);
+                                 share_direction, coreInputs);
       }
     }
 
@@ -1342,7 +1372,8 @@ struct AIEObjectFifoStatefulTransformPass
         builder.create<FlowOp>(builder.getUnknownLoc(),
                                producer.getProducerTile(), WireBundle::DMA,
                                producerChan.channel, consumer.getProducerTile(),
-                               WireBundle::DMA, consumerChan.channel);
+                               WireBundle::DMA, consumerChan.channel,
+                               producer.getBandwidthAttr());
       }
     }
 
@@ -1607,3 +1638,10 @@ std::unique_ptr<OperationPass<DeviceOp>>
 AIE::createAIEObjectFifoStatefulTransformPass() {
   return std::make_unique<AIEObjectFifoStatefulTransformPass>();
 }
+
+std::unique_ptr<OperationPass<DeviceOp>>
+AIE::createAIEObjectFifoStatefulTransformPass(bool emitBankConflicts) {
+  auto pass = std::make_unique<AIEObjectFifoStatefulTransformPass>();
+  pass->emitBankConflicts = emitBankConflicts;
+  return pass;
+}
@@ -11,7 +11,13 @@
 #include "aie/Dialect/AIE/Transforms/AIEPathFinder.h"
 #include "d_ary_heap.h"
 
+#include "mlir/IR/Threading.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 using namespace mlir;
@@ -22,6 +28,192 @@ using namespace xilinx::AIE;
 #define OVER_CAPACITY_COEFF 0.02
 #define USED_CAPACITY_COEFF 0.02
 #define DEMAND_COEFF 1.1
+#define BANDWIDTH_COEFF 1.0
+#define PACKET_SHARE_COEFF 0.5
+// A packet rule matches IDs with a 5-bit mask, so a channel carries at most
+// 32 packet-switched flows.
+#define MAX_PACKET_FLOWS_PER_CHANNEL 32
+// Bump whenever the cache file format or the routing algorithm changes, so
+// that solutions cached by an older router are not reused.
+#define ROUTING_CACHE_VERSION 1
+
+// The routing cache holds one JSON file per routing problem, named after the
+// MD5 of the problem description (the cache key) and holding the key itself
+// and the solution:
+//   {"key": <key>, "flows": [{"tile": [col, row], "port": [bundle, channel],
+//     "switchboxes": [{"tile": [col, row], "src": [bundle, channel],
+//                      "dsts": [[bundle, channel], ...]}, ...]}, ...]}
+static std::string getRoutingCacheKey(DeviceOp &device, int maxCol,
+                                      int maxRow, StringRef routerConfig,
+                                      int maxIterations) {
+  std::string key;
+  llvm::raw_string_ostream os(key);
+  os << "version " << ROUTING_CACHE_VERSION << "\n";
+  os << "device " << stringifyAIEDevice(device.getDevice()) << " " << maxCol
+     << " " << maxRow << "\n";
+  os << "router " << routerConfig << " max-iterations=" << maxIterations
+     << "\n";
+  os << "costs " << OVER_CAPACITY_COEFF << " " << USED_CAPACITY_COEFF << " "
+     << DEMAND_COEFF << " " << BANDWIDTH_COEFF << " " << PACKET_SHARE_COEFF
+     << "\n";
+  for (FlowOp flowOp : device.getOps<FlowOp>()) {
+    TileOp srcTile = cast<TileOp>(flowOp.getSource().getDefiningOp());
+    TileOp dstTile = cast<TileOp>(flowOp.getDest().getDefiningOp());
+    os << "flow " << srcTile.colIndex() << " " << srcTile.rowIndex() << " "
+       << stringifyWireBundle(flowOp.getSourceBundle()) << " "
+       << flowOp.getSourceChannel() << " -> " << dstTile.colIndex() << " "
+       << dstTile.rowIndex() << " "
+       << stringifyWireBundle(flowOp.getDestBundle()) << " "
+       << flowOp.getDestChannel() << " " << flowOp.getBandwidth().value_or(1)
+       << "\n";
+  }
+  for (SwitchboxOp switchboxOp : device.getOps<SwitchboxOp>())
+    for (ConnectOp connectOp : switchboxOp.getOps<ConnectOp>())
+      os << "connect " << switchboxOp.colIndex() << " "
+         << switchboxOp.rowIndex() << " "
+         << stringifyWireBundle(connectOp.getSourceBundle()) << " "
+         << connectOp.getSourceChannel() << " -> "
+         << stringifyWireBundle(connectOp.getDestBundle()) << " "
+         << connectOp.getDestChannel() << "\n";
+  return os.str();
+}
+
+static std::string getRoutingCachePath(StringRef cacheDir, StringRef key) {
+  SmallString<128> path(cacheDir);
+  llvm::sys::path::append(
+      path, llvm::MD5::hash(llvm::arrayRefFromStringRef(key)).digest() +
+                ".json");
+  return std::string(path);
+}
+
+static llvm::json::Array tileToJSON(TileID tile) {
+  return llvm::json::Array{tile.col, tile.row};
+}
+
+static llvm::json::Array portToJSON(Port port) {
+  return llvm::json::Array{stringifyWireBundle(port.bundle), port.channel};
+}
+
+static std::optional<TileID> tileFromJSON(const llvm::json::Value *value) {
+  const llvm::json::Array *array = value ? value->getAsArray() : nullptr;
+  if (!array || array->size() != 2)
+    return std::nullopt;
+  std::optional<int64_t> col = (*array)[0].getAsInteger();
+  std::optional<int64_t> row = (*array)[1].getAsInteger();
+  if (!col || !row)
+    return std::nullopt;
+  return TileID{static_cast<int>(*col), static_cast<int>(*row)};
+}
+
+static std::optional<Port> portFromJSON(const llvm::json::Value *value) {
+  const llvm::json::Array *array = value ? value->getAsArray() : nullptr;
+  if (!array || array->size() != 2)
+    return std::nullopt;
+  std::optional<StringRef> bundleName = (*array)[0].getAsString();
+  std::optional<int64_t> channel = (*array)[1].getAsInteger();
+  if (!bundleName || !channel)
+    return std::nullopt;
+  std::optional<WireBundle> bundle = symbolizeWireBundle(*bundleName);
+  if (!bundle)
+    return std::nullopt;
+  return Port{*bundle, static_cast<int>(*channel)};
+}
+
+// Returns the cached solution for key, or nothing if there is none or the
+// cache file can't be read.
+static std::optional<std::map<PathEndPoint, SwitchSettings>>
+readRoutingCache(StringRef path, StringRef key) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return std::nullopt;
+  llvm::Expected<llvm::json::Value> cache =
+      llvm::json::parse((*buffer)->getBuffer());
+  if (!cache) {
+    std::string message = llvm::toString(cache.takeError());
+    LLVM_DEBUG(llvm::dbgs() << "Ignoring malformed routing cache " << path
+                            << ": " << message << "\n");
+    return std::nullopt;
+  }
+  const llvm::json::Object *root = cache->getAsObject();
+  if (!root || root->getString("key") != key)
+    return std::nullopt;
+  const llvm::json::Array *flows = root->getArray("flows");
+  if (!flows)
+    return std::nullopt;
+
+  std::map<PathEndPoint, SwitchSettings> solution;
+  for (const llvm::json::Value &flowValue : *flows) {
+    const llvm::json::Object *flow = flowValue.getAsObject();
+    if (!flow)
+      return std::nullopt;
+    std::optional<TileID> srcTile = tileFromJSON(flow->get("tile"));
+    std::optional<Port> srcPort = portFromJSON(flow->get("port"));
+    const llvm::json::Array *switchboxes = flow->getArray("switchboxes");
+    if (!srcTile || !srcPort || !switchboxes)
+      return std::nullopt;
+    SwitchSettings &settings = solution[{*srcTile, *srcPort}];
+    for (const llvm::json::Value &switchboxValue : *switchboxes) {
+      const llvm::json::Object *switchbox = switchboxValue.getAsObject();
+      if (!switchbox)
+        return std::nullopt;
+      std::optional<TileID> tile = tileFromJSON(switchbox->get("tile"));
+      std::optional<Port> src = portFromJSON(switchbox->get("src"));
+      const llvm::json::Array *dsts = switchbox->getArray("dsts");
+      if (!tile || !src || !dsts)
+        return std::nullopt;
+      SwitchSetting &setting = settings[*tile];
+      setting.src = *src;
+      for (const llvm::json::Value &dstValue : *dsts) {
+        std::optional<Port> dst = portFromJSON(&dstValue);
+        if (!dst)
+          return std::nullopt;
+        setting.dsts.insert(*dst);
+      }
+    }
+  }
+  return solution;
+}
+
+static void
+writeRoutingCache(StringRef path, StringRef key,
+                  const std::map<PathEndPoint, SwitchSettings> &solution) {
+  llvm::json::Array flows;
+  for (const auto &[srcPoint, settings] : solution) {
+    llvm::json::Array switchboxes;
+    for (const auto &[sb, setting] : settings) {
+      llvm::json::Array dsts;
+      for (const Port &dst : setting.dsts)
+        dsts.push_back(portToJSON(dst));
+      switchboxes.push_back(llvm::json::Object{{"tile", tileToJSON(sb)},
+                                               {"src", portToJSON(setting.src)},
+                                               {"dsts", std::move(dsts)}});
+    }
+    flows.push_back(
+        llvm::json::Object{{"tile", tileToJSON(srcPoint.sb)},
+                           {"port", portToJSON(srcPoint.port)},
+                           {"switchboxes", std::move(switchboxes)}});
+  }
+  llvm::json::Value cache =
+      llvm::json::Object{{"key", key.str()}, {"flows", std::move(flows)}};
+
+  // The cache only saves time, so failing to write it is not an error.
+  // writeToOutput goes through a temporary file, so concurrent compiles
+  // never see a partially written entry.
+  if (std::error_code ec = llvm::sys::fs::create_directories(
+          llvm::sys::path::parent_path(path))) {
+    LLVM_DEBUG(llvm::dbgs() << "Can't create routing cache directory: "
+                            << ec.message() << "\n");
+    return;
+  }
+  if (llvm::Error err = llvm::writeToOutput(path, [&](raw_ostream &os) {
+        os << cache;
+        return llvm::Error::success();
+      })) {
+    std::string message = llvm::toString(std::move(err));
+    LLVM_DEBUG(llvm::dbgs() << "Can't write routing cache " << path << ": "
+                            << message << "\n");
+  }
+}
 
 LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
   LLVM_DEBUG(llvm::dbgs() << "\t---Begin DynamicTileAnalysis Constructor---\n");
@@ -33,6 +225,62 @@ LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
     maxRow = std::max(maxRow, tileOp.rowIndex());
   }
 
+  // reuse the solution of an earlier run on the same routing problem
+  std::string cacheKey, cachePath;
+  loadedFromCache = false;
+  if (!cacheDir.empty()) {
+    cacheKey = getRoutingCacheKey(device, maxCol, maxRow, routerConfig,
+                                  maxIterations);
+    cachePath = getRoutingCachePath(cacheDir, cacheKey);
+    if (auto cachedSolutions = readRoutingCache(cachePath, cacheKey)) {
+      LLVM_DEBUG(llvm::dbgs() << "Using cached routing " << cachePath << "\n");
+      flowSolutions = std::move(*cachedSolutions);
+      loadedFromCache = true;
+    }
+  }
+  if (!loadedFromCache) {
+    if (failed(routeFlows(device)))
+      return failure();
+    if (!cacheDir.empty())
+      writeRoutingCache(cachePath, cacheKey, flowSolutions);
+  }
+
+  // initialize all flows as unprocessed to prep for rewrite
+  for (const auto &[pathEndPoint, switchSetting] : flowSolutions) {
+    processedFlows[pathEndPoint] = false;
+    LLVM_DEBUG(llvm::dbgs() << "Flow starting at (" << pathEndPoint.sb.col
+                            << "," << pathEndPoint.sb.row << "):\t");
+    LLVM_DEBUG(llvm::dbgs() << switchSetting);
+  }
+
+  // fill in coords to TileOps, SwitchboxOps, and ShimMuxOps
+  for (auto tileOp : device.getOps<TileOp>()) {
+    int col, row;
+    col = tileOp.colIndex();
+    row = tileOp.rowIndex();
+    maxCol = std::max(maxCol, col);
+    maxRow = std::max(maxRow, row);
+    assert(coordToTile.count({col, row}) == 0);
+    coordToTile[{col, row}] = tileOp;
+  }
+  for (auto switchboxOp : device.getOps<SwitchboxOp>()) {
+    int col = switchboxOp.colIndex();
+    int row = switchboxOp.rowIndex();
+    assert(coordToSwitchbox.count({col, row}) == 0);
+    coordToSwitchbox[{col, row}] = switchboxOp;
+  }
+  for (auto shimmuxOp : device.getOps<ShimMuxOp>()) {
+    int col = shimmuxOp.colIndex();
+    int row = shimmuxOp.rowIndex();
+    assert(coordToShimMux.count({col, row}) == 0);
+    coordToShimMux[{col, row}] = shimmuxOp;
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "\t---End DynamicTileAnalysis Constructor---\n");
+  return success();
+}
+
+LogicalResult DynamicTileAnalysis::routeFlows(DeviceOp &device) {
   pathfinder->initialize(maxCol, maxRow, device.getTargetModel());
 
   // for each flow in the device, add it to pathfinder
@@ -50,9 +298,29 @@ LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
                << " -> (" << dstCoords.col << ", " << dstCoords.row << ")"
                << stringifyWireBundle(dstPort.bundle) << dstPort.channel
                << "\n");
-    pathfinder->addFlow(srcCoords, srcPort, dstCoords, dstPort);
+    pathfinder->addFlow(srcCoords, srcPort, dstCoords, dstPort,
+                        flowOp.getBandwidth().value_or(1));
   }
 
+  if (routePacketFlows)
+    for (PacketFlowOp pktFlowOp : device.getOps<PacketFlowOp>()) {
+      TileID srcCoords = {0, 0};
+      Port srcPort;
+      for (Operation &op : pktFlowOp.getPorts().front().getOperations()) {
+        if (auto pktSource = dyn_cast<PacketSourceOp>(op)) {
+          srcCoords = pktSource.getTile().getDefiningOp<TileOp>().getTileID();
+          srcPort = pktSource.port();
+        } else if (auto pktDest = dyn_cast<PacketDestOp>(op)) {
+          TileID dstCoords =
+              pktDest.getTile().getDefiningOp<TileOp>().getTileID();
+          if (!pathfinder->addPacketFlow(srcCoords, srcPort, dstCoords,
+                                         pktDest.port(), pktFlowOp.IDInt()))
+            return pktFlowOp.emitOpError(
+                "can't be routed by a router without packet-switched flows");
+        }
+      }
+    }
+
   // add existing connections so Pathfinder knows which resources are
   // available search all existing SwitchBoxOps for exising connections
   for (SwitchboxOp switchboxOp : device.getOps<SwitchboxOp>()) {
@@ -70,38 +338,6 @@ LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
   else
     return device.emitError("Unable to find a legal routing");
 
-  // initialize all flows as unprocessed to prep for rewrite
-  for (const auto &[pathEndPoint, switchSetting] : flowSolutions) {
-    processedFlows[pathEndPoint] = false;
-    LLVM_DEBUG(llvm::dbgs() << "Flow starting at (" << pathEndPoint.sb.col
-                            << "," << pathEndPoint.sb.row << "):\t");
-    LLVM_DEBUG(llvm::dbgs() << switchSetting);
-  }
-
-  // fill in coords to TileOps, SwitchboxOps, and ShimMuxOps
-  for (auto tileOp : device.getOps<TileOp>()) {
-    int col, row;
-    col = tileOp.colIndex();
-    row = tileOp.rowIndex();
-    maxCol = std::max(maxCol, col);
-    maxRow = std::max(maxRow, row);
-    assert(coordToTile.count({col, row}) == 0);
-    coordToTile[{col, row}] = tileOp;
-  }
-  for (auto switchboxOp : device.getOps<SwitchboxOp>()) {
-    int col = switchboxOp.colIndex();
-    int row = switchboxOp.rowIndex();
-    assert(coordToSwitchbox.count({col, row}) == 0);
-    coordToSwitchbox[{col, row}] = switchboxOp;
-  }
-  for (auto shimmuxOp : device.getOps<ShimMuxOp>()) {
-    int col = shimmuxOp.colIndex();
-    int row = shimmuxOp.rowIndex();
-    assert(coordToShimMux.count({col, row}) == 0);
-    coordToShimMux[{col, row}] = shimmuxOp;
-  }
-
-  LLVM_DEBUG(llvm::dbgs() << "\t---End DynamicTileAnalysis Constructor---\n");
   return success();
 }
 
@@ -198,43 +434,76 @@ void Pathfinder::initialize(int maxCol, int maxRow,
       }
     }
   }
+
+  // Build the dense view of the graph once, so that the router core only does
+  // index arithmetic instead of map lookups and per-call edge sorting.
+  nodes.assign(grid.size(), nullptr);
+  for (auto &[_, sb] : grid)
+    nodes[sb.id] = &sb;
+  adjacency.clear();
+  adjacencyOffsets.assign(1, 0);
+  for (SwitchboxNode *sb : nodes) {
+    auto begin = adjacency.insert(adjacency.end(), sb->getEdges().begin(),
+                                  sb->getEdges().end());
+    std::sort(begin, adjacency.end(),
+              [](const ChannelEdge *c1, const ChannelEdge *c2) {
+                return c1->getTargetNode().id < c2->getTargetNode().id;
+              });
+    adjacencyOffsets.push_back(adjacency.size());
+  }
 }
 
 // Add a flow from src to dst can have an arbitrary number of dst locations due
-// to fanout.
+// to fanout. A fanout flow carries the highest bandwidth of its destinations.
 void Pathfinder::addFlow(TileID srcCoords, Port srcPort, TileID dstCoords,
-                         Port dstPort) {
+                         Port dstPort, int bandwidth) {
+  auto matchingDstSb = grid.find(dstCoords);
+  assert(matchingDstSb != grid.end() && "didn't find flow dest");
+
   // check if a flow with this source already exists
-  for (auto &[src, dsts] : flows) {
-    SwitchboxNode *existingSrc = src.sb;
+  for (auto &flow : flows) {
+    if (flow.packetID)
+      continue;
+    SwitchboxNode *existingSrc = flow.src.sb;
     assert(existingSrc && "nullptr flow source");
-    if (Port existingPort = src.port; existingSrc->col == srcCoords.col &&
-                                      existingSrc->row == srcCoords.row &&
-                                      existingPort == srcPort) {
-      // find the vertex corresponding to the destination
-      auto *matchingSb = std::find_if(
-          graph.begin(), graph.end(), [&](const SwitchboxNode *sb) {
-            return sb->col == dstCoords.col && sb->row == dstCoords.row;
-          });
-      assert(matchingSb != graph.end() && "didn't find flow dest");
-      dsts.emplace_back(*matchingSb, dstPort);
+    if (Port existingPort = flow.src.port;
+        existingSrc->col == srcCoords.col &&
+        existingSrc->row == srcCoords.row && existingPort == srcPort) {
+      flow.dsts.emplace_back(&matchingDstSb->second, dstPort);
+      flow.bandwidth = std::max(flow.bandwidth, bandwidth);
       return;
     }
   }
 
   // If no existing flow was found with this source, create a new flow.
-  auto *matchingSrcSb =
-      std::find_if(graph.begin(), graph.end(), [&](const SwitchboxNode *sb) {
-        return sb->col == srcCoords.col && sb->row == srcCoords.row;
-      });
-  assert(matchingSrcSb != graph.end() && "didn't find flow source");
-  auto *matchingDstSb =
-      std::find_if(graph.begin(), graph.end(), [&](const SwitchboxNode *sb) {
-        return sb->col == dstCoords.col && sb->row == dstCoords.row;
-      });
-  assert(matchingDstSb != graph.end() && "didn't add flow destinations");
-  flows.push_back({PathEndPointNode{*matchingSrcSb, srcPort},
-                   std::vector<PathEndPointNode>{{*matchingDstSb, dstPort}}});
+  auto matchingSrcSb = grid.find(srcCoords);
+  assert(matchingSrcSb != grid.end() && "didn't find flow source");
+  flows.push_back(
+      {PathEndPointNode{&matchingSrcSb->second, srcPort},
+       std::vector<PathEndPointNode>{{&matchingDstSb->second, dstPort}},
+       bandwidth});
+}
+
+// Packet flows with the same source and ID form a single flow with fanout.
+bool Pathfinder::addPacketFlow(TileID srcCoords, Port srcPort,
+                               TileID dstCoords, Port dstPort, int packetID) {
+  auto matchingDstSb = grid.find(dstCoords);
+  assert(matchingDstSb != grid.end() && "didn't find flow dest");
+  for (auto &flow : flows)
+    if (flow.packetID == packetID &&
+        static_cast<TileID>(*flow.src.sb) == srcCoords &&
+        flow.src.port == srcPort) {
+      flow.dsts.emplace_back(&matchingDstSb->second, dstPort);
+      return true;
+    }
+
+  auto matchingSrcSb = grid.find(srcCoords);
+  assert(matchingSrcSb != grid.end() && "didn't find flow source");
+  flows.push_back(
+      {PathEndPointNode{&matchingSrcSb->second, srcPort},
+       std::vector<PathEndPointNode>{{&matchingDstSb->second, dstPort}},
+       /*bandwidth=*/1, packetID});
+  return true;
 }
 
 // Keep track of connections already used in the AIE; Pathfinder algorithm will
@@ -275,60 +544,356 @@ bool Pathfinder::addFixedConnection(ConnectOp connectOp) {
 
 static constexpr double INF = std::numeric_limits<double>::max();
 
-std::map<SwitchboxNode *, SwitchboxNode *>
-dijkstraShortestPaths(const SwitchboxGraph &graph, SwitchboxNode *src) {
-  // Use std::map instead of DenseMap because DenseMap doesn't let you overwrite
-  // tombstones.
-  auto distance = std::map<SwitchboxNode *, double>();
-  auto preds = std::map<SwitchboxNode *, SwitchboxNode *>();
-  std::map<SwitchboxNode *, uint64_t> indexInHeap;
+// The channel of ch already carrying packet flows that a packet flow with
+// packetID can share, if any.
+static std::optional<int> findSharedPacketChannel(const ChannelEdge *ch,
+                                                  int packetID) {
+  for (const auto &[index, packetIDs] : ch->packetFlows)
+    if (packetIDs.size() < MAX_PACKET_FLOWS_PER_CHANNEL &&
+        !llvm::is_contained(packetIDs, packetID))
+      return index;
+  return std::nullopt;
+}
+
+static double getBandwidthWeight(const FlowNode &flow) {
+  return BANDWIDTH_COEFF * (flow.bandwidth - 1);
+}
+
+// Cost of routing flow over ch. Flows with a bandwidth hint above 1 pay
+// extra per hop, scaled up on links already carrying other flows, so they
+// prefer short paths over lightly used links. Packet flows pay less for
+// joining a channel other packet flows use than for taking a new one, so
+// that they converge on few master ports and need few arbiters and rules.
+static double channelCost(const ChannelEdge *ch, const FlowNode &flow) {
+  double demand = ch->demand;
+  if (flow.packetID && findSharedPacketChannel(ch, *flow.packetID))
+    demand *= PACKET_SHARE_COEFF;
+  double bandwidthWeight = getBandwidthWeight(flow);
+  if (bandwidthWeight == 0.0)
+    return demand;
+  return demand +
+         bandwidthWeight * (1.0 + USED_CAPACITY_COEFF * ch->usedCapacity);
+}
+
+int Pathfinder::dijkstraShortestPaths(
+    ArrayRef<SwitchboxNode *> srcs, const FlowNode &flow,
+    std::vector<double> &distance, std::vector<ChannelEdge *> &preds) const {
+  // Everything is addressed by SwitchboxNode::id.
+  distance.assign(nodes.size(), INF);
+  preds.assign(nodes.size(), nullptr);
   typedef d_ary_heap_indirect<
-      /*Value=*/SwitchboxNode *, /*Arity=*/4,
-      /*IndexInHeapPropertyMap=*/std::map<SwitchboxNode *, uint64_t>,
-      /*DistanceMap=*/std::map<SwitchboxNode *, double> &,
+      /*Value=*/int, /*Arity=*/4,
+      /*IndexInHeapPropertyMap=*/std::vector<uint64_t>,
+      /*DistanceMap=*/std::vector<double> &,
       /*Compare=*/std::less<>>
       MutableQueue;
-  MutableQueue Q(distance, indexInHeap);
-
-  for (SwitchboxNode *sb : graph)
-    distance.emplace(sb, INF);
-  distance[src] = 0.0;
-
-  std::map<SwitchboxNode *, std::vector<ChannelEdge *>> edges;
+  MutableQueue Q(distance, std::vector<uint64_t>(nodes.size()));
 
   enum Color { WHITE, GRAY, BLACK };
-  std::map<SwitchboxNode *, Color> colors;
-  for (SwitchboxNode *sb : graph) {
-    colors[sb] = WHITE;
-    edges[sb] = {sb->getEdges().begin(), sb->getEdges().end()};
-    std::sort(edges[sb].begin(), edges[sb].end(),
-              [](const ChannelEdge *c1, ChannelEdge *c2) {
-                return c1->getTargetNode().id < c2->getTargetNode().id;
-              });
-  }
+  std::vector<Color> colors(nodes.size(), WHITE);
 
-  Q.push(src);
+  for (SwitchboxNode *src : srcs) {
+    distance[src->id] = 0.0;
+    colors[src->id] = GRAY;
+    Q.push(src->id);
+  }
+  int expanded = 0;
   while (!Q.empty()) {
-    src = Q.top();
+    int curr = Q.top();
     Q.pop();
-    for (ChannelEdge *e : edges[src]) {
-      SwitchboxNode *dest = &e->getTargetNode();
-      bool relax = distance[src] + e->demand < distance[dest];
+    expanded++;
+    for (size_t i = adjacencyOffsets[curr]; i < adjacencyOffsets[curr + 1];
+         i++) {
+      ChannelEdge *e = adjacency[i];
+      int dest = e->getTargetNode().id;
+      double cost = channelCost(e, flow);
+      bool relax = distance[curr] + cost < distance[dest];
       if (colors[dest] == WHITE) {
         if (relax) {
-          distance[dest] = distance[src] + e->demand;
-          preds[dest] = src;
+          distance[dest] = distance[curr] + cost;
+          preds[dest] = e;
           colors[dest] = GRAY;
         }
         Q.push(dest);
       } else if (colors[dest] == GRAY && relax) {
-        distance[dest] = distance[src] + e->demand;
-        preds[dest] = src;
+        distance[dest] = distance[curr] + cost;
+        preds[dest] = e;
       }
     }
-    colors[src] = BLACK;
+    colors[curr] = BLACK;
+  }
+  return expanded;
+}
+
+// Goal-directed shortest paths from the source of flow to its destinations.
+// Every channel joins neighbouring switchboxes and costs at least minHopCost,
+// so the Manhattan distance to the nearest destination times that never
+// overestimates the remaining cost and can guide the search. The search stops
+// once every destination is settled; distance and preds are exact for the
+// destinations and for the switchboxes on their shortest paths.
+int Pathfinder::aStarShortestPaths(const FlowNode &flow,
+                                   std::vector<double> &distance,
+                                   std::vector<ChannelEdge *> &preds) const {
+  SwitchboxNode *src = flow.src.sb;
+  ArrayRef<PathEndPointNode> dsts = flow.dsts;
+  double minHopCost = minDemand + getBandwidthWeight(flow);
+  if (flow.packetID)
+    minHopCost = PACKET_SHARE_COEFF * minDemand + getBandwidthWeight(flow);
+  distance.assign(nodes.size(), INF);
+  preds.assign(nodes.size(), nullptr);
+  // distance from src plus the estimate of the remaining distance
+  std::vector<double> priority(nodes.size(), INF);
+  typedef d_ary_heap_indirect<
+      /*Value=*/int, /*Arity=*/4,
+      /*IndexInHeapPropertyMap=*/std::vector<uint64_t>,
+      /*DistanceMap=*/std::vector<double> &,
+      /*Compare=*/std::less<>>
+      MutableQueue;
+  MutableQueue Q(priority, std::vector<uint64_t>(nodes.size(), -1));
+
+  auto heuristic = [&](int id) {
+    int hops = std::numeric_limits<int>::max();
+    for (const PathEndPointNode &endPoint : dsts)
+      hops = std::min(hops, std::abs(nodes[id]->col - endPoint.sb->col) +
+                                std::abs(nodes[id]->row - endPoint.sb->row));
+    return hops * minHopCost;
+  };
+
+  std::vector<bool> isGoal(nodes.size(), false);
+  size_t remainingGoals = 0;
+  for (const PathEndPointNode &endPoint : dsts)
+    if (!isGoal[endPoint.sb->id]) {
+      isGoal[endPoint.sb->id] = true;
+      remainingGoals++;
+    }
+
+  // the heuristic is consistent, so a settled switchbox is never improved
+  std::vector<bool> settled(nodes.size(), false);
+  distance[src->id] = 0.0;
+  priority[src->id] = heuristic(src->id);
+  Q.push(src->id);
+  int expanded = 0;
+  while (!Q.empty()) {
+    int curr = Q.top();
+    Q.pop();
+    expanded++;
+    settled[curr] = true;
+    if (isGoal[curr] && --remainingGoals == 0)
+      break;
+    for (size_t i = adjacencyOffsets[curr]; i < adjacencyOffsets[curr + 1];
+         i++) {
+      ChannelEdge *e = adjacency[i];
+      int dest = e->getTargetNode().id;
+      double cost = channelCost(e, flow);
+      if (settled[dest] || !(distance[curr] + cost < distance[dest]))
+        continue;
+      distance[dest] = distance[curr] + cost;
+      preds[dest] = e;
+      priority[dest] = distance[dest] + heuristic(dest);
+      Q.push_or_update(dest);
+    }
   }
-  return preds;
+  return expanded;
+}
+
+// Number of channels in the union of the paths from each of dsts back to a
+// source of the shortest-path tree given by preds.
+static int countTreeChannels(const std::vector<ChannelEdge *> &preds,
+                             ArrayRef<PathEndPointNode> dsts) {
+  std::vector<bool> visited(preds.size(), false);
+  int count = 0;
+  for (const PathEndPointNode &endPoint : dsts)
+    for (ChannelEdge *ch = preds[endPoint.sb->id];
+         ch && !visited[ch->getTargetNode().id]; ch = preds[ch->src.id]) {
+      visited[ch->getTargetNode().id] = true;
+      count++;
+    }
+  return count;
+}
+
+// Claim an index in Channel ch for a flow, skipping fixed channels. Indices at
+// or above maxCapacity mean the Channel is over capacity. A packet flow joins
+// an index held by other packet flows when it can.
+int Pathfinder::claimChannel(ChannelEdge *ch, std::optional<int> packetID) {
+  if (packetID) {
+    if (auto index = findSharedPacketChannel(ch, *packetID)) {
+      ch->packetFlows[*index].push_back(*packetID);
+      return *index;
+    }
+    int index = claimChannel(ch, std::nullopt);
+    ch->packetFlows[index].push_back(*packetID);
+    return index;
+  }
+  if (!options.incremental) {
+    // don't use fixed channels
+    while (ch->fixedCapacity.count(ch->usedCapacity))
+      ch->usedCapacity++;
+    return ch->usedCapacity++;
+  }
+  // flows can be ripped up individually, so take the lowest free index
+  int index = 0;
+  while (ch->fixedCapacity.count(index) || ch->usedChannels.count(index))
+    index++;
+  ch->usedChannels.insert(index);
+  ch->usedCapacity = std::max(ch->usedCapacity, index + 1);
+  return index;
+}
+
+void Pathfinder::releaseChannel(ChannelEdge *ch, int index,
+                                std::optional<int> packetID) {
+  assert(options.incremental && "channels are only released incrementally");
+  if (packetID) {
+    std::vector<int> &packetIDs = ch->packetFlows[index];
+    packetIDs.erase(llvm::find(packetIDs, *packetID));
+    // the index stays held while other packet flows use it
+    if (!packetIDs.empty())
+      return;
+    ch->packetFlows.erase(index);
+  }
+  ch->usedChannels.erase(index);
+  ch->usedCapacity =
+      ch->usedChannels.empty() ? 0 : *ch->usedChannels.rbegin() + 1;
+}
+
+// Find a route for one flow given the current demand. This only reads the
+// graph, so routes for several flows can be searched concurrently.
+Pathfinder::FlowPath Pathfinder::findFlowPath(const FlowNode &flow) const {
+  const auto &[src, dsts, bandwidth, packetID] = flow;
+  // Use dijkstra to find path given current demand from the start
+  // switchbox; find the shortest paths to each other switchbox. Output is
+  // in the predecessor map, which must then be processed to get individual
+  // switchbox settings
+  assert(src.sb && "nonexistent flow source");
+  std::vector<bool> processed(nodes.size(), false);
+  std::vector<double> distance;
+  std::vector<ChannelEdge *> preds;
+  // switchboxes already on the route of this flow
+  std::vector<SwitchboxNode *> tree = {src.sb};
+  FlowPath path;
+  if (options.aStarMaxDestinations &&
+      dsts.size() <= options.aStarMaxDestinations)
+    path.nodesExpanded = aStarShortestPaths(flow, distance, preds);
+  else
+    path.nodesExpanded = dijkstraShortestPaths(tree, flow, distance, preds);
+  path.dijkstraCalls = 1;
+  path.sourceRootedChannels = countTreeChannels(preds, dsts);
+  processed[src.sb->id] = true;
+
+  // trace the path of the flow backwards via predecessors
+  auto traceBack = [&](size_t dst) {
+    std::vector<ChannelEdge *> &channels =
+        path.segments.emplace_back(dst, std::vector<ChannelEdge *>()).second;
+    SwitchboxNode *curr = dsts[dst].sb;
+    assert(curr && "endpoint has no source switchbox");
+    // trace backwards until a vertex already processed is reached
+    while (!processed[curr->id]) {
+      // incoming edge
+      ChannelEdge *ch = preds[curr->id];
+      assert(ch && "couldn't find ch");
+      channels.push_back(ch);
+      processed[curr->id] = true;
+      tree.push_back(curr);
+      curr = &ch->src;
+    }
+  };
+
+  if (options.fanoutAware && dsts.size() > 1) {
+    // Grow a routing tree: connect the unrouted destination closest to the
+    // tree, then search again with the whole tree as zero-cost sources, so
+    // that later destinations branch off channels this flow already uses.
+    std::vector<bool> routed(dsts.size(), false);
+    for (size_t n = 0; n < dsts.size(); n++) {
+      if (n > 0) {
+        path.nodesExpanded +=
+            dijkstraShortestPaths(tree, flow, distance, preds);
+        path.dijkstraCalls++;
+      }
+      std::optional<size_t> nearest;
+      for (size_t i = 0; i < dsts.size(); i++)
+        if (!routed[i] && (!nearest || distance[dsts[i].sb->id] <
+                                           distance[dsts[*nearest].sb->id]))
+          nearest = i;
+      routed[*nearest] = true;
+      traceBack(*nearest);
+    }
+  } else {
+    for (size_t i = 0; i < dsts.size(); i++)
+      traceBack(i);
+  }
+  return path;
+}
+
+// Claim the channels along path for flow and build its switchbox settings.
+Pathfinder::FlowRoute Pathfinder::commitFlowPath(const FlowNode &flow,
+                                                 const FlowPath &path) {
+  const auto &[src, dsts, bandwidth, packetID] = flow;
+  stats.dijkstraCalls += path.dijkstraCalls;
+  stats.nodesExpanded += path.nodesExpanded;
+
+  FlowRoute route;
+  route.sourceRootedChannels = path.sourceRootedChannels;
+  SwitchSettings &switchSettings = route.switchSettings;
+  // set the input bundle for the source endpoint
+  switchSettings[*src.sb].src = src.port;
+  for (const auto &[dst, channels] : path.segments) {
+    // set the output bundle for this destination endpoint
+    switchSettings[*dsts[dst].sb].dsts.insert(dsts[dst].port);
+
+    // increment used_capacity for the associated channels
+    for (ChannelEdge *ch : channels) {
+      int index = claimChannel(ch, packetID);
+      route.channels.emplace_back(ch, index);
+
+      // add the entrance port for this Switchbox
+      switchSettings[ch->getTargetNode()].src = {
+          getConnectingBundle(ch->bundle), index};
+      // add the current Switchbox to the map of the predecessor
+      switchSettings[ch->src].dsts.insert({ch->bundle, index});
+
+      // if at capacity, bump demand to discourage using this Channel
+      if (ch->usedCapacity >= ch->maxCapacity) {
+        LLVM_DEBUG(llvm::dbgs() << "ch over capacity: " << ch << "\n");
+        // this means the order matters!
+        ch->demand *= DEMAND_COEFF;
+      }
+    }
+  }
+  return route;
+}
+
+// Route the circuit-switched flows with the lowest bandwidth hint among those
+// using an over-capacity channel in routes as packet-switched flows, with the
+// next IDs of packetFallbackIDs. Only flows from packetFallbackSources are
+// demoted. Returns false if no flow could be demoted.
+bool Pathfinder::demoteCongestedFlows(const std::vector<FlowRoute> &routes) {
+  std::vector<size_t> congested;
+  int lowestBandwidth = std::numeric_limits<int>::max();
+  for (size_t i = 0; i < flows.size(); i++)
+    if (!flows[i].packetID &&
+        llvm::any_of(routes[i].channels, [](auto &chIndex) {
+          return chIndex.first->usedCapacity > chIndex.first->maxCapacity;
+        })) {
+      if (!options.packetFallbackSources.count(flows[i].src)) {
+        undemotableSources.insert(flows[i].src);
+        continue;
+      }
+      congested.push_back(i);
+      lowestBandwidth = std::min(lowestBandwidth, flows[i].bandwidth);
+    }
+
+  bool demoted = false;
+  for (size_t i : congested) {
+    if (flows[i].bandwidth != lowestBandwidth)
+      continue;
+    if (nextFallbackID == options.packetFallbackIDs.size())
+      break;
+    flows[i].packetID = options.packetFallbackIDs[nextFallbackID++];
+    LLVM_DEBUG(llvm::dbgs() << "Demoting flow from " << flows[i].src
+                            << " to packet ID " << *flows[i].packetID << "\n");
+    stats.flowsDemoted++;
+    demoted = true;
+  }
+  return demoted;
 }
 
 // Perform congestion-aware routing for all flows which have been added.
@@ -341,7 +906,17 @@ std::optional<std::map<PathEndPoint, SwitchSettings>>
 Pathfinder::findPaths(const int maxIterations) {
   LLVM_DEBUG(llvm::dbgs() << "Begin Pathfinder::findPaths\n");
   int iterationCount = 0;
-  std::map<PathEndPoint, SwitchSettings> routingSolution;
+  // iterations before the current attempt, which started after flows were
+  // last demoted to packet-switched flows
+  int attemptStart = 0;
+  // smallest total overuse of the channels seen in the current attempt, and
+  // the number of iterations since it last went down
+  int leastOveruse = std::numeric_limits<int>::max();
+  int stalledIterations = 0;
+  stats = PathfinderStats();
+  undemotableSources.clear();
+  std::vector<FlowRoute> routes(flows.size());
+  std::vector<bool> needsRouting(flows.size(), true);
 
   // initialize all Channel histories to 0
   for (auto &ch : edges)
@@ -361,7 +936,9 @@ Pathfinder::findPaths(const int maxIterations) {
         LLVM_DEBUG(llvm::dbgs()
                    << "over_capacity_count = " << e.overCapacityCount << "\n");
         legal = false;
-        break;
+        // incremental routing needs the history of every congested Channel
+        if (!options.incremental)
+          break;
       }
     }
 
@@ -382,83 +959,125 @@ Pathfinder::findPaths(const int maxIterations) {
         ch.demand = history * congestion;
       }
     }
+    // lower bound on the cost of a hop, for the A* heuristic
+    minDemand = 0.0;
+    for (auto &ch : edges)
+      if (ch.demand != INF && (minDemand == 0.0 || ch.demand < minDemand))
+        minDemand = ch.demand;
+    // while packet IDs remain to demote flows to, give up on the current
+    // flows as soon as the negotiation stops making progress
+    if (iterationCount > attemptStart &&
+        nextFallbackID < options.packetFallbackIDs.size()) {
+      int overuse = 0;
+      for (auto &ch : edges)
+        overuse += std::max(ch.usedCapacity - ch.maxCapacity, 0);
+      if (overuse < leastOveruse) {
+        leastOveruse = overuse;
+        stalledIterations = 0;
+      } else {
+        stalledIterations++;
+      }
+    }
     // if reach maxIterations, throw an error since no routing can be found
-    if (++iterationCount > maxIterations) {
+    bool exhausted = ++iterationCount - attemptStart > maxIterations;
+    if (exhausted ||
+        stalledIterations >= options.packetFallbackStallIterations) {
       LLVM_DEBUG(llvm::dbgs()
-                 << "Pathfinder: maxIterations has been exceeded ("
-                 << maxIterations
-                 << " iterations)...unable to find routing for flows.\n");
-      return std::nullopt;
+                 << "Pathfinder: "
+                 << (exhausted ? "maxIterations has been exceeded"
+                               : "overuse has stopped going down")
+                 << " after " << iterationCount - attemptStart - 1
+                 << " iterations...unable to find routing for flows.\n");
+      if (demoteCongestedFlows(routes)) {
+        // start over, rerouting every flow
+        attemptStart = iterationCount - 1;
+        leastOveruse = std::numeric_limits<int>::max();
+        stalledIterations = 0;
+        needsRouting.assign(flows.size(), true);
+      } else if (exhausted) {
+        return std::nullopt;
+      }
     }
 
-    // "rip up" all routes, i.e. set used capacity in each Channel to 0
-    routingSolution.clear();
-    for (auto &ch : edges)
-      ch.usedCapacity = 0;
+    if (options.incremental && iterationCount - attemptStart > 1) {
+      // rip up only the flows using an over-capacity Channel; the rest of the
+      // previous solution stays in place
+      for (size_t i = 0; i < flows.size(); i++)
+        needsRouting[i] = llvm::any_of(routes[i].channels, [](auto &chIndex) {
+          return chIndex.first->usedCapacity > chIndex.first->maxCapacity;
+        });
+      for (size_t i = 0; i < flows.size(); i++)
+        if (needsRouting[i])
+          for (auto [ch, index] : routes[i].channels)
+            releaseChannel(ch, index, flows[i].packetID);
+      LLVM_DEBUG(llvm::dbgs() << "Rerouting " << llvm::count(needsRouting, true)
+                              << " of " << flows.size() << " flows\n");
+    } else {
+      // "rip up" all routes, i.e. set used capacity in each Channel to 0
+      for (auto &ch : edges) {
+        ch.usedCapacity = 0;
+        ch.usedChannels.clear();
+        ch.packetFlows.clear();
+      }
+    }
 
     // for each flow, find the shortest path from source to destination
     // update used_capacity for the path between them
-    for (const auto &[src, dsts] : flows) {
-      // Use dijkstra to find path given current demand from the start
-      // switchbox; find the shortest paths to each other switchbox. Output is
-      // in the predecessor map, which must then be processed to get individual
-      // switchbox settings
-      assert(src.sb && "nonexistent flow source");
-      std::set<SwitchboxNode *> processed;
-      std::map<SwitchboxNode *, SwitchboxNode *> preds =
-          dijkstraShortestPaths(graph, src.sb);
-
-      // trace the path of the flow backwards via predecessors
-      // increment used_capacity for the associated channels
-      SwitchSettings switchSettings;
-      // set the input bundle for the source endpoint
-      switchSettings[*src.sb].src = src.port;
-      processed.insert(src.sb);
-      for (const PathEndPointNode &endPoint : dsts) {
-        SwitchboxNode *curr = endPoint.sb;
-        assert(curr && "endpoint has no source switchbox");
-        // set the output bundle for this destination endpoint
-        switchSettings[*curr].dsts.insert(endPoint.port);
-
-        // trace backwards until a vertex already processed is reached
-        while (!processed.count(curr)) {
-          // find the edge from the pred to curr by searching incident edges
-          SmallVector<ChannelEdge *, 10> channels;
-          graph.findIncomingEdgesToNode(*curr, channels);
-          auto *matchingCh = std::find_if(
-              channels.begin(), channels.end(),
-              [&](ChannelEdge *ch) { return ch->src == *preds[curr]; });
-          assert(matchingCh != channels.end() && "couldn't find ch");
-          // incoming edge
-          ChannelEdge *ch = *matchingCh;
-
-          // don't use fixed channels
-          while (ch->fixedCapacity.count(ch->usedCapacity))
-            ch->usedCapacity++;
-
-          // add the entrance port for this Switchbox
-          switchSettings[*curr].src = {getConnectingBundle(ch->bundle),
-                                       ch->usedCapacity};
-          // add the current Switchbox to the map of the predecessor
-          switchSettings[*preds[curr]].dsts.insert(
-              {ch->bundle, ch->usedCapacity});
-
-          ch->usedCapacity++;
-          // if at capacity, bump demand to discourage using this Channel
-          if (ch->usedCapacity >= ch->maxCapacity) {
-            LLVM_DEBUG(llvm::dbgs() << "ch over capacity: " << ch << "\n");
-            // this means the order matters!
-            ch->demand *= DEMAND_COEFF;
-          }
-
-          processed.insert(curr);
-          curr = preds[curr];
-        }
+    std::vector<size_t> toRoute;
+    for (size_t i = 0; i < flows.size(); i++)
+      if (needsRouting[i])
+        toRoute.push_back(i);
+    // flows with a higher bandwidth hint get first pick of the channels
+    llvm::stable_sort(toRoute, [&](size_t a, size_t b) {
+      return flows[a].bandwidth > flows[b].bandwidth;
+    });
+    if (!options.parallelBatchSize) {
+      for (size_t i : toRoute)
+        routes[i] = commitFlowPath(flows[i], findFlowPath(flows[i]));
+    } else {
+      // Search the flows of a batch concurrently against the demand left by
+      // the previous batches, then claim their channels in flow order. The
+      // batches do not depend on the number of threads, so neither does the
+      // routing.
+      std::vector<FlowPath> paths;
+      for (size_t begin = 0; begin < toRoute.size();
+           begin += options.parallelBatchSize) {
+        size_t end =
+            std::min(begin + options.parallelBatchSize, toRoute.size());
+        paths.assign(end - begin, FlowPath());
+        auto search = [&](size_t j) {
+          paths[j - begin] = findFlowPath(flows[toRoute[j]]);
+        };
+        if (options.context)
+          parallelFor(options.context, begin, end, search);
+        else
+          for (size_t j = begin; j < end; j++)
+            search(j);
+        for (size_t j = begin; j < end; j++)
+          routes[toRoute[j]] =
+              commitFlowPath(flows[toRoute[j]], paths[j - begin]);
       }
-      // add this flow to the proposed solution
-      routingSolution[src] = switchSettings;
     }
   } while (!isLegal()); // continue iterations until a legal routing is found
 
+  std::map<PathEndPoint, SwitchSettings> routingSolution;
+  packetFlowSolutions.clear();
+  for (size_t i = 0; i < flows.size(); i++) {
+    // add this flow to the solution
+    if (flows[i].packetID)
+      packetFlowSolutions[{flows[i].src, *flows[i].packetID}] =
+          routes[i].switchSettings;
+    else
+      routingSolution[flows[i].src] = routes[i].switchSettings;
+    stats.channelsUsed += routes[i].channels.size();
+    stats.sourceRootedChannelsUsed += routes[i].sourceRootedChannels;
+  }
+  stats.iterations = iterationCount;
+  LLVM_DEBUG(llvm::dbgs() << "Pathfinder: " << stats.iterations
+                          << " iterations, " << stats.dijkstraCalls
+                          << " shortest path searches, " << stats.channelsUsed
+                          << " channels used ("
+                          << stats.sourceRootedChannelsUsed
+                          << " with source-rooted fanout)\n");
   return routingSolution;
 }
@@ -18,6 +18,8 @@
 #include <vector>
 #include <cstddef>
 #include <algorithm>
+#include <map>
+#include <type_traits>
 #include <utility>
 
 // WARNING: it is not safe to copy a d_ary_heap_indirect and then modify one of
@@ -68,6 +70,10 @@ inline void put(T& pa, K k, const V& val) { pa[k] = val;  }
 template <class K, class V>
 inline const V& get(const std::map<K, V>& pa, K k) { return pa.at(k); }
 
+// Dense property maps: the key is an index into the vector.
+template <class V>
+inline const V& get(const std::vector<V>& pa, std::size_t k) { return pa[k]; }
+
 // D-ary heap using an indirect compare operator (use identity_property_map
 // as DistanceMap to get a direct compare operator).  This heap appears to be
 // commonly used for Dijkstra's algorithm for its good practical performance
@@ -203,7 +209,9 @@ private:
     // distance map
     // typedef typename boost::property_traits< DistanceMap >::value_type
     //     distance_type;
-    typedef typename std::remove_reference<DistanceMap>::type::mapped_type distance_type;
+    typedef typename std::decay<decltype(get(
+        std::declval<const typename std::remove_reference<DistanceMap>::type&>(),
+        std::declval<Value>()))>::type distance_type;
 
     // Get the parent of a given node in the heap
     static size_type parent(size_type index) { return (index - 1) / Arity; }
@@ -34,6 +34,20 @@ void AIEXDialect::initialize() {
 #define GET_OP_CLASSES
 #include "aie/Dialect/AIEX/IR/AIEX.cpp.inc"
 
+std::optional<AIE::ShimDMAAllocationOp>
+AIEX::getAllocOpForSymbol(AIE::DeviceOp dev, StringRef symName) {
+  auto sym = dev.lookupSymbol(symName);
+  if (!sym)
+    return std::nullopt;
+
+  auto uses = SymbolTable::getSymbolUses(sym, dev);
+  for (auto use : *uses)
+    if (auto infoOp = dyn_cast<AIE::ShimDMAAllocationOp>(use.getUser()))
+      return infoOp;
+
+  return std::nullopt;
+}
+
 LogicalResult AIEX::UseTokenOp::verify() {
   auto *parentOp = (*this)->getParentOp();
   if (isa<func::FuncOp>(parentOp) || isa<AIE::CoreOp>(parentOp) ||
@@ -72,36 +86,46 @@ LogicalResult AIEX::IpuDmaMemcpyNdOp::verify() {
         return getConstantIntValue(s).has_value();
       }))
     llvm::report_fatal_error("Only constant strides currently supported.");
-  if (!llvm::all_of(getMixedSizes(), [](OpFoldResult s) {
-        return getConstantIntValue(s).has_value();
-      }))
-    llvm::report_fatal_error("Only constant sizes currently supported.");
-  if (!llvm::all_of(getMixedOffsets(), [](OpFoldResult s) {
-        return getConstantIntValue(s).has_value();
-      }))
-    llvm::report_fatal_error("Only constant offsets currently supported.");
+  // Dynamic sizes and offsets are patched in by the host, so they must be
+  // arguments of the runtime sequence.
+  for (Value v : (*this)->getOperands().drop_front()) {
+    if (getConstantIntValue(v))
+      continue;
+    auto arg = dyn_cast<BlockArgument>(v);
+    if (!arg || !isa<func::FuncOp>(arg.getOwner()->getParentOp()))
+      return emitOpError("dynamic sizes and offsets must be arguments of the "
+                         "enclosing function.");
+  }
+  return success();
+}
+
+LogicalResult AIEX::IpuDmaMemcpyNdOp::verifyBDLimits(bool emitErrors) {
+  auto error = [&](const Twine &message) {
+    if (emitErrors)
+      emitOpError(message);
+    return failure();
+  };
 
   llvm::SmallVector<int64_t, 3> strides =
       llvm::map_to_vector(llvm::reverse(getMixedStrides()), [](OpFoldResult s) {
         return getConstantIntValue(s).value();
       });
-  llvm::SmallVector<int64_t, 4> sizes =
-      llvm::map_to_vector(llvm::reverse(getMixedSizes()), [](OpFoldResult s) {
-        return getConstantIntValue(s).value();
-      });
-
-  if (sizes[3] > 64)
-    return emitOpError("Size 3 exceeds the [1:64] range.");
-  if (strides[1] && sizes[1] > 0x3FF)
-    return emitOpError("Size 1 exceeds the [0:1023] range.");
-  if (strides[0] && sizes[0] > 0x3FF)
-    return emitOpError("Size 0 exceeds the [0:1023] range.");
+  llvm::SmallVector<std::optional<int64_t>, 4> sizes = llvm::map_to_vector(
+      llvm::reverse(getMixedSizes()),
+      [](OpFoldResult s) { return getConstantIntValue(s); });
+
+  if (sizes[3] && *sizes[3] > 64)
+    return error("Size 3 exceeds the [1:64] range.");
+  if (strides[1] && sizes[1] && *sizes[1] > 0x3FF)
+    return error("Size 1 exceeds the [0:1023] range.");
+  if (strides[0] && sizes[0] && *sizes[0] > 0x3FF)
+    return error("Size 0 exceeds the [0:1023] range.");
   if (strides[2] > 0x100000)
-    return emitOpError("Stride 3 exceeds the [1:1M] range.");
+    return error("Stride 3 exceeds the [1:1M] range.");
   if (strides[1] > 0x100000)
-    return emitOpError("Stride 2 exceeds the [1:1M] range.");
+    return error("Stride 2 exceeds the [1:1M] range.");
   if (strides[0] > 0x100000)
-    return emitOpError("Stride 1 exceeds the [1:1M] range.");
+    return error("Stride 1 exceeds the [1:1M] range.");
   return success();
 }
 
@@ -115,6 +139,40 @@ LogicalResult AIEX::IpuShimTilePushQueueOp::verify() {
   return success();
 }
 
+LogicalResult AIEX::IpuPatchOp::verify() {
+  Operation *prev = (*this)->getPrevNode();
+  int numWords;
+  if (isa_and_nonnull<IpuWrite32Op, IpuShimTilePushQueueOp>(prev))
+    numWords = 3;
+  else if (isa_and_nonnull<IpuWriteBdExShimTileOp>(prev))
+    numWords = 10;
+  else
+    return emitOpError("must follow the instruction it patches.");
+  if (getWord() < 0 || getWord() >= numWords)
+    return emitOpError("word ") << getWord() << " is outside the instruction.";
+  if (getShift() < 0 || getShift() > 31)
+    return emitOpError("shift exceeds the [0:31] range.");
+  int64_t min = getMinAttr().getInt();
+  int64_t max = getMaxAttr().getInt();
+  if (min < 0 || min > max || max > static_cast<int64_t>(getMask()))
+    return emitOpError("range [")
+           << min << ":" << max << "] does not fit the mask.";
+  if (getCoefficients().size() != getTerms().size())
+    return emitOpError("expected one coefficient per term.");
+
+  auto f = (*this)->getParentOfType<func::FuncOp>();
+  for (Attribute term : getTerms()) {
+    auto args = dyn_cast<DenseI32ArrayAttr>(term);
+    if (!args)
+      return emitOpError("terms must be arrays of argument indices.");
+    for (int32_t arg : args.asArrayRef())
+      if (!f || arg < 0 || arg >= static_cast<int32_t>(f.getNumArguments()))
+        return emitOpError("argument index ")
+               << arg << " is not an argument of the enclosing function.";
+  }
+  return success();
+}
+
 LogicalResult AIEX::IpuWriteBdExShimTileOp::verify() {
   const auto &targetModel = AIE::getTargetModel(*this);
   auto numBds = targetModel.getNumBDs(0, 0); // assume shim
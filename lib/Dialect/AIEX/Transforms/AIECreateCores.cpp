@@ -123,8 +123,8 @@ struct AIECreateCoresPass : public AIECreateCoresBase<AIECreateCoresPass> {
 
           assert(t && "Unsupported type!");
           coreBufTypes.push_back({t, i});
-          BufferOp buf = builder.create<BufferOp>(builder.getUnknownLoc(), t,
-                                                  tile, nullptr, nullptr);
+          BufferOp buf = builder.create<BufferOp>(
+              builder.getUnknownLoc(), t, tile, nullptr, nullptr, nullptr);
           buffers[callOperands[i]] = buf;
           operand.replaceAllUsesWith(buf.getResult());
         }
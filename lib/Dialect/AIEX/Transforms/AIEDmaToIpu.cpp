@@ -67,20 +67,6 @@ struct RtpToIpuPattern : OpConversionPattern<IpuWriteRTPOp> {
   }
 };
 
-std::optional<AIE::ShimDMAAllocationOp>
-getAllocOpForSymbol(AIE::DeviceOp dev, StringRef sym_name) {
-  auto sym = dev.lookupSymbol(sym_name);
-  if (!sym)
-    return std::nullopt;
-
-  auto uses = SymbolTable::getSymbolUses(sym, dev);
-  for (auto use : *uses)
-    if (auto infoOp = dyn_cast<AIE::ShimDMAAllocationOp>(use.getUser()))
-      return infoOp;
-
-  return std::nullopt;
-}
-
 struct PushToIpuPattern : OpConversionPattern<IpuShimTilePushQueueOp> {
   using OpConversionPattern::OpConversionPattern;
 
@@ -142,6 +128,68 @@ struct PushToIpuPattern : OpConversionPattern<IpuShimTilePushQueueOp> {
   }
 };
 
+// A value that may depend on the arguments of the runtime sequence, as the
+// polynomial bias + sum(coefficient * product(arguments)). Static values only
+// have a bias.
+struct RuntimeValue {
+  int64_t bias;
+  SmallVector<std::pair<int64_t, SmallVector<int32_t>>> terms;
+
+  RuntimeValue(int64_t bias = 0) : bias(bias) {}
+
+  // Constants become static values. Anything else is an argument of the
+  // runtime sequence, as checked by the IpuDmaMemcpyNdOp verifier.
+  static RuntimeValue get(OpFoldResult ofr) {
+    if (auto c = getConstantIntValue(ofr))
+      return RuntimeValue(*c);
+    RuntimeValue v;
+    auto arg = cast<BlockArgument>(ofr.get<Value>());
+    v.terms.push_back({1, {static_cast<int32_t>(arg.getArgNumber())}});
+    return v;
+  }
+
+  bool isStatic() const { return terms.empty(); }
+
+  RuntimeValue operator+(const RuntimeValue &rhs) const {
+    RuntimeValue v = *this;
+    v.bias += rhs.bias;
+    v.terms.append(rhs.terms.begin(), rhs.terms.end());
+    return v;
+  }
+
+  RuntimeValue operator*(const RuntimeValue &rhs) const {
+    RuntimeValue v(bias * rhs.bias);
+    if (rhs.bias)
+      for (const auto &[c, args] : terms)
+        v.terms.push_back({c * rhs.bias, args});
+    if (bias)
+      for (const auto &[c, args] : rhs.terms)
+        v.terms.push_back({bias * c, args});
+    for (const auto &[c0, args0] : terms)
+      for (const auto &[c1, args1] : rhs.terms) {
+        SmallVector<int32_t> args(args0);
+        args.append(args1.begin(), args1.end());
+        v.terms.push_back({c0 * c1, args});
+      }
+    return v;
+  }
+};
+
+// Record that bits `mask << shift` of word `word` of the instruction created
+// just before hold `v`, which the field limits to [min, max].
+void createPatch(ConversionPatternRewriter &rewriter, Location loc, int word,
+                 int shift, uint32_t mask, int64_t min, int64_t max,
+                 const RuntimeValue &v) {
+  SmallVector<int64_t> coefficients;
+  SmallVector<Attribute> terms;
+  for (const auto &[c, args] : v.terms) {
+    coefficients.push_back(c);
+    terms.push_back(DenseI32ArrayAttr::get(rewriter.getContext(), args));
+  }
+  rewriter.create<IpuPatchOp>(loc, word, shift, mask, min, max, v.bias,
+                              coefficients, rewriter.getArrayAttr(terms));
+}
+
 struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
   using OpConversionPattern::OpConversionPattern;
 
@@ -204,12 +252,29 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
     llvm::SmallVector<int64_t, 3> strides = llvm::map_to_vector(
         llvm::reverse(op.getMixedStrides()),
         [](OpFoldResult s) { return getConstantIntValue(s).value(); });
-    llvm::SmallVector<int64_t, 4> sizes = llvm::map_to_vector(
-        llvm::reverse(op.getMixedSizes()),
-        [](OpFoldResult s) { return getConstantIntValue(s).value(); });
-    llvm::SmallVector<int64_t, 4> offsets = llvm::map_to_vector(
-        llvm::reverse(op.getMixedOffsets()),
-        [](OpFoldResult s) { return getConstantIntValue(s).value(); });
+    llvm::SmallVector<RuntimeValue, 4> sizes = llvm::map_to_vector(
+        llvm::reverse(op.getMixedSizes()), RuntimeValue::get);
+    llvm::SmallVector<RuntimeValue, 4> offsets = llvm::map_to_vector(
+        llvm::reverse(op.getMixedOffsets()), RuntimeValue::get);
+
+    // Fields that depend on runtime arguments are left zero in the
+    // instruction and patched by the host; see IpuPatchOp.
+    struct Patch {
+      int word, shift;
+      uint32_t mask;
+      int64_t min, max;
+      RuntimeValue value;
+    };
+    SmallVector<Patch> bdPatches;
+    auto setField = [&](IntegerAttr &field, const RuntimeValue &v, int word,
+                        int shift, uint32_t mask, int64_t max) {
+      if (v.isStatic()) {
+        field = IntegerAttr::get(i32ty, v.bias);
+        return;
+      }
+      field = zero;
+      bdPatches.push_back({word, shift, mask, 0, max, v});
+    };
 
     // column
     column = IntegerAttr::get(i32ty, col);
@@ -234,15 +299,12 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
     bd_id = IntegerAttr::get(i32ty, op.getId());
 
     // buffer_length
-    int32_t repeat_length = 0;
-    for (int32_t index_3d = 0; index_3d < sizes[2]; index_3d++)
-      for (int32_t index_2d = 0; index_2d < sizes[1]; index_2d++)
-        repeat_length += sizes[0];
-    buffer_length = IntegerAttr::get(i32ty, repeat_length);
+    setField(buffer_length, sizes[0] * sizes[1] * sizes[2], 2, 0, 0xFFFFFFFF,
+             0xFFFFFFFF);
 
     // buffer_offset
     size_t stride = 1;
-    size_t offset = 0;
+    RuntimeValue offset;
     MemRefType my_memref = op.getMemref().getType();
     auto shape = my_memref.getShape();
     size_t R = shape.size();
@@ -251,10 +313,10 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
            "Expected Memref element bitwidth to be multiple of 8.");
     size_t S = el_bit_width / 8;
     for (size_t i = 0; i < R; i++) {
-      offset += offsets[i] * stride * S;
+      offset = offset + offsets[i] * RuntimeValue(stride * S);
       stride *= shape[R - i - 1];
     }
-    buffer_offset = IntegerAttr::get(i32ty, offset);
+    setField(buffer_offset, offset, 3, 0, 0xFFFFFFFF, 0xFFFFFFFF);
 
     // enable_packet
 
@@ -266,14 +328,14 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
 
     // d0_size
     if (strides[0])
-      d0_size = IntegerAttr::get(i32ty, sizes[0]);
+      setField(d0_size, sizes[0], 5, 20, 0x3FF, 0x3FF);
 
     // d0_stride
     d0_stride = IntegerAttr::get(i32ty, 0);
 
     // d1_size
     if (strides[1])
-      d1_size = IntegerAttr::get(i32ty, sizes[1]);
+      setField(d1_size, sizes[1], 6, 20, 0x3FF, 0x3FF);
 
     // d1_stride
     if (strides[0])
@@ -287,7 +349,8 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
 
     // iteration_size
     if (strides[2])
-      iteration_size = IntegerAttr::get(i32ty, sizes[3] - 1);
+      setField(iteration_size, sizes[3] + RuntimeValue(-1), 8, 20, 0x3F,
+               0x3F);
 
     // iteration_stride
     if (strides[2])
@@ -311,10 +374,14 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
     // lock_acq_id
 
     // repeat_count
-    repeat_count = IntegerAttr::get(i32ty, sizes[3] - 1);
+    RuntimeValue repeat = sizes[3] + RuntimeValue(-1);
+    if (repeat.isStatic())
+      repeat_count = IntegerAttr::get(i32ty, repeat.bias);
 
     // issue_token
-    if (!isMM2S)
+    if (auto issueToken = op.getIssueToken())
+      issue_token = BoolAttr::get(ctx, *issueToken);
+    else if (!isMM2S)
       issue_token = BoolAttr::get(ctx, true);
 
     (void)rewriter.create<IpuWriteBdExShimTileOp>(
@@ -323,9 +390,16 @@ struct DmaToIpuPattern : OpConversionPattern<IpuDmaMemcpyNdOp> {
         d0_size, d0_stride, d1_size, d1_stride, d2_stride, iteration_current,
         iteration_size, iteration_stride, next_bd, use_next_bd, valid_bd,
         lock_rel_val, lock_rel_id, lock_acq_enable, lock_acq_val, lock_acq_id);
+    for (const Patch &p : bdPatches)
+      createPatch(rewriter, op->getLoc(), p.word, p.shift, p.mask, p.min,
+                  p.max, p.value);
 
     rewriter.create<IpuShimTilePushQueueOp>(op->getLoc(), op.getMetadataAttr(),
                                             issue_token, repeat_count, bd_id);
+    // The push becomes a write32 whose value holds the repeat count, which
+    // comes from size 3 and so stays below 64.
+    if (!repeat.isStatic())
+      createPatch(rewriter, op->getLoc(), 2, 16, 0xFF, 0, 63, repeat);
 
     rewriter.eraseOp(op);
     return success();
@@ -337,6 +411,15 @@ struct AIEDmaToIpuPass : AIEDmaToIpuBase<AIEDmaToIpuPass> {
 
     AIE::DeviceOp device = getOperation();
 
+    // The BD fields would silently truncate larger transfers; these have to
+    // be split by --aie-ipu-legalize-dma first.
+    auto result = device.walk([](IpuDmaMemcpyNdOp op) {
+      return failed(op.verifyBDLimits()) ? WalkResult::interrupt()
+                                         : WalkResult::advance();
+    });
+    if (result.wasInterrupted())
+      return signalPassFailure();
+
     ConversionTarget target(getContext());
     target.addLegalDialect<AIEXDialect>();
     target.addLegalOp<AIE::BufferOp>();
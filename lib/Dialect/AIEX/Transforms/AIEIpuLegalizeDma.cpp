@@ -0,0 +1,340 @@
+//===- AIEIpuLegalizeDma.cpp ------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIEX/IR/AIEXDialect.h"
+#include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <tuple>
+
+#define DEBUG_TYPE "aie-ipu-legalize-dma"
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIEX;
+
+namespace {
+
+// Limits of the shim BD fields, see DmaToIpuPattern.
+constexpr int64_t maxWrap = 0x3FF;
+constexpr int64_t maxIterations = 64;
+constexpr int64_t maxStride = 0x100000;
+
+// A shim DMA channel: column, direction and channel index.
+using ChannelID = std::tuple<int, int, int>;
+
+struct Dim {
+  int64_t size, stride;
+};
+
+// A transfer in the shape of a shim BD: up to three dimensions, innermost
+// first, the innermost one with stride 1, repeated `iteration.size` times with
+// `iteration.stride` elements between repetitions. Offsets and strides are in
+// elements of the memref.
+struct Transfer {
+  int64_t offset;
+  SmallVector<Dim, 3> dims;
+  Dim iteration;
+};
+
+// Append `d` to the dimensions of `t`, merging it into the outermost one when
+// the two are contiguous.
+void appendDim(Transfer &t, Dim d) {
+  if (d.size == 1)
+    return;
+  Dim &outer = t.dims.back();
+  if (d.stride == outer.size * outer.stride)
+    outer.size *= d.size;
+  else
+    t.dims.push_back(d);
+}
+
+// The transfer of `op`, which must have static sizes, strides and offsets, as
+// interpreted by DmaToIpuPattern.
+Transfer getTransfer(IpuDmaMemcpyNdOp op) {
+  auto getConstants = [](ArrayRef<OpFoldResult> values) {
+    return llvm::map_to_vector(llvm::reverse(values), [](OpFoldResult v) {
+      return getConstantIntValue(v).value();
+    });
+  };
+  auto offsets = getConstants(op.getMixedOffsets());
+  auto sizes = getConstants(op.getMixedSizes());
+  auto strides = getConstants(op.getMixedStrides());
+
+  Transfer t;
+  t.offset = 0;
+  ArrayRef<int64_t> shape = op.getMemref().getType().getShape();
+  size_t R = shape.size();
+  int64_t stride = 1;
+  for (size_t i = 0; i < std::min<size_t>(R, offsets.size()); i++) {
+    t.offset += offsets[i] * stride;
+    stride *= shape[R - i - 1];
+  }
+
+  // A zero stride makes a dimension continue linearly from the one inside it.
+  Dim d1 = {sizes[1], strides[0] ? strides[0] : sizes[0]};
+  Dim d2 = {sizes[2],
+            strides[0] && strides[1] ? strides[1] : d1.stride * sizes[1]};
+  t.dims.push_back({sizes[0], 1});
+  appendDim(t, d1);
+  appendDim(t, d2);
+
+  // An iteration that moves through memory is just another dimension, and the
+  // outermost BD dimension has no wrap limit.
+  t.iteration = {sizes[3], sizes[3] > 1 ? strides[2] : 0};
+  if (t.iteration.size > 1 && t.iteration.stride && t.dims.size() < 3) {
+    appendDim(t, t.iteration);
+    t.iteration = {1, 0};
+  }
+  return t;
+}
+
+// Whether dimension `i` of `t` can be encoded in a BD. The wrap of the
+// outermost dimension follows from the buffer length, and the innermost one
+// always has stride 1.
+bool isLegalDim(const Transfer &t, size_t i) {
+  if (i + 1 < t.dims.size() && t.dims[i].size > maxWrap)
+    return false;
+  return i == 0 || t.dims[i].stride <= maxStride;
+}
+
+// The largest factor of `n` that is at most `max`.
+int64_t getLargestFactor(int64_t n, int64_t max) {
+  for (int64_t f = std::min(n, max); f > 1; f--)
+    if (n % f == 0)
+      return f;
+  return 1;
+}
+
+// Split `t` into transfers that each fit a BD, in the order in which they
+// must run to stream the same data.
+void split(const Transfer &t, SmallVectorImpl<Transfer> &transfers) {
+  const Dim &iteration = t.iteration;
+  auto unrollIteration = [&] {
+    for (int64_t i = 0; i < iteration.size; i++) {
+      Transfer u = t;
+      u.offset += i * iteration.stride;
+      u.iteration = {1, 0};
+      split(u, transfers);
+    }
+  };
+
+  if (iteration.size > 1 && iteration.stride > maxStride)
+    return unrollIteration();
+  if (iteration.size > maxIterations) {
+    for (int64_t i = 0; i < iteration.size; i += maxIterations) {
+      Transfer chunk = t;
+      chunk.offset += i * iteration.stride;
+      chunk.iteration.size = std::min(maxIterations, iteration.size - i);
+      split(chunk, transfers);
+    }
+    return;
+  }
+
+  size_t i = 0;
+  while (i < t.dims.size() && isLegalDim(t, i))
+    i++;
+  if (i == t.dims.size()) {
+    transfers.push_back(t);
+    return;
+  }
+
+  // Factor a dimension whose wrap is too large into two, if a BD dimension
+  // is free.
+  const Dim &d = t.dims[i];
+  if (d.size > maxWrap && t.dims.size() < 3) {
+    int64_t inner = getLargestFactor(d.size, maxWrap);
+    if (inner > 1 && d.stride * inner <= maxStride) {
+      Transfer f = t;
+      f.dims[i].size = inner;
+      f.dims.insert(f.dims.begin() + i + 1,
+                    Dim{d.size / inner, d.stride * inner});
+      return split(f, transfers);
+    }
+  }
+
+  // Otherwise give up the outermost dimension: it becomes the iteration, which
+  // is unrolled first if it is in use.
+  if (iteration.size > 1)
+    return unrollIteration();
+  Transfer demoted = t;
+  demoted.iteration = demoted.dims.pop_back_val();
+  split(demoted, transfers);
+}
+
+} // namespace
+
+struct AIEIpuLegalizeDmaPass : AIEIpuLegalizeDmaBase<AIEIpuLegalizeDmaPass> {
+  // Shim BDs that no transfer of the current sequence uses, per column.
+  std::map<int, std::deque<int>> freeBDs;
+
+  std::optional<ChannelID> getChannel(StringRef metadata) {
+    auto infoOp = getAllocOpForSymbol(getOperation(), metadata);
+    if (!infoOp)
+      return std::nullopt;
+    return ChannelID{infoOp->getCol(),
+                     static_cast<int>(infoOp->getChannelDir()),
+                     static_cast<int>(infoOp->getChannelIndex())};
+  }
+
+  // Number of task completion tokens issued on `ch` before `op` that no sync
+  // before it has consumed.
+  int64_t getPendingTokens(Operation *op, ChannelID ch) {
+    auto [col, direction, channel] = ch;
+    int64_t tokens = 0;
+    for (Operation &prev : *op->getBlock()) {
+      if (&prev == op)
+        break;
+      if (auto dma = dyn_cast<IpuDmaMemcpyNdOp>(prev)) {
+        bool isS2MM = direction == static_cast<int>(AIE::DMAChannelDir::S2MM);
+        if (getChannel(dma.getMetadata()) == ch &&
+            dma.getIssueToken().value_or(isS2MM))
+          tokens++;
+      } else if (auto push = dyn_cast<IpuShimTilePushQueueOp>(prev)) {
+        if (getChannel(push.getMetadata()) == ch && push.getIssueToken())
+          tokens++;
+      } else if (auto sync = dyn_cast<IpuSyncOp>(prev)) {
+        int begin = sync.getColumn(), end = begin + sync.getColumnNum();
+        if (sync.getRow() == 0 && col >= begin && col < end &&
+            static_cast<int>(sync.getDirection()) == direction &&
+            static_cast<int>(sync.getChannel()) == channel && tokens)
+          tokens--;
+      }
+    }
+    return tokens;
+  }
+
+  void collectFreeBDs(Block &entry) {
+    const auto &targetModel = AIE::getTargetModel(getOperation());
+    std::map<int, std::set<int>> usedBDs;
+    for (Operation &op : entry) {
+      if (auto dma = dyn_cast<IpuDmaMemcpyNdOp>(op)) {
+        if (auto ch = getChannel(dma.getMetadata()))
+          usedBDs[std::get<0>(*ch)].insert(dma.getId());
+      } else if (auto push = dyn_cast<IpuShimTilePushQueueOp>(op)) {
+        if (auto ch = getChannel(push.getMetadata()))
+          usedBDs[std::get<0>(*ch)].insert(push.getBdId());
+      } else if (auto writeBd = dyn_cast<IpuWriteBdExShimTileOp>(op)) {
+        usedBDs[writeBd.getColumn()].insert(writeBd.getBdId());
+      }
+    }
+    for (auto &[col, used] : usedBDs)
+      for (int bd = 0, e = targetModel.getNumBDs(col, 0); bd < e; bd++)
+        if (!used.count(bd))
+          freeBDs[col].push_back(bd);
+  }
+
+  LogicalResult legalize(IpuDmaMemcpyNdOp op) {
+    if (succeeded(op.verifyBDLimits(/*emitErrors=*/false)))
+      return success();
+    if (!llvm::all_of(op->getOperands().drop_front(), [](Value v) {
+          return getConstantIntValue(v).has_value();
+        }))
+      return op.emitOpError("exceeds the limits of a shim BD and can only be "
+                            "split with static sizes and offsets.");
+    auto ch = getChannel(op.getMetadata());
+    if (!ch)
+      return op.emitOpError("couldn't find shim_dma_allocation op");
+    auto [col, direction, channel] = *ch;
+
+    SmallVector<Transfer> transfers;
+    split(getTransfer(op), transfers);
+
+    // The first transfer uses the BD of `op`. When no free BD is left, or the
+    // task queue of the channel is full, a transfer waits for the oldest
+    // earlier one and takes over its BD, which requires every token issued
+    // before `op` on the channel to have been consumed already.
+    std::deque<int> &pool = freeBDs[col];
+    size_t maxInFlight = pool.size() + 1;
+    if (queueDepth)
+      maxInFlight = std::min<size_t>(maxInFlight, queueDepth);
+    if (transfers.size() > maxInFlight && getPendingTokens(op, *ch) > 0)
+      return op.emitOpError("needs ")
+             << transfers.size() << " transfers, but only " << maxInFlight
+             << " can be pushed to the channel without waiting and it has "
+                "outstanding tokens to wait for.";
+
+    OpBuilder builder(op);
+    Location loc = op.getLoc();
+    std::deque<std::pair<int, IpuDmaMemcpyNdOp>> inFlight;
+    for (auto [i, t] : llvm::enumerate(transfers)) {
+      int bd;
+      bool queueFull = queueDepth && inFlight.size() >= queueDepth;
+      if (i == 0) {
+        bd = op.getId();
+      } else if (!pool.empty() && !queueFull) {
+        bd = pool.front();
+        pool.pop_front();
+      } else {
+        IpuDmaMemcpyNdOp oldest;
+        std::tie(bd, oldest) = inFlight.front();
+        inFlight.pop_front();
+        oldest.setIssueTokenAttr(builder.getBoolAttr(true));
+        builder.create<IpuSyncOp>(loc, col, 0, direction, channel, 1, 1);
+        numSyncsInserted++;
+      }
+
+      size_t n = t.dims.size();
+      SmallVector<int64_t, 4> sizes = {t.iteration.size,
+                                       n > 2 ? t.dims[2].size : 1,
+                                       n > 1 ? t.dims[1].size : 1,
+                                       t.dims[0].size};
+      SmallVector<int64_t, 3> strides = {
+          t.iteration.size > 1 ? t.iteration.stride : 0,
+          n > 2 ? t.dims[2].stride : 0, n > 1 ? t.dims[1].stride : 0};
+      // Only the last transfer issues the token of `op`.
+      BoolAttr issueToken = i + 1 == transfers.size()
+                                ? op.getIssueTokenAttr()
+                                : builder.getBoolAttr(false);
+      auto legal = builder.create<IpuDmaMemcpyNdOp>(
+          loc, op.getXAttr(), op.getYAttr(), op.getMemref(), ValueRange(),
+          ValueRange(), ValueRange(),
+          builder.getDenseI64ArrayAttr({0, 0, 0, t.offset}),
+          builder.getDenseI64ArrayAttr(sizes),
+          builder.getDenseI64ArrayAttr(strides), op.getMetadataAttr(),
+          builder.getI64IntegerAttr(bd), issueToken);
+      LLVM_DEBUG(llvm::dbgs() << "split: " << legal << "\n");
+      inFlight.push_back({bd, legal});
+    }
+
+    op.erase();
+    numTransfersSplit++;
+    numTransfersCreated += transfers.size();
+    return success();
+  }
+
+  void runOnOperation() override {
+    AIE::DeviceOp device = getOperation();
+
+    for (auto f : device.getOps<func::FuncOp>()) {
+      if (f.isDeclaration())
+        continue;
+      Block &entry = f.getBody().front();
+      freeBDs.clear();
+      collectFreeBDs(entry);
+
+      for (auto op :
+           llvm::make_early_inc_range(entry.getOps<IpuDmaMemcpyNdOp>()))
+        if (failed(legalize(op)))
+          return signalPassFailure();
+    }
+  }
+};
+
+std::unique_ptr<OperationPass<AIE::DeviceOp>>
+AIEX::createAIEIpuLegalizeDmaPass() {
+  return std::make_unique<AIEIpuLegalizeDmaPass>();
+}
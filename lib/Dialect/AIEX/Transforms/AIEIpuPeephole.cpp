@@ -0,0 +1,185 @@
+//===- AIEIpuPeephole.cpp ---------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIEX/IR/AIEXDialect.h"
+#include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/TypeSwitch.h"
+
+#include <tuple>
+
+#define DEBUG_TYPE "aie-ipu-peephole"
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIEX;
+
+namespace {
+
+// Size of each instruction in 32-bit words, as encoded by AIETargetIPU.cpp.
+unsigned getInstructionWords(Operation *op) {
+  return llvm::TypeSwitch<Operation *, unsigned>(op)
+      .Case<IpuSyncOp>([](auto) { return 2; })
+      .Case<IpuWrite32Op>([](auto) { return 3; })
+      .Case<IpuWriteBdExShimTileOp>([](auto) { return 10; })
+      .Default([](auto) { return 0; });
+}
+
+// Registers whose writes have an effect beyond updating their own value:
+// DMA channel control and task queues, lock values and the core control
+// register of the shim, compute and memory tiles. A write to one of these is
+// never removed, and no write is moved across it.
+bool isControlRegister(uint32_t address) {
+  return (address >= 0x1D200 && address < 0x1D220) || // shim DMA channels
+         (address >= 0x14000 && address < 0x14100) || // shim locks
+         (address >= 0x1DE00 && address < 0x1DE20) || // compute DMA channels
+         (address >= 0x1F000 && address < 0x1F100) || // compute locks
+         (address >= 0x32000 && address < 0x32008) || // core control
+         (address >= 0xA0600 && address < 0xA0660) || // memory DMA channels
+         (address >= 0xC0000 && address < 0xC0400);   // memory locks
+}
+
+// Try to fold `sync` into `prev`, extending the range of `prev` to cover the
+// tiles of both. Only contiguous, non-overlapping ranges are merged: a sync
+// waits for one task completion token per tile in its range, so merging
+// overlapping ranges would wait for fewer tokens.
+bool mergeSyncs(IpuSyncOp prev, IpuSyncOp sync) {
+  if (prev.getDirection() != sync.getDirection() ||
+      prev.getChannel() != sync.getChannel())
+    return false;
+
+  if (prev.getRow() == sync.getRow() && prev.getRowNum() == sync.getRowNum()) {
+    if (prev.getColumn() + prev.getColumnNum() == sync.getColumn()) {
+      prev.setColumnNum(prev.getColumnNum() + sync.getColumnNum());
+      return true;
+    }
+    if (sync.getColumn() + sync.getColumnNum() == prev.getColumn()) {
+      prev.setColumn(sync.getColumn());
+      prev.setColumnNum(prev.getColumnNum() + sync.getColumnNum());
+      return true;
+    }
+  }
+
+  if (prev.getColumn() == sync.getColumn() &&
+      prev.getColumnNum() == sync.getColumnNum()) {
+    if (prev.getRow() + prev.getRowNum() == sync.getRow()) {
+      prev.setRowNum(prev.getRowNum() + sync.getRowNum());
+      return true;
+    }
+    if (sync.getRow() + sync.getRowNum() == prev.getRow()) {
+      prev.setRow(sync.getRow());
+      prev.setRowNum(prev.getRowNum() + sync.getRowNum());
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+struct AIEIpuPeepholePass : AIEIpuPeepholeBase<AIEIpuPeepholePass> {
+
+  // Remove write32s that are overwritten before anything can observe them.
+  // `pending` holds the last write to each register since the most recent
+  // barrier.
+  void removeDeadWrites(Block &block) {
+    using RegisterID = std::tuple<uint32_t, uint32_t, uint32_t>;
+    DenseMap<RegisterID, IpuWrite32Op> pending;
+    SmallVector<Operation *> deadOps;
+
+    for (Operation &op : block) {
+      if (auto write = dyn_cast<IpuWrite32Op>(op)) {
+        if (isControlRegister(write.getAddress())) {
+          pending.clear();
+          continue;
+        }
+        RegisterID reg = {write.getColumn(), write.getRow(),
+                          write.getAddress()};
+        auto [it, inserted] = pending.try_emplace(reg, write);
+        if (!inserted) {
+          LLVM_DEBUG(llvm::dbgs() << "dead write: " << it->second << "\n");
+          deadOps.push_back(it->second);
+          it->second = write;
+        }
+        continue;
+      }
+      if (!isMemoryEffectFree(&op))
+        pending.clear();
+    }
+
+    for (Operation *op : deadOps)
+      op->erase();
+    numWrite32Removed += deadOps.size();
+  }
+
+  void mergeAdjacentSyncs(Block &block) {
+    SmallVector<Operation *> mergedOps;
+    IpuSyncOp prev;
+    for (Operation &op : block) {
+      if (auto sync = dyn_cast<IpuSyncOp>(op)) {
+        if (prev && mergeSyncs(prev, sync)) {
+          mergedOps.push_back(sync);
+          continue;
+        }
+        prev = sync;
+        continue;
+      }
+      if (!isMemoryEffectFree(&op))
+        prev = nullptr;
+    }
+
+    for (Operation *op : mergedOps)
+      op->erase();
+    numSyncsMerged += mergedOps.size();
+  }
+
+  static std::pair<unsigned, unsigned> countInstructions(Block &block) {
+    unsigned count = 0, words = 0;
+    for (Operation &op : block)
+      if (unsigned n = getInstructionWords(&op)) {
+        count++;
+        words += n;
+      }
+    return {count, words * sizeof(uint32_t)};
+  }
+
+  void runOnOperation() override {
+    AIE::DeviceOp device = getOperation();
+
+    for (auto f : device.getOps<func::FuncOp>()) {
+      if (f.isDeclaration())
+        continue;
+      Block &entry = f.getBody().front();
+      auto [countBefore, bytesBefore] = countInstructions(entry);
+
+      removeDeadWrites(entry);
+      mergeAdjacentSyncs(entry);
+
+      auto [count, bytes] = countInstructions(entry);
+      numInstructions += count;
+      numInstructionBytes += bytes;
+      if (report)
+        f.emitRemark("ipu instructions: ")
+            << count << " (" << bytes << " bytes), was " << countBefore
+            << " (" << bytesBefore << " bytes)";
+    }
+  }
+};
+
+std::unique_ptr<OperationPass<AIE::DeviceOp>>
+AIEX::createAIEIpuPeepholePass() {
+  return std::make_unique<AIEIpuPeepholePass>();
+}
@@ -0,0 +1,279 @@
+//===- AIEIpuScheduleDma.cpp ------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIEX/IR/AIEXDialect.h"
+#include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include <deque>
+#include <map>
+#include <tuple>
+
+#define DEBUG_TYPE "aie-ipu-schedule-dma"
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIEX;
+
+namespace {
+
+// A shim DMA channel: column, direction and channel index.
+using ChannelID = std::tuple<int, int, int>;
+
+// A transfer that has been pushed to a shim DMA channel and may not have
+// completed yet.
+struct Transfer {
+  IpuDmaMemcpyNdOp op;
+  int bd;
+  // Position of the transfer in the sequence.
+  int64_t order;
+  bool isS2MM;
+  bool issuesToken;
+  // Elements of the memref that may be accessed, or std::nullopt if they
+  // depend on runtime arguments.
+  std::optional<std::pair<int64_t, int64_t>> range;
+};
+
+// The BDs of a shim tile.
+struct ShimTile {
+  SmallVector<bool> reserved, inFlight;
+  // Position of the transfer that last used each BD, -1 if unused.
+  SmallVector<int64_t> lastUse;
+
+  explicit ShimTile(unsigned numBDs)
+      : reserved(numBDs, false), inFlight(numBDs, false), lastUse(numBDs, -1) {}
+
+  // The least recently used BD that is neither reserved nor in flight, or -1.
+  int findFreeBD() const {
+    int best = -1;
+    for (int bd = 0, e = lastUse.size(); bd < e; bd++)
+      if (!reserved[bd] && !inFlight[bd] &&
+          (best < 0 || lastUse[bd] < lastUse[best]))
+        best = bd;
+    return best;
+  }
+};
+
+// A conservative bound on the elements of the memref accessed by `op`.
+std::optional<std::pair<int64_t, int64_t>>
+getAccessedRange(IpuDmaMemcpyNdOp op) {
+  auto getConstants = [](ArrayRef<OpFoldResult> values) {
+    return llvm::map_to_vector(llvm::reverse(values), [](OpFoldResult v) {
+      return getConstantIntValue(v);
+    });
+  };
+  auto offsets = getConstants(op.getMixedOffsets());
+  auto sizes = getConstants(op.getMixedSizes());
+  auto strides = getConstants(op.getMixedStrides());
+  auto isDynamic = [](std::optional<int64_t> v) { return !v.has_value(); };
+  if (llvm::any_of(offsets, isDynamic) || llvm::any_of(sizes, isDynamic))
+    return std::nullopt;
+
+  ArrayRef<int64_t> shape = op.getMemref().getType().getShape();
+  size_t R = shape.size();
+  int64_t begin = 0, stride = 1;
+  for (size_t i = 0; i < R; i++) {
+    begin += *offsets[i] * stride;
+    stride *= shape[R - i - 1];
+  }
+  // Covers both the strided access pattern and the linear one used when a
+  // stride is zero.
+  int64_t extent = *sizes[0] * *sizes[1] * *sizes[2];
+  for (size_t i = 1; i < 4; i++)
+    extent += (*sizes[i] - 1) * *strides[i - 1];
+  return std::make_pair(begin, begin + extent);
+}
+
+bool mayConflict(const Transfer &a, const Transfer &b) {
+  if (a.op.getMemref() != b.op.getMemref())
+    return false;
+  if (!a.isS2MM && !b.isS2MM)
+    return false;
+  if (!a.range || !b.range)
+    return true;
+  return a.range->first < b.range->second && b.range->first < a.range->second;
+}
+
+} // namespace
+
+struct AIEIpuScheduleDmaPass : AIEIpuScheduleDmaBase<AIEIpuScheduleDmaPass> {
+  // Outstanding transfers of each channel, oldest first.
+  std::map<ChannelID, std::deque<Transfer>> outstanding;
+  std::map<int, ShimTile> shimTiles;
+  int64_t numScheduled = 0;
+
+  ShimTile &getShimTile(int col) {
+    auto it = shimTiles.find(col);
+    if (it == shimTiles.end()) {
+      const auto &targetModel = AIE::getTargetModel(getOperation());
+      it = shimTiles.emplace(col, ShimTile(targetModel.getNumBDs(col, 0)))
+               .first;
+    }
+    return it->second;
+  }
+
+  // Insert syncs at the builder's insertion point until the transfer at
+  // position `order` on channel `ch` and all transfers before it have
+  // completed. The transfer is made to issue a token if it does not yet.
+  void waitFor(OpBuilder &builder, Location loc, ChannelID ch, int64_t order) {
+    auto &transfers = outstanding[ch];
+    for (Transfer &t : transfers)
+      if (t.order == order && !t.issuesToken) {
+        t.op.setIssueTokenAttr(builder.getBoolAttr(true));
+        t.issuesToken = true;
+      }
+
+    auto [col, direction, channel] = ch;
+    while (!transfers.empty() && transfers.front().order <= order) {
+      Transfer t = transfers.front();
+      transfers.pop_front();
+      getShimTile(col).inFlight[t.bd] = false;
+      if (!t.issuesToken)
+        continue;
+      builder.create<IpuSyncOp>(loc, col, 0, direction, channel, 1, 1);
+      numSyncsInserted++;
+    }
+  }
+
+  // An existing sync consumes the oldest outstanding token of each channel
+  // it covers.
+  void retire(IpuSyncOp sync) {
+    if (sync.getRow() != 0)
+      return;
+    int begin = sync.getColumn(), end = begin + sync.getColumnNum();
+    for (int col = begin; col < end; col++) {
+      ChannelID ch = {col, static_cast<int>(sync.getDirection()),
+                      static_cast<int>(sync.getChannel())};
+      auto it = outstanding.find(ch);
+      if (it == outstanding.end())
+        continue;
+      auto &transfers = it->second;
+      auto token = llvm::find_if(
+          transfers, [](const Transfer &t) { return t.issuesToken; });
+      if (token == transfers.end())
+        continue;
+      for (auto t = transfers.begin(); t <= token; ++t)
+        getShimTile(col).inFlight[t->bd] = false;
+      transfers.erase(transfers.begin(), std::next(token));
+    }
+  }
+
+  LogicalResult schedule(IpuDmaMemcpyNdOp op) {
+    AIE::DeviceOp device = getOperation();
+    auto infoOp = getAllocOpForSymbol(device, op.getMetadata());
+    if (!infoOp)
+      return op.emitOpError("couldn't find shim_dma_allocation op");
+
+    int col = infoOp->getCol();
+    bool isS2MM = infoOp->getChannelDir() == AIE::DMAChannelDir::S2MM;
+    ChannelID ch = {col, static_cast<int>(infoOp->getChannelDir()),
+                    static_cast<int>(infoOp->getChannelIndex())};
+    Transfer transfer = {op,
+                         -1,
+                         numScheduled++,
+                         isS2MM,
+                         op.getIssueToken().value_or(isS2MM),
+                         getAccessedRange(op)};
+
+    OpBuilder builder(op);
+    Location loc = op.getLoc();
+
+    // Transfers on the same channel run in order, so only transfers on other
+    // channels can race with this one.
+    SmallVector<std::pair<ChannelID, int64_t>> hazards;
+    for (auto &[other, transfers] : outstanding) {
+      if (other == ch)
+        continue;
+      for (const Transfer &t : llvm::reverse(transfers))
+        if (mayConflict(t, transfer)) {
+          hazards.push_back({other, t.order});
+          break;
+        }
+    }
+    for (auto [other, order] : hazards)
+      waitFor(builder, loc, other, order);
+
+    if (queueDepth)
+      while (outstanding[ch].size() >= queueDepth)
+        waitFor(builder, loc, ch, outstanding[ch].front().order);
+
+    ShimTile &tile = getShimTile(col);
+    int bd = tile.findFreeBD();
+    if (bd < 0) {
+      // Wait for the oldest transfer on this shim tile.
+      std::optional<std::pair<ChannelID, int64_t>> oldest;
+      for (auto &[other, transfers] : outstanding)
+        if (std::get<0>(other) == col && !transfers.empty() &&
+            (!oldest || transfers.front().order < oldest->second))
+          oldest = {other, transfers.front().order};
+      if (!oldest)
+        return op.emitOpError("no shim BD available in column ") << col;
+      waitFor(builder, loc, oldest->first, oldest->second);
+      bd = tile.findFreeBD();
+    }
+
+    LLVM_DEBUG(llvm::dbgs() << "bd " << bd << ": " << op << "\n");
+    op.setId(bd);
+    tile.inFlight[bd] = true;
+    tile.lastUse[bd] = transfer.order;
+    transfer.bd = bd;
+    outstanding[ch].push_back(transfer);
+    numTransfers++;
+    return success();
+  }
+
+  void runOnOperation() override {
+    AIE::DeviceOp device = getOperation();
+
+    for (auto f : device.getOps<func::FuncOp>()) {
+      if (f.isDeclaration())
+        continue;
+      outstanding.clear();
+      shimTiles.clear();
+      numScheduled = 0;
+      Block &entry = f.getBody().front();
+
+      // BDs programmed explicitly are never handed out.
+      for (auto writeBd : entry.getOps<IpuWriteBdExShimTileOp>()) {
+        ShimTile &tile = getShimTile(writeBd.getColumn());
+        if (writeBd.getBdId() < tile.reserved.size())
+          tile.reserved[writeBd.getBdId()] = true;
+      }
+
+      for (Operation &op : llvm::make_early_inc_range(entry)) {
+        if (auto sync = dyn_cast<IpuSyncOp>(op))
+          retire(sync);
+        else if (auto dma = dyn_cast<IpuDmaMemcpyNdOp>(op))
+          if (failed(schedule(dma)))
+            return signalPassFailure();
+      }
+
+      // Consume every outstanding token before the sequence ends.
+      OpBuilder builder(entry.getTerminator());
+      for (auto &[ch, transfers] : outstanding) {
+        auto [col, direction, channel] = ch;
+        for (const Transfer &t : transfers)
+          if (t.issuesToken) {
+            builder.create<IpuSyncOp>(f.getLoc(), col, 0, direction, channel,
+                                      1, 1);
+            numSyncsInserted++;
+          }
+      }
+    }
+  }
+};
+
+std::unique_ptr<OperationPass<AIE::DeviceOp>>
+AIEX::createAIEIpuScheduleDmaPass() {
+  return std::make_unique<AIEIpuScheduleDmaPass>();
+}
@@ -122,7 +122,7 @@ struct AIELowerMemcpyPass : public AIELowerMemcpyBase<AIELowerMemcpyPass> {
              "FlowOp");
       builder.create<FlowOp>(builder.getUnknownLoc(), srcTile, WireBundle::DMA,
                              0, dstTile, WireBundle::DMA,
-                             destChannel[op.getDstTile()]);
+                             destChannel[op.getDstTile()], nullptr);
       destChannel[op.getDstTile()]++;
     }
 
@@ -63,7 +63,8 @@ struct AIELowerMulticastPass : public AIEMulticastBase<AIELowerMulticastPass> {
           Port destPort = multiDest.port();
           builder.create<FlowOp>(builder.getUnknownLoc(), srcTile,
                                  sourcePort.bundle, sourcePort.channel,
-                                 destTile, destPort.bundle, destPort.channel);
+                                 destTile, destPort.bundle, destPort.channel,
+                                 nullptr);
         }
       }
     }
@@ -55,6 +55,7 @@ struct AIEXToStandardPass : AIEXToStandardBase<AIEXToStandardPass> {
     removepatterns.add<AIEXOpRemoval<IpuSyncOp>>(m.getContext(), m);
     removepatterns.add<AIEXOpRemoval<IpuWriteBdExShimTileOp>>(m.getContext(),
                                                               m);
+    removepatterns.add<AIEXOpRemoval<IpuPatchOp>>(m.getContext(), m);
 
     if (failed(applyPartialConversion(m, target, std::move(removepatterns))))
       signalPassFailure();
@@ -0,0 +1,193 @@
+//===- AIERegisterModel.cpp -------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Targets/AIERegisterModel.h"
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/xxhash.h"
+
+#include <cassert>
+#include <tuple>
+
+using namespace llvm;
+using namespace xilinx::AIE;
+
+namespace {
+
+using Register = std::tuple<TileID, uint32_t, uint32_t>;
+
+// The page holding the register at `offset`, and its index in the page.
+std::pair<uint32_t, unsigned> locate(uint32_t offset) {
+  assert(offset % 4 == 0 && "registers are 32-bit aligned");
+  uint32_t word = offset / 4;
+  return {word / RegisterModel::PAGE_WORDS, word % RegisterModel::PAGE_WORDS};
+}
+
+} // namespace
+
+void RegisterModel::write32(TileID tile, uint32_t offset, uint32_t value) {
+  auto [pageIndex, index] = locate(offset);
+  Page &page = tiles[tile][pageIndex];
+  page.values[index] = value;
+  page.written.set(index);
+}
+
+void RegisterModel::maskWrite32(TileID tile, uint32_t offset, uint32_t mask,
+                                uint32_t value) {
+  uint32_t current = read32(tile, offset).value_or(0);
+  write32(tile, offset, (current & ~mask) | (value & mask));
+}
+
+void RegisterModel::blockWrite32(TileID tile, uint32_t offset,
+                                 ArrayRef<uint32_t> values) {
+  for (auto [i, value] : llvm::enumerate(values))
+    write32(tile, offset + 4 * i, value);
+}
+
+std::optional<uint32_t> RegisterModel::read32(TileID tile,
+                                              uint32_t offset) const {
+  auto tileIt = tiles.find(tile);
+  if (tileIt == tiles.end())
+    return std::nullopt;
+  auto [pageIndex, index] = locate(offset);
+  auto pageIt = tileIt->second.find(pageIndex);
+  if (pageIt == tileIt->second.end() || !pageIt->second.written[index])
+    return std::nullopt;
+  return pageIt->second.values[index];
+}
+
+size_t RegisterModel::size() const {
+  size_t count = 0;
+  for (auto &[tile, pages] : tiles)
+    for (auto &[pageIndex, page] : pages)
+      count += page.written.count();
+  return count;
+}
+
+void RegisterModel::forEachRun(
+    function_ref<void(TileID, uint32_t, ArrayRef<uint32_t>)> fn) const {
+  SmallVector<uint32_t> run;
+  for (auto &[tile, pages] : tiles) {
+    uint32_t runOffset = 0;
+    for (auto &[pageIndex, page] : pages)
+      for (unsigned i = 0; i < PAGE_WORDS; i++) {
+        uint32_t offset = 4 * (pageIndex * PAGE_WORDS + i);
+        if (!page.written[i]) {
+          if (!run.empty())
+            fn(tile, runOffset, run);
+          run.clear();
+          continue;
+        }
+        if (!run.empty() && runOffset + 4 * run.size() != offset) {
+          fn(tile, runOffset, run);
+          run.clear();
+        }
+        if (run.empty())
+          runOffset = offset;
+        run.push_back(page.values[i]);
+      }
+    if (!run.empty())
+      fn(tile, runOffset, run);
+    run.clear();
+  }
+}
+
+uint64_t RegisterModel::hash() const {
+  SmallVector<uint32_t> words;
+  forEachRun([&](TileID tile, uint32_t offset, ArrayRef<uint32_t> values) {
+    words.append({static_cast<uint32_t>(tile.col),
+                  static_cast<uint32_t>(tile.row), offset,
+                  static_cast<uint32_t>(values.size())});
+    llvm::append_range(words, values);
+  });
+  return xxHash64(ArrayRef(reinterpret_cast<const uint8_t *>(words.data()),
+                           words.size() * sizeof(uint32_t)));
+}
+
+SmallVector<RegisterModel::Difference>
+RegisterModel::diff(const RegisterModel &other) const {
+  auto flatten = [](const RegisterModel &model) {
+    SmallVector<Register> registers;
+    model.forEachRun(
+        [&](TileID tile, uint32_t offset, ArrayRef<uint32_t> values) {
+          for (auto [i, value] : llvm::enumerate(values))
+            registers.push_back({tile, offset + 4 * i, value});
+        });
+    return registers;
+  };
+  SmallVector<Register> before = flatten(*this), after = flatten(other);
+
+  // Both lists are in address order: merge them.
+  SmallVector<Difference> differences;
+  auto *b = before.begin(), *a = after.begin();
+  while (b != before.end() || a != after.end()) {
+    auto key = [](const Register &r) {
+      return std::make_tuple(std::get<0>(r).col, std::get<0>(r).row,
+                             std::get<1>(r));
+    };
+    if (a == after.end() || (b != before.end() && key(*b) < key(*a))) {
+      differences.push_back({std::get<0>(*b), std::get<1>(*b),
+                             std::get<2>(*b), std::nullopt});
+      ++b;
+    } else if (b == before.end() || key(*a) < key(*b)) {
+      differences.push_back({std::get<0>(*a), std::get<1>(*a), std::nullopt,
+                             std::get<2>(*a)});
+      ++a;
+    } else {
+      if (std::get<2>(*b) != std::get<2>(*a))
+        differences.push_back({std::get<0>(*b), std::get<1>(*b),
+                               std::get<2>(*b), std::get<2>(*a)});
+      ++b;
+      ++a;
+    }
+  }
+  return differences;
+}
+
+void RegisterModel::dump(raw_ostream &os) const {
+  os << "registers: " << size() << ", hash: " << format_hex(hash(), 18)
+     << "\n";
+  std::optional<TileID> lastTile;
+  forEachRun([&](TileID tile, uint32_t offset, ArrayRef<uint32_t> values) {
+    if (lastTile != tile)
+      os << "tile(" << tile.col << ", " << tile.row << ")\n";
+    lastTile = tile;
+    for (auto [i, value] : llvm::enumerate(values))
+      os << "  " << format_hex(offset + 4 * i, 7) << ": "
+         << format_hex(value, 10) << "\n";
+  });
+}
+
+void RegisterModel::dumpDiff(const RegisterModel &other,
+                             raw_ostream &os) const {
+  SmallVector<Difference> differences = diff(other);
+  os << "differences: " << differences.size() << "\n";
+  auto printValue = [&os](std::optional<uint32_t> value) {
+    if (value)
+      os << format_hex(*value, 10);
+    else
+      os << "none";
+  };
+  std::optional<TileID> lastTile;
+  for (const Difference &d : differences) {
+    if (lastTile != d.tile)
+      os << "tile(" << d.tile.col << ", " << d.tile.row << ")\n";
+    lastTile = d.tile;
+    os << "  " << format_hex(d.offset, 7) << ": ";
+    printValue(d.before);
+    os << " -> ";
+    printValue(d.after);
+    os << "\n";
+  }
+}
+
+bool RegisterModel::operator==(const RegisterModel &other) const {
+  return diff(other).empty();
+}
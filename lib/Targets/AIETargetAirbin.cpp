@@ -11,6 +11,7 @@
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/IR/AIETargetModel.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
+#include "aie/Targets/AIERegisterModel.h"
 
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
@@ -292,11 +293,11 @@ static const char *secNameStr[SEC_IDX_MAX] = {
 static size_t stridx;
 
 /*
-   Holds a sorted list of all writes made to device memory
+   Holds the value of every register written in device memory
    All recorded writes are time/order invariant. This allows sorting to
    compact the airbin.
 */
-static std::map<uint64_t, uint32_t> memWrites;
+static RegisterModel memWrites;
 
 /*
  * Tile address format:
@@ -333,6 +334,8 @@ public:
 
   uint8_t col() const { return column; }
 
+  TileID tileID() const { return {column, row}; }
+
   void clearRange(uint32_t rangeStart, uint32_t length);
 
 private:
@@ -403,9 +406,7 @@ static void write32(Address addr, uint32_t value) {
         llvm::Twine("address of destination tile <= 0 : ") +
         std::to_string(addr.destTile().col()));
 
-  auto ret = memWrites.emplace(addr, value);
-  if (!ret.second)
-    ret.first->second = value;
+  memWrites.write32(addr.destTile().tileID(), addr.getOffset(), value);
 }
 
 /*
@@ -414,11 +415,8 @@ static void write32(Address addr, uint32_t value) {
         If the address is found return the value, otherwise 0
 */
 static uint32_t read32(Address addr) {
-  auto ret = memWrites.find(addr);
-  if (ret != memWrites.end())
-    return ret->second;
-
-  return 0;
+  return memWrites.read32(addr.destTile().tileID(), addr.getOffset())
+      .value_or(0);
 }
 
 /*
@@ -1095,24 +1093,21 @@ static uint8_t secAddr2Index(uint64_t in) {
         Group the writes into contiguous sections
 */
 static void groupSections(std::vector<Section *> &sections) {
-  uint64_t lastAddr = 0;
-  Section *section = nullptr;
-
-  for (auto write : memWrites) {
-    if (write.first != lastAddr + 4) {
-      if (section)
+  memWrites.forEachRun(
+      [&](TileID tile, uint32_t offset, llvm::ArrayRef<uint32_t> values) {
+        uint64_t addr =
+            TileAddress{static_cast<uint8_t>(tile.col),
+                        static_cast<uint8_t>(tile.row)}
+                .fullAddress(offset);
+        LLVM_DEBUG(llvm::dbgs()
+                   << "Starting new section @ "
+                   << llvm::format("0x%lx (%lu words)\n", addr,
+                                   values.size()));
+        auto *section = new Section(addr);
+        for (uint32_t value : values)
+          section->addData(value);
         sections.push_back(section);
-      section = new Section(write.first);
-      LLVM_DEBUG(llvm::dbgs() << "Starting new section @ "
-                              << llvm::format("0x%lx (last=0x%lx)\n",
-                                              write.first, lastAddr));
-    }
-    assert(section && "section is null");
-    section->addData(write.second);
-    lastAddr = write.first;
-  }
-
-  sections.push_back(section);
+      });
 }
 
 /*
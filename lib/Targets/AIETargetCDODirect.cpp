@@ -6,6 +6,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "aie/Dialect/AIE/IR/AIETargetModel.h"
+#include "aie/Targets/AIERegisterModel.h"
 #include "aie/Targets/AIETargets.h"
 extern "C" {
 #include "cdo_driver.h"
@@ -19,9 +20,11 @@ extern "C" {
 #include "mlir/IR/BuiltinTypeInterfaces.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Region.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Twine.h"
@@ -38,7 +41,10 @@ extern "C" {
 #include <iostream>
 #include <map>
 #include <optional>
+#include <set>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #ifndef NDEBUG
 #define XAIE_DEBUG
@@ -49,9 +55,11 @@ extern "C" {
 #include "xaiengine/xaie_dma.h"
 #include "xaiengine/xaie_elfloader.h"
 #include "xaiengine/xaie_interrupt.h"
+#include "xaiengine/xaie_io.h"
 #include "xaiengine/xaie_locks.h"
 #include "xaiengine/xaie_plif.h"
 #include "xaiengine/xaie_ss.h"
+#include "xaiengine/xaie_txn.h"
 #include "xaiengine/xaiegbl.h"
 #include "xaiengine/xaiegbl_defs.h"
 }
@@ -198,6 +206,11 @@ auto ps = std::filesystem::path::preferred_separator;
 #define BASE_ADDR_A_INCR 0x80000
 #define PARTITION_START_COL 1
 #define PARTITION_NUM_COLS 1
+#define CORE_CONTROL_OFFSET 0x32000
+#define CORE_CONTROL_ENABLE 0x1
+// Words of a block write command beyond its payload: cheaper to rewrite this
+// many unchanged words than to start a new block write.
+#define CDO_BLOCK_WRITE_OVERHEAD 4
 
 namespace xilinx::AIE {
 
@@ -325,11 +338,86 @@ LogicalResult configureBdInBlock(XAie_DevInst &devInst, XAie_DmaDesc &dmaTileBd,
   return success();
 };
 
+// Registers of a tile, as far as coalescing CDO writes is concerned.
+enum class RegisterKind {
+  // Stream switch configuration and the BDs of compute and memory tiles:
+  // reset to zero and never changed by the hardware.
+  Config,
+  // Lock values, and the shim BDs that the runtime sequence reprograms: reset
+  // to zero, but changed once the design runs.
+  DmaState,
+  // Program memory: never changed by the hardware, but not reset either.
+  Program,
+  // DMA channel control and task queues, and core control: writing these
+  // starts or stops the hardware.
+  Control,
+  // Data memories and anything else.
+  Other,
+};
+
+static RegisterKind getRegisterKind(bool isShim, bool isMemTile,
+                                    uint32_t offset) {
+  auto in = [offset](uint32_t begin, uint32_t end) {
+    return offset >= begin && offset < end;
+  };
+  if (isShim) {
+    if (in(0x3F000, 0x3F400))
+      return RegisterKind::Config;
+    if (in(0x1D000, 0x1D200) || in(0x14000, 0x14100))
+      return RegisterKind::DmaState;
+    if (in(0x1D200, 0x1D220))
+      return RegisterKind::Control;
+  } else if (isMemTile) {
+    if (in(0xB0000, 0xB0400) || in(0xA0000, 0xA0600))
+      return RegisterKind::Config;
+    if (in(0xC0000, 0xC0400))
+      return RegisterKind::DmaState;
+    if (in(0xA0600, 0xA0660))
+      return RegisterKind::Control;
+  } else {
+    if (in(0x3F000, 0x3F400) || in(0x1D000, 0x1D200))
+      return RegisterKind::Config;
+    if (in(0x1F000, 0x1F100))
+      return RegisterKind::DmaState;
+    if (in(0x20000, 0x24000))
+      return RegisterKind::Program;
+    if (in(0x1DE00, 0x1DE20) || in(0x32000, 0x32008))
+      return RegisterKind::Control;
+  }
+  return RegisterKind::Other;
+}
+
 struct AIEControl {
   XAie_Config configPtr;
   XAie_DevInst devInst;
-
-  AIEControl(uint8_t partitionNumCols, bool aieSim, const AIETargetModel &tm) {
+  uint8_t partitionNumCols;
+  bool aieSim;
+  const AIETargetModel &targetModel;
+
+  // Whether the register writes of each CDO file are recorded and coalesced
+  // before they are emitted, see emitCoalesced. Writes of reset values are
+  // dropped, so this is only correct on a partition that was reset before the
+  // CDO is loaded, and is off by default.
+  bool coalesceWrites;
+  // Register values known from the writes emitted so far, starting from the
+  // reset state of the partition, and the tiles whose DMAs or core may have
+  // started.
+  DenseMap<uint64_t, uint32_t> knownValues;
+  std::set<std::pair<int, int>> activeTiles;
+
+  // A recorded write, block write, mask write or mask poll. Single writes and
+  // block sets are recorded as block writes.
+  struct Command {
+    XAie_TxnOpcode opcode;
+    uint64_t regOff;
+    uint32_t mask = 0, value = 0;
+    SmallVector<uint32_t> data = {};
+  };
+
+  AIEControl(uint8_t partitionNumCols, bool aieSim, const AIETargetModel &tm,
+             bool coalesceWrites)
+      : partitionNumCols(partitionNumCols), aieSim(aieSim), targetModel(tm),
+        coalesceWrites(coalesceWrites) {
     configPtr = XAie_Config{
         .AieGen = XAIE_DEV_GEN_AIEML,
         .BaseAddr = XAIE_BASE_ADDR,
@@ -351,16 +439,263 @@ struct AIEControl {
     //		more memory from the user application for resource management.
     XAie_InstDeclare(_devInst, &configPtr);
     devInst = _devInst;
+  }
+
+  // Set up the device instance. Must succeed before anything is emitted.
+  LogicalResult initialize() {
     // TODO(max): what is the "partition"?
-    TRY_XAIE_API_FATAL_ERROR(XAie_SetupPartitionConfig, &devInst,
-                             XAIE_PARTITION_BASE_ADDR, PARTITION_START_COL,
-                             partitionNumCols);
-    TRY_XAIE_API_FATAL_ERROR(XAie_CfgInitialize, &devInst, &configPtr);
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_SetupPartitionConfig, &devInst,
+                                XAIE_PARTITION_BASE_ADDR, PARTITION_START_COL,
+                                partitionNumCols);
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_CfgInitialize, &devInst, &configPtr);
     if (aieSim) {
-      TRY_XAIE_API_FATAL_ERROR(XAie_SetIOBackend, &devInst,
-                               XAIE_IO_BACKEND_CDO);
+      TRY_XAIE_API_LOGICAL_RESULT(XAie_SetIOBackend, &devInst,
+                                  XAIE_IO_BACKEND_CDO);
+    }
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_UpdateNpiAddr, &devInst, NPI_ADDR);
+    return success();
+  }
+
+  std::tuple<int, int, RegisterKind> decodeRegister(uint64_t regOff) const {
+    int col = (regOff >> XAIE_COL_SHIFT) & 0x7F;
+    int row = (regOff >> XAIE_ROW_SHIFT) & 0x1F;
+    bool isShim = row == configPtr.ShimRowNum;
+    bool isMemTile = row >= configPtr.MemTileRowStart &&
+                     row < configPtr.MemTileRowStart + configPtr.MemTileNumRows;
+    uint32_t offset = regOff & ((1 << XAIE_ROW_SHIFT) - 1);
+    return {col, row, getRegisterKind(isShim, isMemTile, offset)};
+  }
+
+  // The value of a register, if it is known. DMAs may change locks of their
+  // own and neighbouring tiles, and cores those of their neighbours.
+  std::optional<uint32_t> getKnownValue(uint64_t regOff) const {
+    auto [col, row, kind] = decodeRegister(regOff);
+    auto it = knownValues.find(regOff);
+    switch (kind) {
+    case RegisterKind::DmaState:
+      for (int c = col - 1; c <= col + 1; c++)
+        for (int r = row - 1; r <= row + 1; r++)
+          if (activeTiles.count({c, r}))
+            return std::nullopt;
+      [[fallthrough]];
+    case RegisterKind::Config:
+      return it == knownValues.end() ? 0 : it->second;
+    case RegisterKind::Program:
+      if (it == knownValues.end())
+        return std::nullopt;
+      return it->second;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  void updateKnownValue(uint64_t regOff, uint32_t mask, uint32_t value) {
+    auto [col, row, kind] = decodeRegister(regOff);
+    if (kind == RegisterKind::Control) {
+      // Resetting a core does not start it.
+      bool isCoreControl = (regOff & ((1 << XAIE_ROW_SHIFT) - 1)) ==
+                           CORE_CONTROL_OFFSET;
+      if (!isCoreControl || (mask & value & CORE_CONTROL_ENABLE))
+        activeTiles.insert({col, row});
+    } else if (kind != RegisterKind::Other) {
+      uint32_t known = getKnownValue(regOff).value_or(0);
+      knownValues[regOff] = (known & ~mask) | (value & mask);
+    }
+  }
+
+  // Append a write of `words` from `regOff` to `commands`, merged into the
+  // previous write when their addresses are contiguous. Runs of words that do
+  // not change their register are dropped, unless they are short enough that
+  // starting a new block write after them would cost more.
+  void appendWrite(SmallVectorImpl<Command> &commands, uint64_t regOff,
+                   ArrayRef<uint32_t> words) {
+    auto isRedundant = [&](size_t i) {
+      return getKnownValue(regOff + 4 * i) == words[i];
+    };
+    for (size_t i = 0, e = words.size(); i < e;) {
+      bool redundant = isRedundant(i);
+      size_t end = i + 1;
+      while (end < e && isRedundant(end) == redundant)
+        end++;
+      uint64_t addr = regOff + 4 * i;
+      Command *last = commands.empty() ? nullptr : &commands.back();
+      bool extendsLast = last && last->opcode == XAIE_IO_BLOCKWRITE &&
+                         last->regOff + 4 * last->data.size() == addr;
+      if (redundant &&
+          (!extendsLast || end == e || end - i > CDO_BLOCK_WRITE_OVERHEAD)) {
+        i = end;
+        continue;
+      }
+
+      for (size_t j = i; j < end; j++)
+        updateKnownValue(regOff + 4 * j, 0xFFFFFFFF, words[j]);
+      if (extendsLast)
+        llvm::append_range(last->data, words.slice(i, end - i));
+      else
+        commands.push_back({XAIE_IO_BLOCKWRITE, addr, 0, 0,
+                            SmallVector<uint32_t>(words.slice(i, end - i))});
+      i = end;
+    }
+  }
+
+  // Run `cb` with its register writes recorded in a transaction instead of
+  // being emitted, and append them to `commands`.
+  LogicalResult record(const std::function<LogicalResult()> &cb,
+                       SmallVectorImpl<Command> &commands) {
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_StartTransaction, &devInst,
+                                XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
+    LogicalResult result = cb();
+    XAie_TxnInst *txn = XAie_ExportTransactionInstance(&devInst);
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_ClearTransaction, &devInst);
+    if (!txn) {
+      llvm::errs() << "couldn't export the CDO transaction\n";
+      return failure();
+    }
+
+    for (uint32_t i = 0; succeeded(result) && i < txn->NumCmds; i++) {
+      const XAie_TxnCmd &cmd = txn->CmdBuf[i];
+      switch (cmd.Opcode) {
+      case XAIE_IO_WRITE:
+        commands.push_back({XAIE_IO_BLOCKWRITE, cmd.RegOff, 0, 0, {cmd.Value}});
+        break;
+      case XAIE_IO_BLOCKWRITE: {
+        ArrayRef<uint32_t> data(reinterpret_cast<const uint32_t *>(
+                                    static_cast<uintptr_t>(cmd.DataPtr)),
+                                cmd.Size);
+        commands.push_back({XAIE_IO_BLOCKWRITE, cmd.RegOff, 0, 0,
+                            SmallVector<uint32_t>(data)});
+        break;
+      }
+      case XAIE_IO_BLOCKSET:
+        commands.push_back({XAIE_IO_BLOCKWRITE, cmd.RegOff, 0, 0,
+                            SmallVector<uint32_t>(cmd.Size, cmd.Value)});
+        break;
+      case XAIE_IO_MASKWRITE:
+      case XAIE_IO_MASKPOLL:
+        commands.push_back({cmd.Opcode, cmd.RegOff, cmd.Mask, cmd.Value});
+        break;
+      default:
+        llvm::errs() << "unsupported transaction opcode " << cmd.Opcode
+                     << "\n";
+        result = failure();
+      }
+    }
+    XAie_FreeTransactionInstance(txn);
+    return result;
+  }
+
+  // Coalesce recorded commands against the known register values. Mask writes
+  // to registers whose value is known become plain writes, which can then be
+  // dropped or merged.
+  void coalesce(ArrayRef<Command> recorded,
+                SmallVectorImpl<Command> &commands) {
+    for (const Command &cmd : recorded) {
+      switch (cmd.opcode) {
+      case XAIE_IO_BLOCKWRITE:
+        appendWrite(commands, cmd.regOff, cmd.data);
+        break;
+      case XAIE_IO_MASKWRITE:
+        if (auto known = getKnownValue(cmd.regOff)) {
+          appendWrite(commands, cmd.regOff,
+                      {(*known & ~cmd.mask) | (cmd.value & cmd.mask)});
+          break;
+        }
+        updateKnownValue(cmd.regOff, cmd.mask, cmd.value);
+        commands.push_back(cmd);
+        break;
+      case XAIE_IO_MASKPOLL:
+        // Polling again right away for the same value cannot fail.
+        if (!commands.empty() && commands.back().opcode == XAIE_IO_MASKPOLL &&
+            commands.back().regOff == cmd.regOff &&
+            commands.back().mask == cmd.mask &&
+            commands.back().value == cmd.value)
+          break;
+        commands.push_back(cmd);
+        break;
+      default:
+        llvm_unreachable("unexpected recorded command");
+      }
+    }
+  }
+
+  LogicalResult emit(ArrayRef<Command> commands) {
+    for (const Command &command : commands) {
+      switch (command.opcode) {
+      case XAIE_IO_BLOCKWRITE:
+        if (command.data.size() == 1)
+          TRY_XAIE_API_LOGICAL_RESULT(XAie_Write32, &devInst, command.regOff,
+                                      command.data.front());
+        else
+          TRY_XAIE_API_LOGICAL_RESULT(
+              XAie_BlockWrite32, &devInst, command.regOff,
+              const_cast<uint32_t *>(command.data.data()), command.data.size());
+        break;
+      case XAIE_IO_MASKWRITE:
+        TRY_XAIE_API_LOGICAL_RESULT(XAie_MaskWrite32, &devInst,
+                                    command.regOff, command.mask,
+                                    command.value);
+        break;
+      case XAIE_IO_MASKPOLL:
+        TRY_XAIE_API_LOGICAL_RESULT(XAie_MaskPoll, &devInst, command.regOff,
+                                    command.mask, command.value,
+                                    /*TimeOutUs*/ 0);
+        break;
+      default:
+        llvm_unreachable("unexpected coalesced command");
+      }
     }
-    TRY_XAIE_API_FATAL_ERROR(XAie_UpdateNpiAddr, &devInst, NPI_ADDR);
+    return success();
+  }
+
+  // Apply recorded commands to a model of the register space.
+  void applyCommands(ArrayRef<Command> commands,
+                     RegisterModel &registers) const {
+    for (const Command &cmd : commands) {
+      auto [col, row, kind] = decodeRegister(cmd.regOff);
+      TileID tile = {col, row};
+      uint32_t offset = cmd.regOff & ((1 << XAIE_ROW_SHIFT) - 1);
+      if (cmd.opcode == XAIE_IO_BLOCKWRITE)
+        registers.blockWrite32(tile, offset, cmd.data);
+      else if (cmd.opcode == XAIE_IO_MASKWRITE)
+        registers.maskWrite32(tile, offset, cmd.mask, cmd.value);
+    }
+  }
+
+  // Run `fn(tileCtl, i)` for each i in [0, n) concurrently, each on its own
+  // device instance and transaction, then emit the recorded writes in order
+  // of i so that the output does not depend on scheduling.
+  LogicalResult
+  emitInParallel(MLIRContext *ctx, size_t n,
+                 function_ref<LogicalResult(AIEControl &, size_t)> fn) {
+    std::vector<SmallVector<Command>> recorded(n);
+    if (failed(failableParallelForEachN(ctx, 0, n, [&](size_t i) {
+          AIEControl tileCtl(partitionNumCols, aieSim, targetModel,
+                             /*coalesceWrites*/ false);
+          if (failed(tileCtl.initialize()))
+            return failure();
+          return tileCtl.record([&] { return fn(tileCtl, i); }, recorded[i]);
+        })))
+      return failure();
+    for (ArrayRef<Command> commands : recorded)
+      if (failed(emit(commands)))
+        return failure();
+    return success();
+  }
+
+  // Run `cb` and emit its register writes to the CDO once coalesced: writes
+  // to contiguous addresses become block writes, and writes that leave a
+  // register at its reset or last written value are dropped.
+  LogicalResult emitCoalesced(const std::function<LogicalResult()> &cb) {
+    if (!coalesceWrites)
+      return cb();
+    SmallVector<Command> recorded, commands;
+    if (failed(record(cb, recorded)))
+      return failure();
+    coalesce(recorded, commands);
+    LLVM_DEBUG(llvm::dbgs() << "coalesced " << recorded.size()
+                            << " CDO commands into " << commands.size()
+                            << "\n");
+    return emit(commands);
   }
 
   LogicalResult addErrorHandlingToCDO() {
@@ -379,6 +714,7 @@ struct AIEControl {
 
   LogicalResult addAieElfsToCDO(DeviceOp &targetOp, const StringRef workDirPath,
                                 bool aieSim) {
+    SmallVector<std::tuple<int, int, std::string>> elfs;
     for (auto tileOp : targetOp.getOps<TileOp>())
       if (tileOp.isShimNOCorPLTile()) {
         // Resets no needed with V2 kernel driver
@@ -392,41 +728,21 @@ struct AIEControl {
           else
             fileName = std::string("core_") + std::to_string(col) + "_" +
                        std::to_string(row) + ".elf";
-          if (failed(addAieElfToCDO(col, row, workDirPath.str() + ps + fileName,
-                                    aieSim)))
-            return failure();
+          elfs.push_back({col, row, workDirPath.str() + ps + fileName});
         }
       }
-    return success();
-  }
-
-  LogicalResult addInitConfigToCDO(DeviceOp &targetOp) {
-    for (auto tileOp : targetOp.getOps<TileOp>()) {
-      auto tileLoc = XAie_TileLoc(tileOp.colIndex(), tileOp.rowIndex());
-      if (!tileOp.isShimTile() && tileOp.getCoreOp()) {
-        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreReset, &devInst, tileLoc);
-        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreUnreset, &devInst, tileLoc);
-        // Set locks to zero
-        for (uint8_t l = 0; l < NUM_LOCKS; l++) {
-          auto locInit = XAie_LockInit(l, 0);
-          TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_LockSetValue, &devInst, tileLoc,
-                                  locInit);
-        }
-      }
-    }
 
-    // Set locks with explicit initializers
-    targetOp.walk<WalkOrder::PreOrder>([&](LockOp lockOp) {
-      if (lockOp.getLockID() && lockOp.getInit()) {
-        auto tileLoc = XAie_TileLoc(lockOp.getTileOp().colIndex(),
-                                    lockOp.getTileOp().rowIndex());
-        auto locInit = XAie_LockInit(*lockOp.getLockID(), *lockOp.getInit());
-        TRY_XAIE_API_FATAL_ERROR(XAie_LockSetValue, &devInst, tileLoc, locInit);
-      } else
-        LLVM_DEBUG(llvm::dbgs()
-                   << "lock op missing either id or init" << lockOp << "\n");
-    });
+    // Reading the ELFs dominates: load them concurrently.
+    return emitInParallel(
+        targetOp.getContext(), elfs.size(),
+        [&elfs, aieSim](AIEControl &tileCtl, size_t i) {
+          auto &[col, row, elfPath] = elfs[i];
+          return tileCtl.addAieElfToCDO(col, row, elfPath, aieSim);
+        });
+  }
 
+  // Configure the BDs of a tile DMA and start its channels.
+  LogicalResult addDmaConfigToCDO(TileElement memOp) {
     auto pushToBdQueueAndEnable =
         [this](Operation &op, XAie_LocType &tileLoc, int chNum,
                const DMAChannelDir &channelDir, int bdNum) -> LogicalResult {
@@ -443,109 +759,41 @@ struct AIEControl {
       return success();
     };
 
-    const AIETargetModel &targetModel = targetOp.getTargetModel();
-    auto isOddBd = [&targetModel](int col, int row, int channelIndex) {
+    auto isOddBd = [this](int col, int row, int channelIndex) {
       return targetModel.isMemTile(col, row) && channelIndex & 1;
     };
-    auto memOps = llvm::to_vector_of<TileElement>(targetOp.getOps<MemOp>());
-    llvm::append_range(memOps, targetOp.getOps<MemTileDMAOp>());
-    for (TileElement memOp : memOps) {
-      int col = memOp.getTileID().col;
-      int row = memOp.getTileID().row;
-      auto tileLoc = XAie_TileLoc(col, row);
-      DenseMap<Block *, int> blockBdNumMap;
-
-      // handle DMA ops separately
-      auto dmaOps = llvm::to_vector_of<DMAOp>(
-          memOp.getOperation()->getRegion(0).getOps<DMAOp>());
-      if (!dmaOps.empty()) {
-        int oddBdNum = ODD_BD_NUM_START;
-        int evenBdNum = EVEN_BD_NUM_START;
-        for (auto dmaOp : dmaOps) {
-          auto bdRegions = dmaOp.getBds();
-          for (auto *bdRegionIt = bdRegions.begin();
-               bdRegionIt != bdRegions.end();) {
-            auto &block = bdRegionIt->getBlocks().front();
-            blockBdNumMap[&block] = isOddBd(col, row, dmaOp.getChannelIndex())
-                                        ? oddBdNum++
-                                        : evenBdNum++;
-            std::optional<int> nextBdNum;
-            if (++bdRegionIt != bdRegions.end()) {
-              nextBdNum = isOddBd(col, row, dmaOp.getChannelIndex())
-                              ? oddBdNum
-                              : evenBdNum;
-            } else if (dmaOp.getLoop()) {
-              assert(blockBdNumMap.contains(
-                  &bdRegions.front().getBlocks().front()));
-              nextBdNum = blockBdNumMap[&bdRegions.front().getBlocks().front()];
-            }
-            assert(blockBdNumMap.contains(&block));
-            XAie_DmaDesc dmaTileBd;
-            TRY_XAIE_API_EMIT_ERROR(dmaOp, XAie_DmaDescInit, &devInst,
-                                    &dmaTileBd, tileLoc);
-            if (!block.getOps<UseLockOp>().empty() &&
-                failed(configureLocksInBdBlock(dmaTileBd, block, targetModel,
-                                               tileLoc)))
-              return failure();
-            if (!block.getOps<DMABDOp>().empty() &&
-                failed(configureBdInBlock(devInst, dmaTileBd, block,
-                                          targetModel, tileLoc,
-                                          blockBdNumMap[&block], nextBdNum)))
-              return failure();
-          }
-        }
-      } else {
-        DenseMap<Block *, int> blockChannelMap;
-        // Assign each block a BD number
-        for (Block &block : memOp.getOperation()->getRegion(0))
-          for (auto op : block.getOps<DMAStartOp>()) {
-            int chNum = op.getChannelIndex();
-            blockChannelMap[&block] = chNum;
-            Block *dest = op.getDest();
-            while (dest) {
-              blockChannelMap[dest] = chNum;
-              if (dest->hasNoSuccessors())
-                break;
-              dest = dest->getSuccessors()[0];
-              if (blockChannelMap.contains(dest))
-                dest = nullptr;
-            }
-          }
-
-        // Assign each block a BD number
-        int evenBdNum = EVEN_BD_NUM_START;
-        int oddBdNum = ODD_BD_NUM_START;
-        for (Block &block : memOp.getOperation()->getRegion(0)) {
-          if (block.getOps<DMABDOp>().empty())
-            continue;
-          assert(blockChannelMap.count(&block));
-          if (isOddBd(col, row, blockChannelMap[&block]))
-            blockBdNumMap[&block] = oddBdNum++;
-          else
-            blockBdNumMap[&block] = evenBdNum++;
-        }
-
-        for (Block &block : memOp.getOperation()->getRegion(0)) {
-          if (block.getOps<DMABDOp>().empty())
-            continue;
-          assert(blockBdNumMap.contains(&block));
-          int bdNum = blockBdNumMap[&block];
-
+    int col = memOp.getTileID().col;
+    int row = memOp.getTileID().row;
+    auto tileLoc = XAie_TileLoc(col, row);
+    DenseMap<Block *, int> blockBdNumMap;
+
+    // handle DMA ops separately
+    auto dmaOps = llvm::to_vector_of<DMAOp>(
+        memOp.getOperation()->getRegion(0).getOps<DMAOp>());
+    if (!dmaOps.empty()) {
+      int oddBdNum = ODD_BD_NUM_START;
+      int evenBdNum = EVEN_BD_NUM_START;
+      for (auto dmaOp : dmaOps) {
+        auto bdRegions = dmaOp.getBds();
+        for (auto *bdRegionIt = bdRegions.begin();
+             bdRegionIt != bdRegions.end();) {
+          auto &block = bdRegionIt->getBlocks().front();
+          blockBdNumMap[&block] = isOddBd(col, row, dmaOp.getChannelIndex())
+                                      ? oddBdNum++
+                                      : evenBdNum++;
           std::optional<int> nextBdNum;
-          if (block.getNumSuccessors()) {
-            assert(llvm::range_size(block.getSuccessors()) == 1 &&
-                   "should have only one successor block");
-            Block *nextBlock = block.getSuccessor(0);
-            if (!blockBdNumMap.contains(nextBlock))
-              assert(nextBlock->getOperations().size() == 1 &&
-                     isa<EndOp>(nextBlock->getOperations().front()) &&
-                     "bb that's not in blockMap can only have aie.end");
-            else
-              nextBdNum = blockBdNumMap[nextBlock];
+          if (++bdRegionIt != bdRegions.end()) {
+            nextBdNum = isOddBd(col, row, dmaOp.getChannelIndex())
+                            ? oddBdNum
+                            : evenBdNum;
+          } else if (dmaOp.getLoop()) {
+            assert(blockBdNumMap.contains(
+                &bdRegions.front().getBlocks().front()));
+            nextBdNum = blockBdNumMap[&bdRegions.front().getBlocks().front()];
           }
-
+          assert(blockBdNumMap.contains(&block));
           XAie_DmaDesc dmaTileBd;
-          TRY_XAIE_API_EMIT_ERROR(memOp, XAie_DmaDescInit, &devInst, &dmaTileBd,
+          TRY_XAIE_API_EMIT_ERROR(dmaOp, XAie_DmaDescInit, &devInst, &dmaTileBd,
                                   tileLoc);
           if (!block.getOps<UseLockOp>().empty() &&
               failed(configureLocksInBdBlock(dmaTileBd, block, targetModel,
@@ -553,34 +801,138 @@ struct AIEControl {
             return failure();
           if (!block.getOps<DMABDOp>().empty() &&
               failed(configureBdInBlock(devInst, dmaTileBd, block, targetModel,
-                                        tileLoc, bdNum, nextBdNum)))
+                                        tileLoc, blockBdNumMap[&block],
+                                        nextBdNum)))
             return failure();
         }
       }
+    } else {
+      DenseMap<Block *, int> blockChannelMap;
+      // Assign each block a BD number
+      for (Block &block : memOp.getOperation()->getRegion(0))
+        for (auto op : block.getOps<DMAStartOp>()) {
+          int chNum = op.getChannelIndex();
+          blockChannelMap[&block] = chNum;
+          Block *dest = op.getDest();
+          while (dest) {
+            blockChannelMap[dest] = chNum;
+            if (dest->hasNoSuccessors())
+              break;
+            dest = dest->getSuccessors()[0];
+            if (blockChannelMap.contains(dest))
+              dest = nullptr;
+          }
+        }
 
-      if (!dmaOps.empty())
-        for (auto dmaOp : dmaOps) {
-          auto &block = dmaOp.getBds().front().getBlocks().front();
-          assert(blockBdNumMap.contains(&block));
-          if (failed(pushToBdQueueAndEnable(
-                  *dmaOp.getOperation(), tileLoc, dmaOp.getChannelIndex(),
-                  dmaOp.getChannelDir(), blockBdNumMap[&block])))
+      // Assign each block a BD number
+      int evenBdNum = EVEN_BD_NUM_START;
+      int oddBdNum = ODD_BD_NUM_START;
+      for (Block &block : memOp.getOperation()->getRegion(0)) {
+        if (block.getOps<DMABDOp>().empty())
+          continue;
+        assert(blockChannelMap.count(&block));
+        if (isOddBd(col, row, blockChannelMap[&block]))
+          blockBdNumMap[&block] = oddBdNum++;
+        else
+          blockBdNumMap[&block] = evenBdNum++;
+      }
+
+      for (Block &block : memOp.getOperation()->getRegion(0)) {
+        if (block.getOps<DMABDOp>().empty())
+          continue;
+        assert(blockBdNumMap.contains(&block));
+        int bdNum = blockBdNumMap[&block];
+
+        std::optional<int> nextBdNum;
+        if (block.getNumSuccessors()) {
+          assert(llvm::range_size(block.getSuccessors()) == 1 &&
+                 "should have only one successor block");
+          Block *nextBlock = block.getSuccessor(0);
+          if (!blockBdNumMap.contains(nextBlock))
+            assert(nextBlock->getOperations().size() == 1 &&
+                   isa<EndOp>(nextBlock->getOperations().front()) &&
+                   "bb that's not in blockMap can only have aie.end");
+          else
+            nextBdNum = blockBdNumMap[nextBlock];
+        }
+
+        XAie_DmaDesc dmaTileBd;
+        TRY_XAIE_API_EMIT_ERROR(memOp, XAie_DmaDescInit, &devInst, &dmaTileBd,
+                                tileLoc);
+        if (!block.getOps<UseLockOp>().empty() &&
+            failed(configureLocksInBdBlock(dmaTileBd, block, targetModel,
+                                           tileLoc)))
+          return failure();
+        if (!block.getOps<DMABDOp>().empty() &&
+            failed(configureBdInBlock(devInst, dmaTileBd, block, targetModel,
+                                      tileLoc, bdNum, nextBdNum)))
+          return failure();
+      }
+    }
+
+    if (!dmaOps.empty())
+      for (auto dmaOp : dmaOps) {
+        auto &block = dmaOp.getBds().front().getBlocks().front();
+        assert(blockBdNumMap.contains(&block));
+        if (failed(pushToBdQueueAndEnable(*dmaOp.getOperation(), tileLoc,
+                                          dmaOp.getChannelIndex(),
+                                          dmaOp.getChannelDir(),
+                                          blockBdNumMap[&block])))
+          return failure();
+      }
+    else
+      for (Block &block : memOp.getOperation()->getRegion(0)) {
+        for (auto op : block.getOps<DMAStartOp>()) {
+          assert(blockBdNumMap.contains(op.getDest()));
+          int bdNum = blockBdNumMap[op.getDest()];
+          int chNum = op.getChannelIndex();
+          auto channelDir = op.getChannelDir();
+          if (failed(pushToBdQueueAndEnable(*op.getOperation(), tileLoc, chNum,
+                                            channelDir, bdNum)))
             return failure();
         }
-      else
-        for (Block &block : memOp.getOperation()->getRegion(0)) {
-          for (auto op : block.getOps<DMAStartOp>()) {
-            assert(blockBdNumMap.contains(op.getDest()));
-            int bdNum = blockBdNumMap[op.getDest()];
-            int chNum = op.getChannelIndex();
-            auto channelDir = op.getChannelDir();
-            if (failed(pushToBdQueueAndEnable(*op.getOperation(), tileLoc,
-                                              chNum, channelDir, bdNum)))
-              return failure();
-          }
+      }
+    return success();
+  }
+
+  LogicalResult addInitConfigToCDO(DeviceOp &targetOp) {
+    for (auto tileOp : targetOp.getOps<TileOp>()) {
+      auto tileLoc = XAie_TileLoc(tileOp.colIndex(), tileOp.rowIndex());
+      if (!tileOp.isShimTile() && tileOp.getCoreOp()) {
+        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreReset, &devInst, tileLoc);
+        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreUnreset, &devInst, tileLoc);
+        // Set locks to zero
+        for (uint8_t l = 0; l < NUM_LOCKS; l++) {
+          auto locInit = XAie_LockInit(l, 0);
+          TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_LockSetValue, &devInst, tileLoc,
+                                  locInit);
         }
+      }
     }
 
+    // Set locks with explicit initializers
+    targetOp.walk<WalkOrder::PreOrder>([&](LockOp lockOp) {
+      if (lockOp.getLockID() && lockOp.getInit()) {
+        auto tileLoc = XAie_TileLoc(lockOp.getTileOp().colIndex(),
+                                    lockOp.getTileOp().rowIndex());
+        auto locInit = XAie_LockInit(*lockOp.getLockID(), *lockOp.getInit());
+        TRY_XAIE_API_FATAL_ERROR(XAie_LockSetValue, &devInst, tileLoc, locInit);
+      } else
+        LLVM_DEBUG(llvm::dbgs()
+                   << "lock op missing either id or init" << lockOp << "\n");
+    });
+
+    // The DMAs of each tile are configured independently: record them
+    // concurrently and emit them in order.
+    auto memOps = llvm::to_vector_of<TileElement>(targetOp.getOps<MemOp>());
+    llvm::append_range(memOps, targetOp.getOps<MemTileDMAOp>());
+    if (failed(emitInParallel(
+            targetOp.getContext(), memOps.size(),
+            [&memOps](AIEControl &tileCtl, size_t i) {
+              return tileCtl.addDmaConfigToCDO(memOps[i]);
+            })))
+      return failure();
+
     // StreamSwitch (switchbox) configuration
     for (auto switchboxOp : targetOp.getOps<SwitchboxOp>()) {
       XAie_LocType tileLoc = XAie_TileLoc(switchboxOp.getTileOp().getCol(),
@@ -709,6 +1061,58 @@ struct AIEControl {
     }
     return success();
   }
+
+  // Stop the cores and the tile DMA channels started by a design, so that it
+  // can be reconfigured.
+  LogicalResult addQuiesceToCDO(DeviceOp &targetOp) {
+    for (auto tileOp : targetOp.getOps<TileOp>()) {
+      auto tileLoc = XAie_TileLoc(tileOp.colIndex(), tileOp.rowIndex());
+      if (!tileOp.isShimTile() && tileOp.getCoreOp())
+        TRY_XAIE_API_EMIT_ERROR(targetOp, XAie_CoreDisable, &devInst, tileLoc);
+    }
+
+    auto memOps = llvm::to_vector_of<TileElement>(targetOp.getOps<MemOp>());
+    llvm::append_range(memOps, targetOp.getOps<MemTileDMAOp>());
+    for (TileElement memOp : memOps) {
+      auto tileLoc =
+          XAie_TileLoc(memOp.getTileID().col, memOp.getTileID().row);
+      auto disable = [&](Operation &op, int chNum,
+                         DMAChannelDir channelDir) -> LogicalResult {
+        XAie_DmaDirection direction =
+            channelDir == DMAChannelDir::S2MM ? DMA_S2MM : DMA_MM2S;
+        TRY_XAIE_API_EMIT_ERROR(op, XAie_DmaChannelDisable, &devInst, tileLoc,
+                                chNum, direction);
+        return success();
+      };
+      Region &region = memOp.getOperation()->getRegion(0);
+      for (auto op : region.getOps<DMAOp>())
+        if (failed(disable(*op, op.getChannelIndex(), op.getChannelDir())))
+          return failure();
+      for (Block &block : region)
+        for (auto op : block.getOps<DMAStartOp>())
+          if (failed(disable(*op, op.getChannelIndex(), op.getChannelDir())))
+            return failure();
+    }
+    return success();
+  }
+
+  // Record the register writes that configure and start a design.
+  LogicalResult recordDesign(DeviceOp &targetOp, const StringRef workDirPath,
+                             bool aieSim, SmallVectorImpl<Command> &commands) {
+    return record(
+        [&] {
+          if (!targetOp.getOps<CoreOp>().empty() &&
+              failed(addAieElfsToCDO(targetOp, workDirPath, aieSim)))
+            return failure();
+          if (failed(addInitConfigToCDO(targetOp)))
+            return failure();
+          if (!targetOp.getOps<CoreOp>().empty() &&
+              failed(addCoreEnableToCDO(targetOp)))
+            return failure();
+          return success();
+        },
+        commands);
+  }
 };
 
 } // namespace xilinx::AIE
@@ -720,11 +1124,11 @@ void initializeCDOGenerator(byte_ordering endianness, bool axiDebug) {
   setEndianness(endianness);
 };
 
-LogicalResult generateCDOBinary(const StringRef outputPath,
+LogicalResult generateCDOBinary(AIEControl &ctl, const StringRef outputPath,
                                 const std::function<LogicalResult()> &cb) {
   startCDOFileStream(outputPath.str().c_str());
   FileHeader();
-  if (failed(cb()))
+  if (failed(ctl.emitCoalesced(cb)))
     return failure();
   configureHeader();
   endCurrentCDOFileStream();
@@ -735,12 +1139,12 @@ LogicalResult generateCDOBinariesSeparately(AIEControl &ctl,
                                             const StringRef workDirPath,
                                             DeviceOp &targetOp, bool aieSim) {
   if (failed(generateCDOBinary(
-          workDirPath.str() + ps + "aie_cdo_error_handling.bin",
-          std::bind(&AIEControl::addErrorHandlingToCDO, ctl))))
+          ctl, workDirPath.str() + ps + "aie_cdo_error_handling.bin",
+          [&ctl] { return ctl.addErrorHandlingToCDO(); })))
     return failure();
 
   if (!targetOp.getOps<CoreOp>().empty() &&
-      failed(generateCDOBinary(workDirPath.str() + ps + "aie_cdo_elfs.bin",
+      failed(generateCDOBinary(ctl, workDirPath.str() + ps + "aie_cdo_elfs.bin",
                                [&ctl, &targetOp, &workDirPath, &aieSim] {
                                  return ctl.addAieElfsToCDO(
                                      targetOp, workDirPath, aieSim);
@@ -748,23 +1152,71 @@ LogicalResult generateCDOBinariesSeparately(AIEControl &ctl,
     return failure();
 
   if (failed(generateCDOBinary(
-          workDirPath.str() + ps + "aie_cdo_init.bin",
+          ctl, workDirPath.str() + ps + "aie_cdo_init.bin",
           [&ctl, &targetOp] { return ctl.addInitConfigToCDO(targetOp); })))
     return failure();
 
   if (!targetOp.getOps<CoreOp>().empty() &&
       failed(generateCDOBinary(
-          workDirPath.str() + ps + "aie_cdo_enable.bin",
+          ctl, workDirPath.str() + ps + "aie_cdo_enable.bin",
           [&ctl, &targetOp] { return ctl.addCoreEnableToCDO(targetOp); })))
     return failure();
 
   return success();
 }
 
+LogicalResult generateCDODelta(AIEControl &ctl, const StringRef workDirPath,
+                               DeviceOp &baseOp,
+                               const StringRef baseWorkDirPath,
+                               DeviceOp &targetOp, bool aieSim) {
+  using Command = AIEControl::Command;
+
+  // Replay the base design to learn the state it leaves the partition in.
+  SmallVector<Command> baseCommands, discarded;
+  if (failed(ctl.recordDesign(baseOp, baseWorkDirPath, aieSim, baseCommands)))
+    return failure();
+  ctl.coalesce(baseCommands, discarded);
+
+  SmallVector<Command> quiesce, design;
+  if (failed(ctl.record([&] { return ctl.addQuiesceToCDO(baseOp); },
+                        quiesce)) ||
+      failed(ctl.recordDesign(targetOp, workDirPath, aieSim, design)))
+    return failure();
+
+  // Configuration the new design leaves alone must go back to its reset
+  // value, or stale switch connections and BDs would stay live.
+  RegisterModel baseRegisters, registers;
+  ctl.applyCommands(baseCommands, baseRegisters);
+  ctl.applyCommands(design, registers);
+  SmallVector<uint64_t> stale;
+  for (const RegisterModel::Difference &d : baseRegisters.diff(registers)) {
+    uint64_t regOff = static_cast<uint64_t>(d.tile.col) << XAIE_COL_SHIFT |
+                      static_cast<uint64_t>(d.tile.row) << XAIE_ROW_SHIFT |
+                      d.offset;
+    if (!d.after && *d.before &&
+        std::get<2>(ctl.decodeRegister(regOff)) == RegisterKind::Config)
+      stale.push_back(regOff);
+  }
+
+  SmallVector<Command> recorded(quiesce.begin(), quiesce.end());
+  for (uint64_t regOff : stale)
+    recorded.push_back({XAIE_IO_BLOCKWRITE, regOff, 0, 0, {0}});
+  llvm::append_range(recorded, design);
+
+  SmallVector<Command> commands;
+  ctl.coalesce(recorded, commands);
+  LLVM_DEBUG(llvm::dbgs() << "delta CDO: " << commands.size()
+                          << " commands, " << stale.size()
+                          << " registers reset, full design was "
+                          << design.size() << " commands\n");
+  return generateCDOBinary(ctl, workDirPath.str() + ps + "aie_cdo_delta.bin",
+                           [&ctl, &commands] { return ctl.emit(commands); });
+}
+
 LogicalResult generateCDOUnified(AIEControl &ctl, const StringRef workDirPath,
                                  DeviceOp &targetOp, bool aieSim) {
   return generateCDOBinary(
-      workDirPath.str() + ps + "aie_cdo.bin",
+      ctl, workDirPath.str() + ps + "aie_cdo.bin",
       [&ctl, &targetOp, &workDirPath, &aieSim] {
         if (failed(ctl.addErrorHandlingToCDO()))
           return failure();
@@ -786,7 +1238,7 @@ namespace xilinx::AIE {
 LogicalResult AIETranslateToCDODirect(ModuleOp m, llvm::StringRef workDirPath,
                                       byte_ordering endianness,
                                       bool emitUnified, bool axiDebug,
-                                      bool aieSim) {
+                                      bool aieSim, bool coalesceWrites) {
   auto devOps = m.getOps<DeviceOp>();
   assert(llvm::range_size(devOps) == 1 &&
          "only exactly 1 device op supported.");
@@ -797,10 +1249,89 @@ LogicalResult AIETranslateToCDODirect(ModuleOp m, llvm::StringRef workDirPath,
     maxCol = std::max(tileOp.getCol(), maxCol);
   }
   AIEControl ctl(/*partitionNumCols*/ maxCol - minCol + 1, aieSim,
-                 targetOp.getTargetModel());
+                 targetOp.getTargetModel(), coalesceWrites);
+  if (failed(ctl.initialize()))
+    return failure();
   initializeCDOGenerator(endianness, axiDebug);
   if (emitUnified)
     return generateCDOUnified(ctl, workDirPath, targetOp, aieSim);
   return generateCDOBinariesSeparately(ctl, workDirPath, targetOp, aieSim);
 }
+
+LogicalResult AIETranslateToCDODelta(ModuleOp base, ModuleOp m,
+                                     llvm::StringRef baseWorkDirPath,
+                                     llvm::StringRef workDirPath,
+                                     byte_ordering endianness, bool axiDebug,
+                                     bool aieSim) {
+  auto baseDevOps = base.getOps<DeviceOp>();
+  auto devOps = m.getOps<DeviceOp>();
+  assert(llvm::range_size(baseDevOps) == 1 && llvm::range_size(devOps) == 1 &&
+         "only exactly 1 device op supported.");
+  DeviceOp baseOp = *baseDevOps.begin();
+  DeviceOp targetOp = *devOps.begin();
+  if (baseOp.getDevice() != targetOp.getDevice())
+    return targetOp.emitOpError("delta CDO requires the base design to target "
+                                "the same device");
+  int maxCol = 0, minCol = 0;
+  for (DeviceOp devOp : {baseOp, targetOp})
+    for (auto tileOp : devOp.getOps<TileOp>()) {
+      minCol = std::min(tileOp.getCol(), minCol);
+      maxCol = std::max(tileOp.getCol(), maxCol);
+    }
+  // Commands are coalesced explicitly, across both designs.
+  AIEControl ctl(/*partitionNumCols*/ maxCol - minCol + 1, aieSim,
+                 targetOp.getTargetModel(), /*coalesceWrites*/ false);
+  if (failed(ctl.initialize()))
+    return failure();
+  initializeCDOGenerator(endianness, axiDebug);
+  return generateCDODelta(ctl, workDirPath, baseOp, baseWorkDirPath, targetOp,
+                          aieSim);
+}
+
+// The registers configured by the design of `m`, as its CDO would write them.
+static LogicalResult buildRegisterModel(ModuleOp m, llvm::StringRef workDirPath,
+                                        bool aieSim, RegisterModel &registers) {
+  auto devOps = m.getOps<DeviceOp>();
+  assert(llvm::range_size(devOps) == 1 &&
+         "only exactly 1 device op supported.");
+  DeviceOp targetOp = *devOps.begin();
+  int maxCol = 0, minCol = 0;
+  for (auto tileOp : targetOp.getOps<TileOp>()) {
+    minCol = std::min(tileOp.getCol(), minCol);
+    maxCol = std::max(tileOp.getCol(), maxCol);
+  }
+  AIEControl ctl(/*partitionNumCols*/ maxCol - minCol + 1, aieSim,
+                 targetOp.getTargetModel(), /*coalesceWrites*/ false);
+  if (failed(ctl.initialize()))
+    return failure();
+  SmallVector<AIEControl::Command> commands;
+  if (failed(ctl.recordDesign(targetOp, workDirPath, aieSim, commands)))
+    return failure();
+  ctl.applyCommands(commands, registers);
+  return success();
+}
+
+LogicalResult AIETranslateToRegisterDump(ModuleOp m, raw_ostream &output,
+                                         llvm::StringRef workDirPath,
+                                         bool aieSim) {
+  RegisterModel registers;
+  if (failed(buildRegisterModel(m, workDirPath, aieSim, registers)))
+    return failure();
+  registers.dump(output);
+  return success();
+}
+
+LogicalResult AIETranslateToRegisterDiff(ModuleOp base, ModuleOp m,
+                                         raw_ostream &output,
+                                         llvm::StringRef baseWorkDirPath,
+                                         llvm::StringRef workDirPath,
+                                         bool aieSim) {
+  RegisterModel baseRegisters, registers;
+  if (failed(buildRegisterModel(base, baseWorkDirPath, aieSim,
+                                baseRegisters)) ||
+      failed(buildRegisterModel(m, workDirPath, aieSim, registers)))
+    return failure();
+  baseRegisters.dumpDiff(registers, output);
+  return success();
+}
 } // namespace xilinx::AIE
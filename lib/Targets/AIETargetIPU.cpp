@@ -18,7 +18,10 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
 
 #include <vector>
 
@@ -129,34 +132,84 @@ void appendWriteBdShimTile(std::vector<uint32_t> &instructions,
   words[9] |= op.getLockAcqId() & 0xf;
 }
 
-} // namespace
-
-std::vector<uint32_t> xilinx::AIE::AIETranslateToIPU(ModuleOp module) {
-
-  std::vector<uint32_t> instructions = getProlog();
-
+// Append the instructions of the runtime sequences in `module`. `onPatch` is
+// called for each ipu.patch with the index of the first word of the
+// instruction it patches.
+void appendInstructions(
+    ModuleOp module, std::vector<uint32_t> &instructions,
+    llvm::function_ref<void(IpuPatchOp, size_t)> onPatch = nullptr) {
   DeviceOp deviceOp = *module.getOps<DeviceOp>().begin();
   auto funcOps = deviceOp.getOps<func::FuncOp>();
+  size_t lastInstruction = 0;
   for (auto f : funcOps) {
     if (f.isDeclaration())
       continue;
     Block &entry = f.getRegion().front();
     for (auto &o : entry) {
+      if (isa<IpuSyncOp, IpuWrite32Op, IpuWriteBdExShimTileOp>(o))
+        lastInstruction = instructions.size();
       llvm::TypeSwitch<Operation *>(&o)
           .Case<IpuSyncOp>([&](auto op) { appendSync(instructions, op); })
           .Case<IpuWrite32Op>([&](auto op) { appendWrite32(instructions, op); })
           .Case<IpuWriteBdExShimTileOp>(
-              [&](auto op) { appendWriteBdShimTile(instructions, op); });
+              [&](auto op) { appendWriteBdShimTile(instructions, op); })
+          .Case<IpuPatchOp>([&](auto op) {
+            if (onPatch)
+              onPatch(op, lastInstruction);
+          });
     }
   }
+}
+
+} // namespace
 
+std::vector<uint32_t> xilinx::AIE::AIETranslateToIPU(ModuleOp module) {
+
+  std::vector<uint32_t> instructions = getProlog();
+  appendInstructions(module, instructions);
   return instructions;
 }
 
 LogicalResult xilinx::AIE::AIETranslateToIPU(ModuleOp module,
-                                             raw_ostream &output) {
+                                             raw_ostream &output,
+                                             bool binary) {
   auto instructions = AIETranslateToIPU(module);
+  if (binary) {
+    // Little-endian words, ready to be copied into the instruction buffer.
+    llvm::support::endian::Writer writer(output, llvm::endianness::little);
+    writer.write(llvm::ArrayRef<uint32_t>(instructions));
+    return success();
+  }
   for (auto w : instructions)
     output << llvm::format("%08X\n", w);
   return success();
 }
+
+LogicalResult xilinx::AIE::AIETranslateToIPUPatchTable(ModuleOp module,
+                                                       raw_ostream &output) {
+  std::vector<uint32_t> instructions = getProlog();
+  llvm::json::Array patches;
+  appendInstructions(module, instructions, [&](IpuPatchOp op, size_t start) {
+    llvm::json::Array terms;
+    for (auto [c, args] : llvm::zip(op.getCoefficients(), op.getTerms()))
+      terms.push_back(llvm::json::Object{
+          {"coefficient", c},
+          {"args", llvm::json::Array(
+                       llvm::cast<DenseI32ArrayAttr>(args).asArrayRef())}});
+    patches.push_back(llvm::json::Object{
+        {"word", static_cast<int64_t>(start + op.getWord())},
+        {"shift", op.getShift()},
+        {"mask", op.getMask()},
+        {"min", op.getMinAttr().getInt()},
+        {"max", op.getMaxAttr().getInt()},
+        {"bias", op.getBiasAttr().getInt()},
+        {"terms", std::move(terms)}});
+  });
+
+  output << llvm::formatv(
+      "{0:2}", llvm::json::Value(llvm::json::Object{
+                   {"words", static_cast<int64_t>(instructions.size())},
+                   {"patches", std::move(patches)}}));
+  output << "\n";
+  return success();
+}
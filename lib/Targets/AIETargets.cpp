@@ -22,6 +22,7 @@
 #include "mlir/Dialect/Math/IR/Math.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/Parser/Parser.h"
 #include "mlir/Target/LLVMIR/Export.h"
 #include "mlir/Target/LLVMIR/Import.h"
 #include "mlir/Tools/mlir-translate/Translation.h"
@@ -30,6 +31,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
 
 #define DEBUG_TYPE "aie-targets"
 
@@ -114,6 +116,11 @@ void registerAIETranslations() {
       "tilerow", llvm::cl::desc("row coordinate of core to translate"),
       llvm::cl::init(0));
 
+  static llvm::cl::opt<bool> ipuBinary(
+      "ipu-binary", llvm::cl::init(false),
+      llvm::cl::desc("Emit IPU instructions as little-endian binary words "
+                     "instead of text"));
+
 #ifdef AIE_ENABLE_AIRBIN
   static llvm::cl::opt<std::string> outputFilename(
       "airbin-output-filepath",
@@ -146,6 +153,19 @@ void registerAIETranslations() {
   static llvm::cl::opt<bool> cdoAieSim(
       "cdo-aiesim", llvm::cl::init(false),
       llvm::cl::desc("AIESIM target cdo generation"));
+  static llvm::cl::opt<bool> cdoCoalesce(
+      "cdo-coalesce", llvm::cl::init(false),
+      llvm::cl::desc("Merge contiguous register writes into block writes and "
+                     "drop writes that do not change a register (the CDO "
+                     "must then be loaded on a freshly reset partition)"));
+  static llvm::cl::opt<std::string> cdoDeltaBase(
+      "cdo-delta-base", llvm::cl::Optional,
+      llvm::cl::desc("Design running on the partition, which the delta CDO "
+                     "reconfigures and the register diff compares against"));
+  static llvm::cl::opt<std::string> cdoDeltaBaseWorkDirPath(
+      "cdo-delta-base-work-dir-path", llvm::cl::Optional,
+      llvm::cl::desc("Working directory of the base design (defaults to the "
+                     "directory of cdo-delta-base)"));
 #endif
 
   TranslateFromMLIRRegistration registrationMMap(
@@ -307,15 +327,95 @@ void registerAIETranslations() {
           workDirPath_ = workDirPath.getValue();
         LLVM_DEBUG(llvm::dbgs() << "work-dir-path: " << workDirPath_ << "\n");
         return AIETranslateToCDODirect(module, workDirPath_.c_str(), endianness,
-                                       cdoUnified, axiDebug, cdoAieSim);
+                                       cdoUnified, axiDebug, cdoAieSim,
+                                       cdoCoalesce);
+      },
+      registerDialects);
+  TranslateFromMLIRRegistration registrationRegisterDump(
+      "aie-generate-register-dump",
+      "Print the registers configured by the CDO of a design",
+      [](ModuleOp module, raw_ostream &output) {
+        SmallString<128> workDirPath_;
+        if (workDirPath.getNumOccurrences() == 0) {
+          if (llvm::sys::fs::current_path(workDirPath_))
+            llvm::report_fatal_error(
+                "couldn't get cwd to use as work-dir-path");
+        } else
+          workDirPath_ = workDirPath.getValue();
+        return AIETranslateToRegisterDump(module, output, workDirPath_.c_str(),
+                                          cdoAieSim);
+      },
+      registerDialects);
+  TranslateFromMLIRRegistration registrationRegisterDiff(
+      "aie-generate-register-diff",
+      "Print the registers configured differently by the CDOs of two designs",
+      [](ModuleOp module, raw_ostream &output) {
+        if (cdoDeltaBase.getNumOccurrences() == 0)
+          return module.emitOpError("expected -cdo-delta-base");
+        OwningOpRef<ModuleOp> base = parseSourceFile<ModuleOp>(
+            cdoDeltaBase.getValue(), ParserConfig(module.getContext()));
+        if (!base)
+          return failure();
+
+        SmallString<128> workDirPath_, baseWorkDirPath_;
+        if (workDirPath.getNumOccurrences() == 0) {
+          if (llvm::sys::fs::current_path(workDirPath_))
+            llvm::report_fatal_error(
+                "couldn't get cwd to use as work-dir-path");
+        } else
+          workDirPath_ = workDirPath.getValue();
+        if (cdoDeltaBaseWorkDirPath.getNumOccurrences() == 0) {
+          baseWorkDirPath_ = cdoDeltaBase.getValue();
+          llvm::sys::fs::make_absolute(baseWorkDirPath_);
+          llvm::sys::path::remove_filename(baseWorkDirPath_);
+        } else
+          baseWorkDirPath_ = cdoDeltaBaseWorkDirPath.getValue();
+        return AIETranslateToRegisterDiff(*base, module, output,
+                                          baseWorkDirPath_.c_str(),
+                                          workDirPath_.c_str(), cdoAieSim);
+      },
+      registerDialects);
+  TranslateFromMLIRRegistration registrationCDODelta(
+      "aie-generate-cdo-delta",
+      "Generate a CDO that reconfigures a partition from another design",
+      [](ModuleOp module, raw_ostream &) {
+        if (cdoDeltaBase.getNumOccurrences() == 0)
+          return module.emitOpError("expected -cdo-delta-base");
+        OwningOpRef<ModuleOp> base = parseSourceFile<ModuleOp>(
+            cdoDeltaBase.getValue(), ParserConfig(module.getContext()));
+        if (!base)
+          return failure();
+
+        SmallString<128> workDirPath_, baseWorkDirPath_;
+        if (workDirPath.getNumOccurrences() == 0) {
+          if (llvm::sys::fs::current_path(workDirPath_))
+            llvm::report_fatal_error(
+                "couldn't get cwd to use as work-dir-path");
+        } else
+          workDirPath_ = workDirPath.getValue();
+        if (cdoDeltaBaseWorkDirPath.getNumOccurrences() == 0) {
+          baseWorkDirPath_ = cdoDeltaBase.getValue();
+          llvm::sys::fs::make_absolute(baseWorkDirPath_);
+          llvm::sys::path::remove_filename(baseWorkDirPath_);
+        } else
+          baseWorkDirPath_ = cdoDeltaBaseWorkDirPath.getValue();
+        LLVM_DEBUG(llvm::dbgs() << "base-work-dir-path: " << baseWorkDirPath_
+                                << "\n");
+        return AIETranslateToCDODelta(*base, module, baseWorkDirPath_.c_str(),
+                                      workDirPath_.c_str(), endianness,
+                                      axiDebug, cdoAieSim);
       },
       registerDialects);
 #endif
   TranslateFromMLIRRegistration registrationIPU(
       "aie-ipu-instgen", "Generate instructions for IPU",
       [](ModuleOp module, raw_ostream &output) {
-        return AIETranslateToIPU(module, output);
+        return AIETranslateToIPU(module, output, ipuBinary);
       },
       registerDialects);
+  TranslateFromMLIRRegistration registrationIPUPatchTable(
+      "aie-ipu-patch-table",
+      "Generate the runtime patch table of the IPU instructions",
+      AIETranslateToIPUPatchTable, registerDialects);
 }
 } // namespace xilinx::AIE
@@ -44,7 +44,7 @@ public:
   }
 
   void addFlow(TileID srcCoords, const Port srcPort, TileID dstCoords,
-               const Port dstPort) override {
+               const Port dstPort, int bandwidth) override {
     router.attr("add_flow")(
         PathEndPoint{{srcCoords.col, srcCoords.row}, srcPort},
         PathEndPoint{{dstCoords.col, dstCoords.row}, dstPort});
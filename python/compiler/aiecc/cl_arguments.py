@@ -158,6 +158,19 @@ def parse_args(args=None):
         action="store",
         help="Compile with max n-threads in the machine (default is 4).  An argument of zero corresponds to the maximum number of threads on the machine.",
     )
+    parser.add_argument(
+        "--routing-cache-dir",
+        dest="routing_cache_dir",
+        default=None,
+        help="Directory in which to cache routing results across compilations",
+    )
+    parser.add_argument(
+        "--alloc-scheme",
+        dest="alloc_scheme",
+        default="basic-sequential",
+        choices=["basic-sequential", "bank-aware"],
+        help="Buffer allocation scheme (bank-aware spreads objectFifo buffers over the memory banks)",
+    )
     parser.add_argument(
         "--profile",
         dest="profiling",
@@ -179,6 +192,20 @@ def parse_args(args=None):
         action="store_false",
         help="Compile cores independently in separate processes",
     )
+    parser.add_argument(
+        "--dedup-cores",
+        dest="dedup_cores",
+        default=False,
+        action="store_true",
+        help="Compile cores with identical bodies once and link the object for each tile",
+    )
+    parser.add_argument(
+        "--no-dedup-cores",
+        dest="dedup_cores",
+        default=False,
+        action="store_false",
+        help="Compile every core separately",
+    )
     parser.add_argument(
         "-n",
         dest="execute",
@@ -215,6 +242,20 @@ def parse_args(args=None):
         default="ipu_insts.txt",
         help="Output instructions filename for IPU target",
     )
+    parser.add_argument(
+        "--ipu-optimize",
+        dest="ipu_optimize",
+        default=False,
+        action="store_true",
+        help="Remove redundant writes and merge syncs in the ipu instruction stream",
+    )
+    parser.add_argument(
+        "--ipu-insts-binary",
+        dest="insts_binary",
+        default=False,
+        action="store_true",
+        help="Write the ipu instruction stream as binary words instead of text",
+    )
     parser.add_argument(
         "--aie-generate-cdo",
         dest="cdo",
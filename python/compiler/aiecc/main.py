@@ -17,6 +17,7 @@ import subprocess
 import shutil
 import asyncio
 import glob
+import hashlib
 import random
 import json
 import tempfile
@@ -27,7 +28,7 @@ from aie.extras.runtime.passes import Pipeline
 from aie.extras.util import find_ops
 
 from aie.passmanager import PassManager
-from aie.ir import Module, Context, Location
+from aie.ir import Module, Context, Location, SymbolTable
 from aie.dialects import aie as aiedialect
 
 import aie.compiler.aiecc.cl_arguments
@@ -88,7 +89,10 @@ AIE_LOWER_TO_LLVM += LOWER_TO_LLVM_PIPELINE
 CREATE_PATH_FINDER_FLOWS = Pipeline().Context(
     "aie.device", Pipeline().add_pass("aie-create-pathfinder-flows")
 )
-DMA_TO_IPU = Pipeline().Context("aie.device", Pipeline().add_pass("aie-dma-to-ipu"))
+DMA_TO_IPU = Pipeline().Context(
+    "aie.device",
+    Pipeline().add_pass("aie-ipu-legalize-dma").add_pass("aie-dma-to-ipu"),
+)
 
 
 async def read_file_async(file_path: str) -> str:
@@ -296,6 +300,57 @@ def corefile(dirname, core, ext):
     return os.path.join(dirname, f"core_{col}_{row}.{ext}")
 
 
+# Symbols a deduplicated core object uses in place of those of its tile.
+CANONICAL_CORE_FUNC = "__aie_core"
+CANONICAL_CORE_BUFFER = "__aie_core_buf%d"
+
+
+def canonicalize_core(mlir_module_str, core):
+    """
+    Rename the symbols binding a core lowered to the LLVM dialect to its tile:
+    the core function and the buffers it uses, in order of first use. Cores
+    whose bodies only differ in these symbols then print the same module.
+    Returns the canonical module and a map from each canonical symbol to the
+    symbol of the tile it stands for.
+    """
+    col, row, _ = core
+    core_func_name = f"core_{col}_{row}"
+    with Context(), Location.unknown():
+        module = Module.parse(mlir_module_str)
+        core_func = None
+        buffers = {}
+        for op in module.body.operations:
+            if "sym_name" not in op.attributes:
+                continue
+            name = SymbolTable.get_symbol_name(op).value
+            if op.operation.name == "llvm.func" and name == core_func_name:
+                core_func = op
+            # buffers are declared, without a value, and defined by the linker script
+            elif (
+                op.operation.name == "llvm.mlir.global"
+                and "value" not in op.attributes
+                and len(op.regions[0].blocks) == 0
+            ):
+                buffers[name] = op
+        assert core_func is not None, f"{core_func_name} not found"
+
+        symbols = {CANONICAL_CORE_FUNC: core_func_name}
+        used = []
+        for name in re.findall(r"@([\w$.-]+)", str(core_func)):
+            if name in buffers and name not in used:
+                used.append(name)
+        for name, op in buffers.items():
+            if name not in used:
+                op.operation.erase()
+        for i, name in enumerate(used):
+            canonical = CANONICAL_CORE_BUFFER % i
+            SymbolTable.replace_all_symbol_uses(name, canonical, module.operation)
+            SymbolTable.set_symbol_name(buffers[name], canonical)
+            symbols[canonical] = name
+        SymbolTable.set_symbol_name(core_func, CANONICAL_CORE_FUNC)
+        return str(module), symbols
+
+
 def aie_target_defines(aie_target):
     if aie_target == "AIE2":
         return ["-D__AIEARCH__=20"]
@@ -338,6 +393,9 @@ class FlowRunner:
         self.progress_bar = None
         self.maxtasks = 5
         self.stopall = False
+        self.dedup_cores = False
+        # compilation of each class of identical cores, by canonical module hash
+        self.core_classes = dict()
         self.peano_clang_path = os.path.join(opts.peano_install_dir, "bin", "clang")
         self.peano_opt_path = os.path.join(opts.peano_install_dir, "bin", "opt")
         self.peano_llc_path = os.path.join(opts.peano_install_dir, "bin", "llc")
@@ -434,6 +492,42 @@ class FlowRunner:
             )
             return chess_intrinsic_wrapper_ll_path
 
+    async def compile_canonical_core(self, task, key, canonical, aie_target):
+        file_class = self.prepend_tmp(f"core_class_{key}.opt.mlir")
+        await write_file_async(canonical, file_class)
+        file_class_llvmir = self.prepend_tmp(f"core_class_{key}.ll")
+        file_class_llvmir_stripped = self.prepend_tmp(f"core_class_{key}.stripped.ll")
+        file_class_obj = self.prepend_tmp(f"core_class_{key}.o")
+        # fmt: off
+        await self.do_call(task, ["aie-translate", "--mlir-to-llvmir", file_class, "-o", file_class_llvmir])
+        await self.do_call(task, [self.peano_opt_path, "--passes=default<O2>,strip", "-S", file_class_llvmir, "-o", file_class_llvmir_stripped])
+        await self.do_call(task, [self.peano_llc_path, file_class_llvmir_stripped, "-O2", "--march=" + aie_target.lower(), "--function-sections", "--filetype=obj", "-o", file_class_obj])
+        # fmt: on
+        return file_class_obj
+
+    # Compile the lowered core only once for all the cores with the same
+    # canonical module, and return the object along with the linker arguments
+    # binding its symbols to those of the core's tile.
+    async def compile_core_class(self, task, core, file_opt_core, aie_target):
+        canonical, symbols = canonicalize_core(
+            await read_file_async(file_opt_core), core
+        )
+        key = hashlib.sha256(canonical.encode()).hexdigest()[:16]
+        if key not in self.core_classes:
+            self.core_classes[key] = asyncio.ensure_future(
+                self.compile_canonical_core(task, key, canonical, aie_target)
+            )
+        file_core_obj = await self.core_classes[key]
+
+        link_args = []
+        for canonical_name, name in symbols.items():
+            if canonical_name == CANONICAL_CORE_FUNC:
+                # the linker script enters the core through core_<col>_<row>
+                link_args.append(f"-Wl,--defsym={name}={canonical_name}")
+            else:
+                link_args.append(f"-Wl,--defsym={canonical_name}={name}")
+        return file_core_obj, link_args
+
     async def process_core(
         self,
         core,
@@ -498,7 +592,7 @@ class FlowRunner:
             else:
                 file_core_ldscript = corefile(self.tmpdirname, core, "ld.script")
                 await self.do_call(task, ["aie-translate", file_with_addresses, "--aie-generate-ldscript", "--tilecol=%d" % corecol, "--tilerow=%d" % corerow, "-o", file_core_ldscript])
-            if not self.opts.unified:
+            if not self.opts.unified and not self.dedup_cores:
                 file_core_llvmir = corefile(self.tmpdirname, core, "ll")
                 await self.do_call(task, ["aie-translate", "--mlir-to-llvmir", file_opt_core, "-o", file_core_llvmir])
                 file_core_obj = corefile(self.tmpdirname, core, "o")
@@ -523,7 +617,10 @@ class FlowRunner:
                         await self.do_call(task, [self.peano_clang_path, "-O2", "--target=" + aie_peano_target, file_core_obj, *clang_link_args, "-Wl,-T," + file_core_ldscript, "-o", file_core_elf])
 
             elif opts.compile:
-                if not opts.unified:
+                if self.dedup_cores:
+                    file_core_obj, link_args = await self.compile_core_class(task, core, file_opt_core, aie_target)
+                    clang_link_args += link_args
+                elif not opts.unified:
                     file_core_llvmir_stripped = corefile(self.tmpdirname, core, "stripped.ll")
                     await self.do_call(task, [self.peano_opt_path, "--passes=default<O2>,strip", "-S", file_core_llvmir, "-o", file_core_llvmir_stripped])
                     await self.do_call(task, [self.peano_llc_path, file_core_llvmir_stripped, "-O2", "--march=" + aie_target.lower(), "--function-sections", "--filetype=obj", "-o", file_core_obj])
@@ -618,11 +715,16 @@ class FlowRunner:
 
             # Generate the included host interface
             file_physical = self.prepend_tmp("input_physical.mlir")
+            pathfinder_flows = "--aie-create-pathfinder-flows"
+            if opts.routing_cache_dir:
+                pathfinder_flows += "=routing-cache-dir=" + os.path.abspath(
+                    opts.routing_cache_dir
+                )
             await self.do_call(
                 task,
                 [
                     "aie-opt",
-                    "--aie-create-pathfinder-flows",
+                    pathfinder_flows,
                     "--aie-lower-broadcast-packet",
                     "--aie-create-packet-flows",
                     "--aie-lower-multicast",
@@ -930,17 +1032,21 @@ class FlowRunner:
             )
 
             file_with_addresses = self.prepend_tmp("input_with_addresses.mlir")
+            bank_aware = opts.alloc_scheme == "bank-aware"
             pass_pipeline = ",".join(
                 [
                     "lower-affine",
                     "aie-canonicalize-device",
                     "aie.device(" + "aie-assign-lock-ids",
                     "aie-register-objectFifos",
-                    "aie-objectFifo-stateful-transform",
+                    "aie-objectFifo-stateful-transform"
+                    + ("{bank-conflicts=true}" if bank_aware else ""),
                     "aie-lower-broadcast-packet",
                     "aie-create-packet-flows",
                     "aie-lower-multicast",
-                    "aie-assign-buffer-addresses)",
+                    "aie-assign-buffer-addresses{alloc-scheme="
+                    + opts.alloc_scheme
+                    + "})",
                     "convert-scf-to-cf",
                 ]
             )
@@ -976,7 +1082,11 @@ class FlowRunner:
                     progress_bar.task,
                     [
                         "aie-opt",
+                        "--aie-ipu-legalize-dma",
                         "--aie-dma-to-ipu",
+                    ]
+                    + (["--aie-ipu-peephole"] if opts.ipu_optimize else [])
+                    + [
                         file_with_addresses,
                         "-o",
                         generated_insts_mlir,
@@ -987,6 +1097,9 @@ class FlowRunner:
                     [
                         "aie-translate",
                         "--aie-ipu-instgen",
+                    ]
+                    + (["--ipu-binary"] if opts.insts_binary else [])
+                    + [
                         generated_insts_mlir,
                         "-o",
                         opts.insts_name,
@@ -999,6 +1112,18 @@ class FlowRunner:
                 progress_bar.task, aie_target
             )
 
+            # Identical cores share an object only when compiled separately
+            # by peano and linked with a linker script, which can alias the
+            # symbols of the shared object to those of each tile.
+            self.dedup_cores = (
+                opts.dedup_cores
+                and opts.execute
+                and opts.compile
+                and not opts.xchesscc
+                and not opts.unified
+                and not opts.xbridge
+            )
+
             # fmt: off
             if opts.unified:
                 file_opt_with_addresses = self.prepend_tmp("input_opt_with_addresses.mlir")
@@ -1042,6 +1167,10 @@ class FlowRunner:
                     )
                 )
             await asyncio.gather(*processes)
+            if self.dedup_cores and opts.verbose:
+                print(
+                    f"Compiled {len(cores)} cores as {len(self.core_classes)} objects"
+                )
 
             # Must have elfs, before we build the final binary assembly
             if opts.cdo:
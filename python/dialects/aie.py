@@ -148,6 +148,7 @@ class object_fifo(ObjectFifoCreateOp):
         datatype,
         dimensionsToStream=None,
         dimensionsFromStreamPerConsumer=None,
+        bandwidth=None,
     ):
         self.datatype = datatype
         if not isinstance(consumerTiles, List):
@@ -166,6 +167,7 @@ class object_fifo(ObjectFifoCreateOp):
             elemType=of_Ty,
             dimensionsToStream=dimensionsToStream,
             dimensionsFromStreamPerConsumer=dimensionsFromStreamPerConsumer,
+            bandwidth=None if bandwidth is None else IntegerAttr.get(int_ty, bandwidth),
         )
 
     def acquire(self, num_elem):
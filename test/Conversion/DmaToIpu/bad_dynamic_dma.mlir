@@ -0,0 +1,23 @@
+//===- bad_dynamic_dma.mlir ------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-dma-to-ipu -verify-diagnostics %s
+
+aie.device(ipu) {
+  func.func @sequence(%arg0: memref<64xi32>, %n: i64) {
+    %c0_i64 = arith.constant 0 : i64
+    %c1_i64 = arith.constant 1 : i64
+    %size = arith.addi %n, %c1_i64 : i64
+    // expected-error@+1 {{'aiex.ipu.dma_memcpy_nd' op dynamic sizes and offsets must be arguments of the enclosing function.}}
+    aiex.ipu.dma_memcpy_nd(0, 0, %arg0[%c0_i64, %c0_i64, %c0_i64, %c0_i64][%c1_i64, %c1_i64, %c1_i64, %size][%c0_i64, %c0_i64, %c0_i64]) { metadata = @toMem, id = 1 : i64 } : memref<64xi32>
+    return
+  }
+  aie.shim_dma_allocation @toMem (S2MM, 0, 0)
+}
@@ -8,7 +8,7 @@
 //
 //===----------------------------------------------------------------------===//
 
-// RUN: aie-opt --verify-diagnostics %s
+// RUN: aie-opt --aie-dma-to-ipu --verify-diagnostics %s
 
 module {
   aie.device(ipu) {
@@ -0,0 +1,65 @@
+//===- dynamic_dma_to_ipu.mlir ---------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt -aie-dma-to-ipu %s | FileCheck %s
+// RUN: aie-opt -aie-dma-to-ipu %s | aie-translate --aie-ipu-patch-table | FileCheck %s --check-prefix=TABLE
+
+// Dynamic sizes and offsets are left zero and patched from the arguments.
+// CHECK-LABEL: func.func @test0
+// CHECK: aiex.ipu.writebd_shimtile
+// CHECK-SAME: buffer_length = 0 : i32
+// CHECK-SAME: buffer_offset = 0 : i32
+// CHECK-SAME: d0_size = 64 : i32
+// CHECK-SAME: d1_stride = 63 : i32
+// CHECK-NEXT: aiex.ipu.patch {bias = 0 : i64, coefficients = array<i64: 64>, mask = 4294967295 : ui32, max = 4294967295 : i64, min = 0 : i64, shift = 0 : i32, terms = [array<i32: 1>], word = 2 : i32}
+// CHECK-NEXT: aiex.ipu.patch {bias = 0 : i64, coefficients = array<i64: 256>, mask = 4294967295 : ui32, max = 4294967295 : i64, min = 0 : i64, shift = 0 : i32, terms = [array<i32: 2>], word = 3 : i32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 119300 : ui32, column = 0 : i32, row = 0 : i32, value = 2147483649 : ui32}
+// CHECK-NEXT: aiex.ipu.patch {bias = -1 : i64, coefficients = array<i64: 1>, mask = 255 : ui32, max = 63 : i64, min = 0 : i64, shift = 16 : i32, terms = [array<i32: 3>], word = 2 : i32}
+// CHECK-NEXT: return
+
+// Word indices count from the start of the instruction stream, prolog
+// included.
+// TABLE:      "patches": [
+// TABLE:        "bias": 0,
+// TABLE-NEXT:   "mask": 4294967295,
+// TABLE-NEXT:   "max": 4294967295,
+// TABLE-NEXT:   "min": 0,
+// TABLE-NEXT:   "shift": 0,
+// TABLE-NEXT:   "terms": [
+// TABLE-NEXT:     {
+// TABLE-NEXT:       "args": [
+// TABLE-NEXT:         1
+// TABLE-NEXT:       ],
+// TABLE-NEXT:       "coefficient": 64
+// TABLE-NEXT:     }
+// TABLE-NEXT:   ],
+// TABLE-NEXT:   "word": 19
+// TABLE:        "coefficient": 256
+// TABLE:        "word": 20
+// TABLE:        "bias": -1,
+// TABLE-NEXT:   "mask": 255,
+// TABLE-NEXT:   "max": 63,
+// TABLE-NEXT:   "min": 0,
+// TABLE-NEXT:   "shift": 16,
+// TABLE:        "word": 29
+// TABLE:      "words": 30
+
+module {
+  aie.device(ipu) {
+    func.func @test0(%arg0: memref<64x64xi32>, %rows: i64, %row0: i64, %repeat: i64) {
+      %c0_i64 = arith.constant 0 : i64
+      %c1_i64 = arith.constant 1 : i64
+      %c64_i64 = arith.constant 64 : i64
+      aiex.ipu.dma_memcpy_nd(0, 0, %arg0[%c0_i64, %c0_i64, %row0, %c0_i64][%repeat, %c1_i64, %rows, %c64_i64][%c0_i64, %c0_i64, %c64_i64]) { metadata = @toMem, id = 1 : i64 } : memref<64x64xi32>
+      return
+    }
+    aie.shim_dma_allocation @toMem (S2MM, 0, 0)
+  }
+}
@@ -0,0 +1,24 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// The design that delta.mlir reconfigures.
+
+module @delta_base {
+  aie.device(ipu) {
+    %tile_0_1 = aie.tile(0, 1)
+    %tile_0_2 = aie.tile(0, 2)
+    %buf = aie.buffer(%tile_0_1) {address = 0 : i32} : memref<16xi32>
+    %switchbox_0_1 = aie.switchbox(%tile_0_1) {
+      aie.connect<DMA : 0, North : 0>
+    }
+    %switchbox_0_2 = aie.switchbox(%tile_0_2) {
+      aie.connect<South : 0, DMA : 0>
+    }
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.dma(MM2S, 0) [{
+        aie.dma_bd(%buf : memref<16xi32>, 0, 16)
+      }]
+      aie.end
+    }
+  }
+}
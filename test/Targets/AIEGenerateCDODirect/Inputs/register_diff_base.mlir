@@ -0,0 +1,12 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// The design that register_diff.mlir is compared against.
+
+module @register_diff_base {
+  aie.device(ipu) {
+    %tile_1_3 = aie.tile(1, 3)
+    %lock_a = aie.lock(%tile_1_3, 3) {init = 2 : i32, sym_name = "lock_a"}
+    %lock_b = aie.lock(%tile_1_3, 5) {init = 0 : i32, sym_name = "lock_b"}
+  }
+}
@@ -0,0 +1,56 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// REQUIRES: cdo_direct_generation
+//
+// RUN: mkdir -p %t
+// RUN: aie-translate --aie-generate-cdo --cdo-coalesce --cdo-axi-debug --work-dir-path %t %s 2>&1 | FileCheck %s
+// RUN: aie-translate --aie-generate-cdo --cdo-axi-debug --work-dir-path %t %s 2>&1 | FileCheck %s --check-prefix=NOCOALESCE
+// RUN: aie-translate --aie-generate-cdo-delta --cdo-delta-base %s --cdo-axi-debug --work-dir-path %t %s 2>&1 | FileCheck %s --check-prefix=DELTA
+
+// Lock 0 is initialized to its reset value, so its write is dropped. The last
+// word of BD 0 and the first words of BD 1 are contiguous and are merged into
+// one block write.
+
+// CHECK: Generating: {{.*}}aie_cdo_init.bin
+// CHECK-NOT: Address: 0x{{[0-9A-F]*}}1C0000
+// CHECK: (Write64): Address: 0x{{[0-9A-F]*}}1C0010 Data: 0x00000002
+// CHECK: {{^ +}}Address: 0x{{[0-9A-F]*}}1A001C
+// CHECK-NEXT: {{^ +}}Address: 0x{{[0-9A-F]*}}1A0020
+
+// NOCOALESCE: Generating: {{.*}}aie_cdo_init.bin
+// NOCOALESCE: (Write64): Address: 0x{{[0-9A-F]*}}1C0000 Data: 0x00000000
+// NOCOALESCE: (Write64): Address: 0x{{[0-9A-F]*}}1C0010 Data: 0x00000002
+// NOCOALESCE: Start Address: 0x{{[0-9A-F]*}}1A0000
+// NOCOALESCE: Start Address: 0x{{[0-9A-F]*}}1A0020
+
+// Reconfiguring the design over itself: the DMA of the tile was started by the
+// base design, so the lock values are no longer known and both lock writes are
+// kept, while the unchanged BDs are not written again.
+
+// DELTA: Generating: {{.*}}aie_cdo_delta.bin
+// DELTA: (Write64): Address: 0x{{[0-9A-F]*}}1C0000 Data: 0x00000000
+// DELTA: (Write64): Address: 0x{{[0-9A-F]*}}1C0010 Data: 0x00000002
+// DELTA-NOT: Address: 0x{{[0-9A-F]*}}1A00
+
+module @coalesce {
+  aie.device(ipu) {
+    %tile_0_1 = aie.tile(0, 1)
+    %buf_0 = aie.buffer(%tile_0_1) {address = 0 : i32} : memref<16xi32>
+    %buf_1 = aie.buffer(%tile_0_1) {address = 64 : i32} : memref<16xi32>
+    %cons_lock = aie.lock(%tile_0_1, 0) {init = 0 : i32}
+    %prod_lock = aie.lock(%tile_0_1, 1) {init = 2 : i32}
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.dma(MM2S, 0) [{
+        aie.use_lock(%prod_lock, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock, Release, 1)
+      }, {
+        aie.use_lock(%prod_lock, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock, Release, 1)
+      }]
+      aie.end
+    }
+  }
+}
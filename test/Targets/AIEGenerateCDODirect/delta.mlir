@@ -0,0 +1,49 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// REQUIRES: cdo_direct_generation
+//
+// RUN: mkdir -p %t
+// RUN: aie-translate --aie-generate-cdo-delta --cdo-delta-base %S/Inputs/delta_base.mlir --cdo-axi-debug --work-dir-path %t %s 2>&1 | FileCheck %s
+
+// Compared to Inputs/delta_base.mlir, the BD transfers half as much and the
+// flow from the memtile to (0, 2) moves from channel 0 to channel 1.
+
+// CHECK-LABEL: Generating: {{.*}}aie_cdo_delta.bin
+// The memtile DMA channel is stopped first.
+// CHECK: Address: 0x{{[0-9A-F]*}}1A06{{[0-9A-F]+}}
+// The switch ports that only the base design uses are reset.
+// CHECK: (Write64): Address: 0x{{[0-9A-F]*}}1B0{{[0-9A-F]+}} Data: 0x00000000
+// CHECK: (Write64): Address: 0x{{[0-9A-F]*}}23F{{[0-9A-F]+}} Data: 0x00000000
+// Only the first word of the BD, which holds its length, is written.
+// CHECK: (Write64): Address: 0x{{[0-9A-F]*}}1A0000 Data:
+// CHECK-NOT: Address: 0x{{[0-9A-F]*}}1A00
+// The channel is started again.
+// CHECK: Address: 0x{{[0-9A-F]*}}1A06{{[0-9A-F]+}}
+// CHECK-NOT: Address: 0x{{[0-9A-F]*}}1A00
+// The new switch connections: a master port of the memtile, and a slave port
+// of (0, 2) along with the master port it now feeds.
+// CHECK: Address: 0x{{[0-9A-F]*}}1B0{{[0-9A-F]+}}
+// CHECK: Address: 0x{{[0-9A-F]*}}23F{{[0-9A-F]+}}
+// CHECK: Address: 0x{{[0-9A-F]*}}23F{{[0-9A-F]+}}
+// CHECK-NOT: Address:
+
+module @delta {
+  aie.device(ipu) {
+    %tile_0_1 = aie.tile(0, 1)
+    %tile_0_2 = aie.tile(0, 2)
+    %buf = aie.buffer(%tile_0_1) {address = 0 : i32} : memref<16xi32>
+    %switchbox_0_1 = aie.switchbox(%tile_0_1) {
+      aie.connect<DMA : 0, North : 1>
+    }
+    %switchbox_0_2 = aie.switchbox(%tile_0_2) {
+      aie.connect<South : 1, DMA : 0>
+    }
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.dma(MM2S, 0) [{
+        aie.dma_bd(%buf : memref<16xi32>, 0, 8)
+      }]
+      aie.end
+    }
+  }
+}
@@ -0,0 +1,124 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// REQUIRES: cdo_direct_generation
+//
+// RUN: mkdir -p %t.serial %t.parallel %t.serial.coalesced %t.parallel.coalesced
+// RUN: aie-translate --aie-generate-cdo --mlir-disable-threading --work-dir-path %t.serial %s
+// RUN: aie-translate --aie-generate-cdo --work-dir-path %t.parallel %s
+// RUN: cmp %t.serial/aie_cdo_init.bin %t.parallel/aie_cdo_init.bin
+// RUN: aie-translate --aie-generate-cdo --cdo-coalesce --mlir-disable-threading --work-dir-path %t.serial.coalesced %s
+// RUN: aie-translate --aie-generate-cdo --cdo-coalesce --work-dir-path %t.parallel.coalesced %s
+// RUN: cmp %t.serial.coalesced/aie_cdo_init.bin %t.parallel.coalesced/aie_cdo_init.bin
+
+// The DMAs of the four memtiles are configured concurrently unless threading
+// is disabled. The CDO must not depend on it.
+
+module @parallel {
+  aie.device(ipu) {
+    %tile_0_1 = aie.tile(0, 1)
+    %buf_0_0 = aie.buffer(%tile_0_1) {address = 0 : i32} : memref<16xi32>
+    %buf_0_1 = aie.buffer(%tile_0_1) {address = 64 : i32} : memref<16xi32>
+    %prod_lock_0 = aie.lock(%tile_0_1, 0) {init = 2 : i32}
+    %cons_lock_0 = aie.lock(%tile_0_1, 1) {init = 0 : i32}
+    %memtile_dma_0_1 = aie.memtile_dma(%tile_0_1) {
+      aie.dma(S2MM, 0) [{
+        aie.use_lock(%prod_lock_0, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_0_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_0, Release, 1)
+      }, {
+        aie.use_lock(%prod_lock_0, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_0_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_0, Release, 1)
+      }]
+      aie.dma(MM2S, 0) [{
+        aie.use_lock(%cons_lock_0, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_0_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_0, Release, 1)
+      }, {
+        aie.use_lock(%cons_lock_0, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_0_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_0, Release, 1)
+      }]
+      aie.end
+    }
+    %tile_1_1 = aie.tile(1, 1)
+    %buf_1_0 = aie.buffer(%tile_1_1) {address = 0 : i32} : memref<16xi32>
+    %buf_1_1 = aie.buffer(%tile_1_1) {address = 64 : i32} : memref<16xi32>
+    %prod_lock_1 = aie.lock(%tile_1_1, 0) {init = 2 : i32}
+    %cons_lock_1 = aie.lock(%tile_1_1, 1) {init = 0 : i32}
+    %memtile_dma_1_1 = aie.memtile_dma(%tile_1_1) {
+      aie.dma(S2MM, 0) [{
+        aie.use_lock(%prod_lock_1, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_1_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_1, Release, 1)
+      }, {
+        aie.use_lock(%prod_lock_1, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_1_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_1, Release, 1)
+      }]
+      aie.dma(MM2S, 0) [{
+        aie.use_lock(%cons_lock_1, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_1_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_1, Release, 1)
+      }, {
+        aie.use_lock(%cons_lock_1, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_1_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_1, Release, 1)
+      }]
+      aie.end
+    }
+    %tile_2_1 = aie.tile(2, 1)
+    %buf_2_0 = aie.buffer(%tile_2_1) {address = 0 : i32} : memref<16xi32>
+    %buf_2_1 = aie.buffer(%tile_2_1) {address = 64 : i32} : memref<16xi32>
+    %prod_lock_2 = aie.lock(%tile_2_1, 0) {init = 2 : i32}
+    %cons_lock_2 = aie.lock(%tile_2_1, 1) {init = 0 : i32}
+    %memtile_dma_2_1 = aie.memtile_dma(%tile_2_1) {
+      aie.dma(S2MM, 0) [{
+        aie.use_lock(%prod_lock_2, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_2_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_2, Release, 1)
+      }, {
+        aie.use_lock(%prod_lock_2, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_2_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_2, Release, 1)
+      }]
+      aie.dma(MM2S, 0) [{
+        aie.use_lock(%cons_lock_2, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_2_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_2, Release, 1)
+      }, {
+        aie.use_lock(%cons_lock_2, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_2_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_2, Release, 1)
+      }]
+      aie.end
+    }
+    %tile_3_1 = aie.tile(3, 1)
+    %buf_3_0 = aie.buffer(%tile_3_1) {address = 0 : i32} : memref<16xi32>
+    %buf_3_1 = aie.buffer(%tile_3_1) {address = 64 : i32} : memref<16xi32>
+    %prod_lock_3 = aie.lock(%tile_3_1, 0) {init = 2 : i32}
+    %cons_lock_3 = aie.lock(%tile_3_1, 1) {init = 0 : i32}
+    %memtile_dma_3_1 = aie.memtile_dma(%tile_3_1) {
+      aie.dma(S2MM, 0) [{
+        aie.use_lock(%prod_lock_3, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_3_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_3, Release, 1)
+      }, {
+        aie.use_lock(%prod_lock_3, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_3_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%cons_lock_3, Release, 1)
+      }]
+      aie.dma(MM2S, 0) [{
+        aie.use_lock(%cons_lock_3, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_3_0 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_3, Release, 1)
+      }, {
+        aie.use_lock(%cons_lock_3, AcquireGreaterEqual, 1)
+        aie.dma_bd(%buf_3_1 : memref<16xi32>, 0, 16)
+        aie.use_lock(%prod_lock_3, Release, 1)
+      }]
+      aie.end
+    }
+  }
+}
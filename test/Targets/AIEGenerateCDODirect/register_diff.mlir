@@ -0,0 +1,27 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// REQUIRES: cdo_direct_generation
+//
+// RUN: aie-translate --aie-generate-register-diff --cdo-delta-base %S/Inputs/register_diff_base.mlir %s | FileCheck %s
+// RUN: aie-translate --aie-generate-register-diff --cdo-delta-base %S/Inputs/register_diff_base.mlir %S/Inputs/register_diff_base.mlir | FileCheck %s --check-prefix=SAME
+
+// Compared to the base design, lock_a starts at a different value, lock_b is
+// gone and lock_c is new.
+
+// CHECK: differences: 3
+// CHECK-NEXT: tile(1, 3)
+// CHECK-NEXT:   0x1f030: 0x00000002 -> 0x00000001
+// CHECK-NEXT:   0x1f050: 0x00000000 -> none
+// CHECK-NEXT:   0x1f060: none -> 0x00000001
+
+// SAME: differences: 0
+// SAME-NOT: tile
+
+module @register_diff {
+  aie.device(ipu) {
+    %tile_1_3 = aie.tile(1, 3)
+    %lock_a = aie.lock(%tile_1_3, 3) {init = 1 : i32, sym_name = "lock_a"}
+    %lock_c = aie.lock(%tile_1_3, 6) {init = 1 : i32, sym_name = "lock_c"}
+  }
+}
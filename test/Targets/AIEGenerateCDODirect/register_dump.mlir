@@ -0,0 +1,22 @@
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// REQUIRES: cdo_direct_generation
+//
+// RUN: aie-translate --aie-generate-register-dump %s | FileCheck %s
+
+// The hash is stable: it only changes when the registers this design
+// configures do.
+
+// CHECK: registers: 2, hash: 0x4532b3bc5c197542
+// CHECK-NEXT: tile(1, 3)
+// CHECK-NEXT:   0x1f030: 0x00000002
+// CHECK-NEXT:   0x1f050: 0x00000000
+
+module @register_dump {
+  aie.device(ipu) {
+    %tile_1_3 = aie.tile(1, 3)
+    %lock_a = aie.lock(%tile_1_3, 3) {init = 2 : i32, sym_name = "lock_a"}
+    %lock_b = aie.lock(%tile_1_3, 5) {init = 0 : i32, sym_name = "lock_b"}
+  }
+}
@@ -0,0 +1,28 @@
+//===- ipu_instgen_binary.mlir ---------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-translate --aie-ipu-instgen --ipu-binary %s -o %t.bin
+// RUN: od -A n -t x1 -v %t.bin | FileCheck %s
+
+// The prolog, followed by the write32 as little-endian words.
+// CHECK:      11 00 00 00 05 04 00 01 00 01 00 01 00 01 59 0b
+// CHECK-NEXT: ff 55 00 00 01 00 00 00 10 00 00 00 5f 5a 4e 31
+// CHECK-NEXT: 31 5f 5f 63 6c 69 6e 67 5f 4e 35 39 31 31 69 6e
+// CHECK-NEXT: 73 74 72 5f 77 6f 72 64 73 45 00 00 30 96 bd 07
+// CHECK-NEXT: ff 55 00 00 00 04 03 02 ef 0d c0 ab 42 00 00 00
+// CHECK-NOT: {{.}}
+module {
+  aie.device(ipu) {
+    func.func @test0() {
+      aiex.ipu.write32 { column = 3 : i32, row = 4 : i32, address = 0xabc00def : ui32, value = 0x42 : ui32 }
+      return
+    }
+  }
+}
@@ -0,0 +1,75 @@
+//===- parallel_link.mlir --------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// REQUIRES: cdo_direct_generation
+
+// The cores are linked by concurrent jobs using a stand-in for Peano, whose
+// placeholder ELF files then stop aie2xclbin at CDO generation. The trace of
+// the jobs is printed in tile order whatever order they finish in.
+// RUN: rm -rf %t.prj
+// RUN: not aie2xclbin -v -j 4 --peano %S/Inputs/peano --tmpdir %t.prj --xclbin-name %t.xclbin --ipu-insts-name %t.txt %s > %t.log
+// RUN: FileCheck %s --check-prefix=LOG < %t.log
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_2.elf
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_3.elf
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_4.elf
+
+// LOG: Run: {{.*}}clang {{.*}}-o {{.*}}core_0_2.elf
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}clang {{.*}}-o {{.*}}core_0_3.elf
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}clang {{.*}}-o {{.*}}core_0_4.elf
+// LOG-NEXT: Succeeded
+
+// ELF: clang placeholder
+
+// A failing job is reported for its own core, after the trace of the cores
+// before it, and the cores after it are not reported.
+// RUN: rm -rf %t.fail.prj
+// RUN: env FAKE_PEANO_FAIL=core_0_3.elf not aie2xclbin -v -j 4 --peano %S/Inputs/peano --tmpdir %t.fail.prj --xclbin-name %t.fail.xclbin --ipu-insts-name %t.fail.txt %s > %t.fail.log 2> %t.fail.err
+// RUN: FileCheck %s --check-prefix=FAIL-LOG < %t.fail.log
+// RUN: FileCheck %s --check-prefix=FAIL-ERR < %t.fail.err
+
+// FAIL-LOG: Run: {{.*}}clang {{.*}}-o {{.*}}core_0_2.elf
+// FAIL-LOG-NEXT: Succeeded
+// FAIL-LOG-NEXT: Run: {{.*}}clang {{.*}}-o {{.*}}core_0_3.elf
+// FAIL-LOG-NEXT: Failed
+// FAIL-LOG-NOT: core_0_4.elf
+
+// FAIL-ERR: clang: error: failing on {{.*}}core_0_3.elf
+// FAIL-ERR: error: 'aie.core' op failed to link elf file for core(0,3)
+
+module {
+  aie.device(ipu) {
+    %t02 = aie.tile(0, 2)
+    %t03 = aie.tile(0, 3)
+    %t04 = aie.tile(0, 4)
+    %b02 = aie.buffer(%t02) {sym_name = "b02"} : memref<16xi32>
+    %b03 = aie.buffer(%t03) {sym_name = "b03"} : memref<16xi32>
+    %b04 = aie.buffer(%t04) {sym_name = "b04"} : memref<16xi32>
+    %c02 = aie.core(%t02) {
+      %c0 = arith.constant 0 : index
+      %v = arith.constant 2 : i32
+      memref.store %v, %b02[%c0] : memref<16xi32>
+      aie.end
+    }
+    %c03 = aie.core(%t03) {
+      %c0 = arith.constant 0 : index
+      %v = arith.constant 3 : i32
+      memref.store %v, %b03[%c0] : memref<16xi32>
+      aie.end
+    }
+    %c04 = aie.core(%t04) {
+      %c0 = arith.constant 0 : index
+      %v = arith.constant 4 : i32
+      memref.store %v, %b04[%c0] : memref<16xi32>
+      aie.end
+    }
+  }
+}
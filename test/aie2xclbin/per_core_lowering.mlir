@@ -0,0 +1,98 @@
+//===- per_core_lowering.mlir ----------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// REQUIRES: cdo_direct_generation
+
+// With -unified=false, each core is lowered by a concurrent job from a module
+// holding only that core and the buffers, locks and functions it uses, then
+// compiled and linked by a stand-in for Peano, whose placeholder ELF files
+// then stop aie2xclbin at CDO generation.
+// RUN: rm -rf %t.prj
+// RUN: not aie2xclbin -v -unified=false -j 4 --peano %S/Inputs/peano --tmpdir %t.prj --xclbin-name %t.xclbin --ipu-insts-name %t.txt %s > %t.log
+// RUN: FileCheck %s --check-prefix=LOG < %t.log
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_2.elf
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_3.elf
+// RUN: FileCheck %s --check-prefix=ELF < %t.prj/core_0_4.elf
+// RUN: FileCheck %s --check-prefix=CORE02 < %t.prj/core_0_2.elf.ll
+// RUN: FileCheck %s --check-prefix=CORE03 < %t.prj/core_0_3.elf.ll
+// RUN: FileCheck %s --check-prefix=CORE04 < %t.prj/core_0_4.elf.ll
+
+// LOG: Running per core:
+// LOG: Run: {{.*}}opt {{.*}}core_0_2.elf.ll
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}llc {{.*}}-o {{.*}}core_0_2.elf.o
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}clang {{.*}}core_0_2.elf.o {{.*}}-o {{.*}}core_0_2.elf
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}opt {{.*}}core_0_3.elf.ll
+// LOG: Run: {{.*}}clang {{.*}}core_0_3.elf.o {{.*}}-o {{.*}}core_0_3.elf
+// LOG-NEXT: Succeeded
+// LOG-NEXT: Run: {{.*}}opt {{.*}}core_0_4.elf.ll
+// LOG: Run: {{.*}}clang {{.*}}core_0_4.elf.o {{.*}}-o {{.*}}core_0_4.elf
+// LOG-NEXT: Succeeded
+
+// ELF: clang placeholder
+
+// CORE02-NOT: @b03
+// CORE02-NOT: @b04
+// CORE02: @b02 =
+// CORE02-NOT: @b03
+// CORE02-NOT: @b04
+// CORE02: declare void @ext(i32)
+// CORE02-NOT: @b03
+// CORE02-NOT: @b04
+
+// CORE03-NOT: @ext
+// CORE03-NOT: @b02
+// CORE03: @b03 =
+// CORE03-NOT: @ext
+// CORE03-NOT: @b02
+
+// Core (0, 4) also reads the buffer of core (0, 3).
+// CORE04-NOT: @ext
+// CORE04-NOT: @b02
+// CORE04-DAG: @b03 =
+// CORE04-DAG: @b04 =
+// CORE04-NOT: @ext
+// CORE04-NOT: @b02
+
+module {
+  aie.device(ipu) {
+    %t02 = aie.tile(0, 2)
+    %t03 = aie.tile(0, 3)
+    %t04 = aie.tile(0, 4)
+    %b02 = aie.buffer(%t02) {sym_name = "b02"} : memref<16xi32>
+    %b03 = aie.buffer(%t03) {sym_name = "b03"} : memref<16xi32>
+    %b04 = aie.buffer(%t04) {sym_name = "b04"} : memref<16xi32>
+    %l03 = aie.lock(%t03, 0) {init = 1 : i32}
+    func.func private @ext(i32)
+    %c02 = aie.core(%t02) {
+      %c0 = arith.constant 0 : index
+      %v = arith.constant 2 : i32
+      memref.store %v, %b02[%c0] : memref<16xi32>
+      func.call @ext(%v) : (i32) -> ()
+      aie.end
+    }
+    %c03 = aie.core(%t03) {
+      %c0 = arith.constant 0 : index
+      %v = arith.constant 3 : i32
+      aie.use_lock(%l03, AcquireGreaterEqual, 1)
+      memref.store %v, %b03[%c0] : memref<16xi32>
+      aie.use_lock(%l03, Release, 1)
+      aie.end
+    }
+    %c04 = aie.core(%t04) {
+      %c0 = arith.constant 0 : index
+      %v = memref.load %b03[%c0] : memref<16xi32>
+      memref.store %v, %b04[%c0] : memref<16xi32>
+      aie.end
+    }
+  }
+}
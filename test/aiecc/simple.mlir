@@ -14,6 +14,7 @@
 // RUN: %PYTHON aiecc.py --no-unified --compile --no-link --xchesscc -nv --sysroot=%VITIS_SYSROOT% --host-target=aarch64-linux-gnu %s -I%host_runtime_lib% %host_runtime_lib%/test_library.cpp %S/test.cpp -o test.elf | FileCheck %s --check-prefix=XCHESSCC
 // RUN: %PYTHON aiecc.py --no-unified --compile --no-link --no-xchesscc -nv --sysroot=%VITIS_SYSROOT% --host-target=aarch64-linux-gnu %s -I%host_runtime_lib% %host_runtime_lib%/test_library.cpp %S/test.cpp -o test.elf | FileCheck %s --check-prefix=PEANO
 // RUN: %PYTHON aiecc.py --no-unified --no-compile --no-link -nv --sysroot=%VITIS_SYSROOT% --host-target=aarch64-linux-gnu %s -I%host_runtime_lib% %host_runtime_lib%/test_library.cpp %S/test.cpp -o test.elf | FileCheck %s --check-prefix=NOCOMPILE
+// RUN: %PYTHON aiecc.py --alloc-scheme=bank-aware --no-compile --no-link -nv --sysroot=%VITIS_SYSROOT% --host-target=aarch64-linux-gnu %s -I%host_runtime_lib% %host_runtime_lib%/test_library.cpp %S/test.cpp -o test.elf | FileCheck %s --check-prefix=BANKS
 
 // Note that llc determines the architecture from the llvm IR.
 
@@ -27,6 +28,9 @@
 // NOCOMPILE-NOT: xchesscc_wrapper
 // NOCOMPILE-NOT: {{^[^ ]*llc}}
 
+// BANKS: aie-objectFifo-stateful-transform{bank-conflicts=true}
+// BANKS-SAME: aie-assign-buffer-addresses{alloc-scheme=bank-aware}
+
 module {
   %12 = aie.tile(1, 2)
   %buf = aie.buffer(%12) : memref<256xi32>
@@ -0,0 +1,44 @@
+//===- bank_aware.mlir -----------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=bank-aware" %s | FileCheck %s
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=bank-aware memory-map-report=true" %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=MAP
+
+// The ping and pong buffers land in different banks, the fixed buffer keeps its
+// address and the remaining buffers fill the least used banks around it.
+
+// CHECK: aie.buffer({{.*}}) {address = 16384 : i32, sym_name = "ping"} : memref<1024xi32>
+// CHECK: aie.buffer({{.*}}) {address = 49152 : i32, sym_name = "pong"} : memref<1024xi32>
+// CHECK: aie.buffer({{.*}}) {address = 32768 : i32, sym_name = "fixed"} : memref<64xi32>
+// CHECK: aie.buffer({{.*}}) {address = 1024 : i32, sym_name = "c"} : memref<16xi32>
+// CHECK: aie.buffer({{.*}}) {address = 33024 : i32, sym_name = "d"} : memref<512xi32>
+
+// MAP: remark: memory map, 4 banks
+// MAP: note: MemoryMap:
+// MAP-NEXT: (stack) : 0x0-0x3FF (1024 bytes) bank 0
+// MAP-NEXT: c : 0x400-0x43F (64 bytes) bank 0
+// MAP-NEXT: ping : 0x4000-0x4FFF (4096 bytes) bank 1
+// MAP-NEXT: fixed : 0x8000-0x80FF (256 bytes) bank 2
+// MAP-NEXT: d : 0x8100-0x88FF (2048 bytes) bank 2
+// MAP-NEXT: pong : 0xC000-0xCFFF (4096 bytes) bank 3
+
+module @test {
+ aie.device(xcve2302) {
+  %0 = aie.tile(1, 3)
+  %ping = aie.buffer(%0) { sym_name = "ping" } : memref<1024xi32>
+  %pong = aie.buffer(%0) { sym_name = "pong" } : memref<1024xi32>
+  %fixed = aie.buffer(%0) { sym_name = "fixed", address = 0x8000 : i32 } : memref<64xi32>
+  %c = aie.buffer(%0) { sym_name = "c" } : memref<16xi32>
+  %d = aie.buffer(%0) { sym_name = "d" } : memref<512xi32>
+  aie.core(%0) {
+    aie.end
+  }
+ }
+}
@@ -0,0 +1,22 @@
+//===- bank_aware_error.mlir -----------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: not aie-opt --aie-assign-buffer-addresses="alloc-scheme=bank-aware" %s 2>&1 | FileCheck %s
+// CHECK: error: 'aie.buffer' op at address 0x200 overlaps the stack or another buffer, or exceeds the available memory
+
+module @test {
+ aie.device(xcvc1902) {
+  %0 = aie.tile(3, 3)
+  %b1 = aie.buffer(%0) { sym_name = "a", address = 0x200 : i32 } : memref<16xi8>
+  aie.core(%0) {
+    aie.end
+  }
+ }
+}
@@ -0,0 +1,34 @@
+//===- bank_conflicts.mlir -------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=bank-aware" %s | FileCheck %s
+
+// Banks 0 and 3 are the least used when "c" is placed, but "c" conflicts with
+// "p" in bank 0, so it goes to bank 3.
+
+// CHECK: aie.buffer({{.*}}) {address = 16384 : i32, sym_name = "a"} : memref<1024xi32>
+// CHECK: aie.buffer({{.*}}) {address = 32768 : i32, sym_name = "b"} : memref<768xi32>
+// CHECK: aie.buffer({{.*}}) {address = 49152 : i32, sym_name = "x"} : memref<512xi32>
+// CHECK: aie.buffer({{.*}}) {address = 1024 : i32, sym_name = "p"} : memref<256xi32>
+// CHECK: aie.buffer({{.*}}) {address = 51200 : i32, bank_conflicts = [@p], sym_name = "c"} : memref<128xi32>
+
+module @test {
+ aie.device(xcve2302) {
+  %0 = aie.tile(1, 3)
+  %a = aie.buffer(%0) { sym_name = "a" } : memref<1024xi32>
+  %b = aie.buffer(%0) { sym_name = "b" } : memref<768xi32>
+  %x = aie.buffer(%0) { sym_name = "x" } : memref<512xi32>
+  %p = aie.buffer(%0) { sym_name = "p" } : memref<256xi32>
+  %c = aie.buffer(%0) { sym_name = "c", bank_conflicts = [@p] } : memref<128xi32>
+  aie.core(%0) {
+    aie.end
+  }
+ }
+}
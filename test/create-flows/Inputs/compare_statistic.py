@@ -0,0 +1,31 @@
+# compare_statistic.py -*- Python -*-
+#
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# (c) Copyright 2023 Advanced Micro Devices, Inc.
+
+# Usage: compare_statistic.py NAME LESS GREATER
+#
+# Reads the -mlir-pass-statistics output in the files LESS and GREATER and
+# fails unless statistic NAME is strictly smaller in LESS than in GREATER.
+
+import re
+import sys
+
+
+def read_statistic(name, path):
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"\s*\(S\)\s+(\d+)\s+" + re.escape(name) + r"\b", line)
+            if m:
+                return int(m.group(1))
+    sys.exit(f"{path}: no statistic named '{name}'")
+
+
+name, less, greater = sys.argv[1:4]
+a = read_statistic(name, less)
+b = read_statistic(name, greater)
+if a >= b:
+    sys.exit(f"{name}: expected {a} ({less}) < {b} ({greater})")
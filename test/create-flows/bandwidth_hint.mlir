@@ -0,0 +1,60 @@
+//===- bandwidth_hint.mlir -------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt %s | FileCheck %s --check-prefix=HINT
+// RUN: aie-opt --aie-create-pathfinder-flows %s | FileCheck %s
+
+// HINT: aie.flow(%{{.*}}, DMA : 0, %{{.*}}, DMA : 0) {bandwidth = 4 : i32}
+
+// Five flows want the four eastward channels out of tile (1, 3). Without the
+// hint, the flow from (0, 3) to (4, 3) detours through row 2; with it, that
+// flow keeps the straight route along row 3 and a flow from (1, 3) detours.
+
+// CHECK: %[[T03:.*]] = aie.tile(0, 3)
+// CHECK: %[[T13:.*]] = aie.tile(1, 3)
+// CHECK: %[[T23:.*]] = aie.tile(2, 3)
+// CHECK: %[[T33:.*]] = aie.tile(3, 3)
+// CHECK: %[[T43:.*]] = aie.tile(4, 3)
+// CHECK: aie.switchbox(%[[T13]]) {
+// CHECK-NOT: }
+// CHECK:   aie.connect<West : 0, East : 0>
+// CHECK: }
+// CHECK: aie.switchbox(%[[T23]]) {
+// CHECK-NOT: }
+// CHECK:   aie.connect<West : 0, East : 0>
+// CHECK: }
+// CHECK: aie.switchbox(%[[T33]]) {
+// CHECK-NOT: }
+// CHECK:   aie.connect<West : 0, East : 0>
+// CHECK: }
+// CHECK: aie.switchbox(%[[T03]]) {
+// CHECK-NEXT:   aie.connect<DMA : 0, East : 0>
+// CHECK-NEXT: }
+// CHECK: aie.switchbox(%[[T43]]) {
+// CHECK-NEXT:   aie.connect<West : 0, DMA : 0>
+// CHECK-NEXT: }
+
+module {
+  aie.device(xcvc1902) {
+    %t03 = aie.tile(0, 3)
+    %t13 = aie.tile(1, 3)
+    %t23 = aie.tile(2, 3)
+    %t33 = aie.tile(3, 3)
+    %t43 = aie.tile(4, 3)
+    %t14 = aie.tile(1, 4)
+    %t24 = aie.tile(2, 4)
+    %t34 = aie.tile(3, 4)
+    aie.flow(%t13, DMA : 0, %t33, DMA : 0)
+    aie.flow(%t13, DMA : 1, %t33, DMA : 1)
+    aie.flow(%t13, Core : 0, %t33, Core : 0)
+    aie.flow(%t13, Core : 1, %t33, Core : 1)
+    aie.flow(%t03, DMA : 0, %t43, DMA : 0) {bandwidth = 4 : i32}
+  }
+}
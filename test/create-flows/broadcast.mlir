@@ -9,6 +9,9 @@
 //===----------------------------------------------------------------------===//
 
 // RUN: aie-opt --aie-create-pathfinder-flows --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="fanout-aware=true" --aie-find-flows %s | FileCheck %s --check-prefix=FANOUT
+// RUN: aie-opt --aie-create-pathfinder-flows -mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+// RUN: aie-opt --aie-create-pathfinder-flows="fanout-aware=true" -mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=FANOUT-STATS
 // CHECK: %[[T03:.*]] = aie.tile(0, 3)
 // CHECK: %[[T02:.*]] = aie.tile(0, 2)
 // CHECK: %[[T00:.*]] = aie.tile(0, 0)
@@ -37,6 +40,32 @@
 // CHECK: aie.flow(%[[T60]], DMA : 0, %[[T31]], DMA : 1)
 // CHECK: aie.flow(%[[T60]], DMA : 0, %[[T02]], DMA : 1)
 
+// FANOUT: %[[T02:.*]] = aie.tile(0, 2)
+// FANOUT: %[[T13:.*]] = aie.tile(1, 3)
+// FANOUT: %[[T20:.*]] = aie.tile(2, 0)
+// FANOUT: %[[T22:.*]] = aie.tile(2, 2)
+// FANOUT: %[[T31:.*]] = aie.tile(3, 1)
+// FANOUT: %[[T60:.*]] = aie.tile(6, 0)
+// FANOUT: %[[T71:.*]] = aie.tile(7, 1)
+// FANOUT: %[[T82:.*]] = aie.tile(8, 2)
+// FANOUT: %[[T83:.*]] = aie.tile(8, 3)
+//
+// FANOUT-DAG: aie.flow(%[[T20]], DMA : 0, %[[T71]], DMA : 0)
+// FANOUT-DAG: aie.flow(%[[T20]], DMA : 0, %[[T82]], DMA : 0)
+// FANOUT-DAG: aie.flow(%[[T20]], DMA : 0, %[[T31]], DMA : 0)
+// FANOUT-DAG: aie.flow(%[[T20]], DMA : 0, %[[T13]], DMA : 0)
+// FANOUT-DAG: aie.flow(%[[T60]], DMA : 0, %[[T83]], DMA : 1)
+// FANOUT-DAG: aie.flow(%[[T60]], DMA : 0, %[[T22]], DMA : 1)
+// FANOUT-DAG: aie.flow(%[[T60]], DMA : 0, %[[T31]], DMA : 1)
+// FANOUT-DAG: aie.flow(%[[T60]], DMA : 0, %[[T02]], DMA : 1)
+
+// Routing each destination back to the source separately takes 34 channels;
+// growing a tree from the part of the flow already routed takes 24.
+// STATS-DAG: (S) 34 channels-used
+// STATS-DAG: (S) 34 source-rooted-channels-used
+// FANOUT-STATS-DAG: (S) 24 channels-used
+// FANOUT-STATS-DAG: (S) 34 source-rooted-channels-used
+
 module {
     aie.device(xcvc1902) {
         %t03 = aie.tile(0, 3)
@@ -0,0 +1,107 @@
+//===- incremental_reroute.mlir --------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// The flows of over_flows.mlir and eight more, so that the first iteration
+// leaves some channels over capacity. Every router mode finds the flows, in
+// two iterations. Rerouting only the flows on congested channels needs fewer
+// shortest path searches than rerouting every flow, and A* expands fewer
+// switchboxes than Dijkstra.
+
+// RUN: aie-opt --aie-create-pathfinder-flows --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="incremental=true" --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="astar-max-destinations=1" --aie-find-flows %s | FileCheck %s
+
+// RUN: aie-opt --aie-create-pathfinder-flows -mlir-pass-statistics %s -o /dev/null 2> %t.full
+// RUN: aie-opt --aie-create-pathfinder-flows="incremental=true" -mlir-pass-statistics %s -o /dev/null 2> %t.incremental
+// RUN: aie-opt --aie-create-pathfinder-flows="astar-max-destinations=1" -mlir-pass-statistics %s -o /dev/null 2> %t.astar
+// RUN: FileCheck %s --check-prefix=STATS < %t.full
+// RUN: FileCheck %s --check-prefix=STATS < %t.incremental
+// RUN: FileCheck %s --check-prefix=STATS < %t.astar
+// RUN: %PYTHON %S/Inputs/compare_statistic.py dijkstra-calls %t.incremental %t.full
+// RUN: %PYTHON %S/Inputs/compare_statistic.py nodes-expanded %t.astar %t.full
+
+// STATS: (S) 2 iterations
+
+// CHECK: %[[T03:.*]] = aie.tile(0, 3)
+// CHECK: %[[T02:.*]] = aie.tile(0, 2)
+// CHECK: %[[T00:.*]] = aie.tile(0, 0)
+// CHECK: %[[T13:.*]] = aie.tile(1, 3)
+// CHECK: %[[T11:.*]] = aie.tile(1, 1)
+// CHECK: %[[T10:.*]] = aie.tile(1, 0)
+// CHECK: %[[T20:.*]] = aie.tile(2, 0)
+// CHECK: %[[T30:.*]] = aie.tile(3, 0)
+// CHECK: %[[T22:.*]] = aie.tile(2, 2)
+// CHECK: %[[T31:.*]] = aie.tile(3, 1)
+// CHECK: %[[T60:.*]] = aie.tile(6, 0)
+// CHECK: %[[T70:.*]] = aie.tile(7, 0)
+// CHECK: %[[T71:.*]] = aie.tile(7, 1)
+// CHECK: %[[T72:.*]] = aie.tile(7, 2)
+// CHECK: %[[T73:.*]] = aie.tile(7, 3)
+// CHECK: %[[T80:.*]] = aie.tile(8, 0)
+// CHECK: %[[T82:.*]] = aie.tile(8, 2)
+// CHECK: %[[T83:.*]] = aie.tile(8, 3)
+//
+// CHECK: aie.flow(%[[T02]], DMA : 0, %[[T72]], DMA : 1)
+// CHECK: aie.flow(%[[T20]], DMA : 0, %[[T73]], DMA : 1)
+// CHECK: aie.flow(%[[T30]], DMA : 1, %[[T13]], DMA : 0)
+// CHECK: aie.flow(%[[T22]], DMA : 0, %[[T72]], DMA : 0)
+// CHECK: aie.flow(%[[T22]], DMA : 1, %[[T82]], DMA : 0)
+// CHECK: aie.flow(%[[T31]], DMA : 1, %[[T82]], DMA : 1)
+// CHECK: aie.flow(%[[T60]], DMA : 1, %[[T03]], DMA : 0)
+// CHECK: aie.flow(%[[T70]], DMA : 1, %[[T02]], DMA : 0)
+// CHECK: aie.flow(%[[T71]], DMA : 0, %[[T20]], DMA : 0)
+// CHECK: aie.flow(%[[T71]], DMA : 1, %[[T20]], DMA : 1)
+// CHECK: aie.flow(%[[T72]], DMA : 0, %[[T60]], DMA : 0)
+// CHECK: aie.flow(%[[T72]], DMA : 1, %[[T60]], DMA : 1)
+// CHECK: aie.flow(%[[T73]], DMA : 0, %[[T70]], DMA : 0)
+// CHECK: aie.flow(%[[T73]], DMA : 1, %[[T70]], DMA : 1)
+// CHECK: aie.flow(%[[T83]], DMA : 0, %[[T30]], DMA : 0)
+// CHECK: aie.flow(%[[T83]], DMA : 1, %[[T30]], DMA : 1)
+
+module {
+    aie.device(xcvc1902) {
+        %t03 = aie.tile(0, 3)
+        %t02 = aie.tile(0, 2)
+        %t00 = aie.tile(0, 0)
+        %t13 = aie.tile(1, 3)
+        %t11 = aie.tile(1, 1)
+        %t10 = aie.tile(1, 0)
+        %t20 = aie.tile(2, 0)
+        %t30 = aie.tile(3, 0)
+        %t22 = aie.tile(2, 2)
+        %t31 = aie.tile(3, 1)
+        %t60 = aie.tile(6, 0)
+        %t70 = aie.tile(7, 0)
+        %t71 = aie.tile(7, 1)
+        %t72 = aie.tile(7, 2)
+        %t73 = aie.tile(7, 3)
+        %t80 = aie.tile(8, 0)
+        %t82 = aie.tile(8, 2)
+        %t83 = aie.tile(8, 3)
+
+        aie.flow(%t71, DMA : 0, %t20, DMA : 0)
+        aie.flow(%t71, DMA : 1, %t20, DMA : 1)
+        aie.flow(%t72, DMA : 0, %t60, DMA : 0)
+        aie.flow(%t72, DMA : 1, %t60, DMA : 1)
+        aie.flow(%t73, DMA : 0, %t70, DMA : 0)
+        aie.flow(%t73, DMA : 1, %t70, DMA : 1)
+        aie.flow(%t83, DMA : 0, %t30, DMA : 0)
+        aie.flow(%t83, DMA : 1, %t30, DMA : 1)
+        aie.flow(%t20, DMA : 0, %t73, DMA : 1)
+        aie.flow(%t02, DMA : 0, %t72, DMA : 1)
+        aie.flow(%t30, DMA : 1, %t13, DMA : 0)
+        aie.flow(%t31, DMA : 1, %t82, DMA : 1)
+        aie.flow(%t60, DMA : 1, %t03, DMA : 0)
+        aie.flow(%t70, DMA : 1, %t02, DMA : 0)
+        aie.flow(%t22, DMA : 1, %t82, DMA : 0)
+        aie.flow(%t22, DMA : 0, %t72, DMA : 0)
+    }
+}
+
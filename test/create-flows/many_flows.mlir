@@ -9,6 +9,10 @@
 //===----------------------------------------------------------------------===//
 
 // RUN: aie-opt --aie-create-pathfinder-flows --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel-batch-size=4" --mlir-disable-threading %s -o %t.serial.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel-batch-size=4" %s -o %t.parallel.mlir
+// RUN: diff %t.serial.mlir %t.parallel.mlir
+// RUN: aie-opt --aie-find-flows %t.parallel.mlir | FileCheck %s
 // CHECK: %[[T02:.*]] = aie.tile(0, 2)
 // CHECK: %[[T03:.*]] = aie.tile(0, 3)
 // CHECK: %[[T11:.*]] = aie.tile(1, 1)
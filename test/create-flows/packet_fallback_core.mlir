@@ -0,0 +1,245 @@
+//===- packet_fallback_core.mlir -------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// packet_fallback.mlir with the flows of the top row sent by the cores, which
+// cannot send packet headers. Only the congested flows from DMA channels with
+// BDs become packet flows; the others keep their circuit and are named in a
+// remark.
+
+// RUN: aie-opt --aie-create-pathfinder-flows="packet-fallback=true" --verify-diagnostics %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="packet-fallback=true" -mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+
+// CHECK: %[[T04:.*]] = aie.tile(0, 4)
+// CHECK-LABEL: aie.mem(%tile_4_3)
+// CHECK:         aie.dma_bd_packet(0, 15)
+// CHECK-NEXT:    aie.dma_bd(
+// CHECK: aie.switchbox(%[[T04]]) {
+// CHECK-NOT: aie.switchbox
+// CHECK: aie.connect<Core : 0,
+
+// STATS: (S) 15 flows-demoted
+
+module {
+    aie.device(xcvc1902) {
+        %t01 = aie.tile(0, 1)
+        %t11 = aie.tile(1, 1)
+        %t21 = aie.tile(2, 1)
+        %t31 = aie.tile(3, 1)
+        %t41 = aie.tile(4, 1)
+        %t51 = aie.tile(5, 1)
+        %t61 = aie.tile(6, 1)
+        %t71 = aie.tile(7, 1)
+        %t81 = aie.tile(8, 1)
+        %t02 = aie.tile(0, 2)
+        %t12 = aie.tile(1, 2)
+        %t22 = aie.tile(2, 2)
+        %t32 = aie.tile(3, 2)
+        %t42 = aie.tile(4, 2)
+        %t52 = aie.tile(5, 2)
+        %t62 = aie.tile(6, 2)
+        %t72 = aie.tile(7, 2)
+        %t82 = aie.tile(8, 2)
+        %t03 = aie.tile(0, 3)
+        %t13 = aie.tile(1, 3)
+        %t23 = aie.tile(2, 3)
+        %t33 = aie.tile(3, 3)
+        %t43 = aie.tile(4, 3)
+        %t53 = aie.tile(5, 3)
+        %t63 = aie.tile(6, 3)
+        %t73 = aie.tile(7, 3)
+        %t83 = aie.tile(8, 3)
+        %t04 = aie.tile(0, 4)
+        %t14 = aie.tile(1, 4)
+        %t24 = aie.tile(2, 4)
+        %t34 = aie.tile(3, 4)
+        %t44 = aie.tile(4, 4)
+        %t54 = aie.tile(5, 4)
+        %t64 = aie.tile(6, 4)
+        %t74 = aie.tile(7, 4)
+        %t84 = aie.tile(8, 4)
+        %t20 = aie.tile(2, 0)
+        %t60 = aie.tile(6, 0)
+
+        %buf01 = aie.buffer(%t01) : memref<16xi32>
+        %mem01 = aie.mem(%t01) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf01 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd1
+        ^bd1:
+          aie.dma_bd(%buf01 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf11 = aie.buffer(%t11) : memref<16xi32>
+        %mem11 = aie.mem(%t11) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf11 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf21 = aie.buffer(%t21) : memref<16xi32>
+        %mem21 = aie.mem(%t21) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf21 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf31 = aie.buffer(%t31) : memref<16xi32>
+        %mem31 = aie.mem(%t31) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf31 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf41 = aie.buffer(%t41) : memref<16xi32>
+        %mem41 = aie.mem(%t41) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf41 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf02 = aie.buffer(%t02) : memref<16xi32>
+        %mem02 = aie.mem(%t02) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf02 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf12 = aie.buffer(%t12) : memref<16xi32>
+        %mem12 = aie.mem(%t12) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf12 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf22 = aie.buffer(%t22) : memref<16xi32>
+        %mem22 = aie.mem(%t22) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf22 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf32 = aie.buffer(%t32) : memref<16xi32>
+        %mem32 = aie.mem(%t32) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf32 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf42 = aie.buffer(%t42) : memref<16xi32>
+        %mem42 = aie.mem(%t42) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf42 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf03 = aie.buffer(%t03) : memref<16xi32>
+        %mem03 = aie.mem(%t03) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf03 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf13 = aie.buffer(%t13) : memref<16xi32>
+        %mem13 = aie.mem(%t13) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf13 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf23 = aie.buffer(%t23) : memref<16xi32>
+        %mem23 = aie.mem(%t23) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf23 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf33 = aie.buffer(%t33) : memref<16xi32>
+        %mem33 = aie.mem(%t33) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf33 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+        %buf43 = aie.buffer(%t43) : memref<16xi32>
+        %mem43 = aie.mem(%t43) {
+          %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+        ^bd0:
+          aie.dma_bd(%buf43 : memref<16xi32>, 0, 16)
+          aie.next_bd ^bd0
+        ^end:
+          aie.end
+        }
+
+        aie.flow(%t01, DMA : 0, %t51, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t11, DMA : 0, %t61, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t21, DMA : 0, %t71, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t31, DMA : 0, %t81, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t41, DMA : 0, %t81, DMA : 1) {bandwidth = 2 : i32}
+
+        aie.flow(%t02, DMA : 0, %t52, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t12, DMA : 0, %t62, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t22, DMA : 0, %t72, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t32, DMA : 0, %t82, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t42, DMA : 0, %t82, DMA : 1) {bandwidth = 2 : i32}
+
+        aie.flow(%t03, DMA : 0, %t53, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t13, DMA : 0, %t63, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t23, DMA : 0, %t73, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t33, DMA : 0, %t83, DMA : 0) {bandwidth = 2 : i32}
+        aie.flow(%t43, DMA : 0, %t83, DMA : 1) {bandwidth = 2 : i32}
+
+        // expected-remark@+1 {{was congested but could not become a packet flow: only DMA channels with BDs can send a packet header}}
+        aie.flow(%t04, Core : 0, %t54, DMA : 0) {bandwidth = 2 : i32}
+        // expected-remark@+1 {{was congested but could not become a packet flow: only DMA channels with BDs can send a packet header}}
+        aie.flow(%t14, Core : 0, %t64, DMA : 0) {bandwidth = 2 : i32}
+        // expected-remark@+1 {{was congested but could not become a packet flow: only DMA channels with BDs can send a packet header}}
+        aie.flow(%t24, Core : 0, %t74, DMA : 0) {bandwidth = 2 : i32}
+        // expected-remark@+1 {{was congested but could not become a packet flow: only DMA channels with BDs can send a packet header}}
+        aie.flow(%t34, Core : 0, %t84, DMA : 0) {bandwidth = 2 : i32}
+        // expected-remark@+1 {{was congested but could not become a packet flow: only DMA channels with BDs can send a packet header}}
+        aie.flow(%t44, Core : 0, %t84, DMA : 1) {bandwidth = 2 : i32}
+
+        aie.flow(%t20, DMA : 0, %t60, DMA : 0)
+
+        aie.packet_flow(0x0) {
+          aie.packet_source<%t01, Core : 0>
+          aie.packet_dest<%t11, Core : 0>
+        }
+    }
+} 
@@ -0,0 +1,23 @@
+//===- packet_fallback_id.mlir ---------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: not aie-opt --aie-create-pathfinder-flows="packet-fallback=true" %s 2>&1 | FileCheck %s
+// CHECK: error: 'aie.packet_flow' op packet ID 32 does not fit in 5 bits
+
+module {
+  aie.device(xcvc1902) {
+    %t11 = aie.tile(1, 1)
+    %t21 = aie.tile(2, 1)
+    aie.packet_flow(0x20) {
+      aie.packet_source<%t11, DMA : 0>
+      aie.packet_dest<%t21, DMA : 0>
+    }
+  }
+}
@@ -0,0 +1,29 @@
+//===- routing_benchmark.mlir ----------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// Smoke test of the routing benchmark report; the designs are synthesized by
+// the script, so this file has no input of its own.
+
+// RUN: %PYTHON %AIE_SRC_ROOT/utils/routing-benchmark.py --passes pathfinder --devices ipu --flows 8 -o %t.json
+// RUN: FileCheck %s < %t.json
+// RUN: %PYTHON %AIE_SRC_ROOT/utils/routing-benchmark.py --passes pathfinder --devices ipu --flows 8 --baseline %t.json --tolerance 1000 --min-time 1000 -o %t2.json
+
+// CHECK:      "pass": "aie-create-pathfinder-flows",
+// CHECK-NEXT: "device": "ipu",
+// CHECK-NEXT: "pattern": "random",
+// CHECK-NEXT: "requested_flows": 8,
+// CHECK-NEXT: "flows": 8,
+// CHECK-NEXT: "iterations": {{[1-9][0-9]*}},
+// CHECK-NEXT: "dijkstra_calls": {{[1-9][0-9]*}},
+// CHECK-NEXT: "status": "ok",
+// CHECK:      "pattern": "broadcast",
+// CHECK:      "status": "ok",
+// CHECK:      "pattern": "shim",
+// CHECK:      "status": "ok",
@@ -0,0 +1,51 @@
+//===- routing_cache.mlir --------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// The first run routes and fills the cache, the second one reads the solution
+// back; both must match an uncached run.
+// RUN: rm -rf %t.cache
+// RUN: aie-opt --aie-create-pathfinder-flows="routing-cache-dir=%t.cache" %s > %t.routed.mlir
+// RUN: ls %t.cache | FileCheck %s --check-prefix=CACHE
+// RUN: aie-opt --aie-create-pathfinder-flows="routing-cache-dir=%t.cache" %s > %t.cached.mlir
+// RUN: diff %t.routed.mlir %t.cached.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows %s | diff %t.routed.mlir -
+// RUN: aie-opt --aie-find-flows %t.cached.mlir | FileCheck %s
+// Different router options must not reuse the cached solution.
+// RUN: aie-opt --aie-create-pathfinder-flows="routing-cache-dir=%t.cache fanout-aware=true" %s -o /dev/null
+// RUN: ls %t.cache | FileCheck %s --check-prefix=CACHE2
+
+// CACHE: {{^[0-9a-f]+}}.json
+// CACHE-NOT: .json
+
+// CACHE2-COUNT-2: {{^[0-9a-f]+}}.json
+// CACHE2-NOT: .json
+
+// CHECK: %[[T20:.*]] = aie.tile(2, 0)
+// CHECK: %[[T21:.*]] = aie.tile(2, 1)
+// CHECK: %[[T33:.*]] = aie.tile(3, 3)
+// CHECK: %[[T72:.*]] = aie.tile(7, 2)
+// CHECK-DAG: aie.flow(%[[T20]], DMA : 0, %[[T33]], DMA : 0)
+// CHECK-DAG: aie.flow(%[[T20]], DMA : 0, %[[T72]], DMA : 1)
+// CHECK-DAG: aie.flow(%[[T33]], Core : 0, %[[T21]], Core : 0)
+// CHECK-DAG: aie.flow(%[[T72]], DMA : 0, %[[T20]], DMA : 0)
+
+module {
+    aie.device(xcvc1902) {
+        %t20 = aie.tile(2, 0)
+        %t21 = aie.tile(2, 1)
+        %t33 = aie.tile(3, 3)
+        %t72 = aie.tile(7, 2)
+
+        aie.flow(%t20, DMA : 0, %t33, DMA : 0)
+        aie.flow(%t20, DMA : 0, %t72, DMA : 1)
+        aie.flow(%t33, Core : 0, %t21, Core : 0)
+        aie.flow(%t72, DMA : 0, %t20, DMA : 0)
+    }
+}
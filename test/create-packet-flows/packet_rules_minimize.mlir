@@ -0,0 +1,86 @@
+//===- packet_rules_minimize.mlir ------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-create-packet-flows=pathfinder=true %s | FileCheck %s
+// RUN: aie-opt --aie-create-packet-flows="pathfinder=true reassign-ids=true" %s | FileCheck %s --check-prefix=REASSIGN
+
+// IDs 1 and 2 go to DMA : 0 of tile(4, 2), IDs 0 and 3 to DMA : 1. No rule
+// matches both 1 and 2 without 0 or 3, so each ID needs its own rule there.
+// Renaming IDs 0 and 1 lets a single rule match each pair.
+
+// CHECK:       %[[T22:.*]] = aie.tile(2, 2)
+// CHECK:       aie.switchbox(%[[T22]]) {
+// CHECK:         aie.packet_rules(DMA : 0) {
+// CHECK-NEXT:      aie.rule(28, 0, %{{.*}})
+// CHECK-NEXT:    }
+// CHECK:       %[[T42:.*]] = aie.tile(4, 2)
+// CHECK:       aie.switchbox(%[[T42]]) {
+// CHECK:         aie.packet_rules(West : 0) {
+// CHECK-DAG:       aie.rule(31, 0, %{{.*}})
+// CHECK-DAG:       aie.rule(31, 1, %{{.*}})
+// CHECK-DAG:       aie.rule(31, 2, %{{.*}})
+// CHECK-DAG:       aie.rule(31, 3, %{{.*}})
+// CHECK:         }
+// CHECK:       aie.dma_bd_packet(0, 1)
+
+// REASSIGN:       %[[T22:.*]] = aie.tile(2, 2)
+// REASSIGN:       aie.switchbox(%[[T22]]) {
+// REASSIGN:         aie.packet_rules(DMA : 0) {
+// REASSIGN-NEXT:      aie.rule(28, 0, %{{.*}})
+// REASSIGN-NEXT:    }
+// REASSIGN:       %[[T42:.*]] = aie.tile(4, 2)
+// REASSIGN:       aie.switchbox(%[[T42]]) {
+// REASSIGN:         aie.packet_rules(West : 0) {
+// REASSIGN-DAG:       aie.rule(29, 0, %{{.*}})
+// REASSIGN-DAG:       aie.rule(29, 1, %{{.*}})
+// REASSIGN:         }
+// REASSIGN:       aie.dma_bd_packet(0, 0)
+
+module @packet_rules_minimize {
+ aie.device(xcvc1902) {
+  %tile22 = aie.tile(2, 2)
+  %tile32 = aie.tile(3, 2)
+  %tile42 = aie.tile(4, 2)
+
+  %buf22 = aie.buffer(%tile22) : memref<256xi32>
+  %lock22 = aie.lock(%tile22, 0)
+  %mem22 = aie.mem(%tile22) {
+    %0 = aie.dma_start(MM2S, 0, ^bd0, ^end)
+  ^bd0:
+    aie.use_lock(%lock22, Acquire, 1)
+    aie.dma_bd_packet(0x0, 0x1)
+    aie.dma_bd(%buf22 : memref<256xi32>, 0, 256)
+    aie.use_lock(%lock22, Release, 0)
+    aie.next_bd ^end
+  ^end:
+    aie.end
+  }
+
+  aie.packet_flow(0x0) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 1>
+  }
+
+  aie.packet_flow(0x1) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 0>
+  }
+
+  aie.packet_flow(0x2) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 0>
+  }
+
+  aie.packet_flow(0x3) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 1>
+  }
+ }
+}
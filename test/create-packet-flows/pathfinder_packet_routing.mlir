@@ -0,0 +1,55 @@
+//===- pathfinder_packet_routing.mlir --------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-create-packet-flows=pathfinder=true %s | FileCheck %s
+
+// Both flows share channel 0 of the links to tile(4, 2), so tile(2, 2) and
+// tile(3, 2) need a single master port, arbiter and rule for them.
+
+// CHECK:       %[[T22:.*]] = aie.tile(2, 2)
+// CHECK:       aie.switchbox(%[[T22]]) {
+// CHECK:         %[[A22:.*]] = aie.amsel<0> (0)
+// CHECK:         aie.masterset(East : 0, %[[A22]])
+// CHECK-NEXT:    aie.packet_rules(DMA : 0) {
+// CHECK-NEXT:      aie.rule(28, 0, %[[A22]])
+// CHECK-NEXT:    }
+// CHECK-NEXT:  }
+// CHECK:       %[[T32:.*]] = aie.tile(3, 2)
+// CHECK:       aie.switchbox(%[[T32]]) {
+// CHECK:         %[[A32:.*]] = aie.amsel<0> (0)
+// CHECK:         aie.masterset(East : 0, %[[A32]])
+// CHECK-NEXT:    aie.packet_rules(West : 0) {
+// CHECK-NEXT:      aie.rule(28, 0, %[[A32]])
+// CHECK-NEXT:    }
+// CHECK-NEXT:  }
+// CHECK:       %[[T42:.*]] = aie.tile(4, 2)
+// CHECK:       aie.switchbox(%[[T42]]) {
+// CHECK-DAG:     aie.masterset(DMA : 0, %{{.*}})
+// CHECK-DAG:     aie.masterset(DMA : 1, %{{.*}})
+// CHECK-DAG:     aie.rule(31, 1, %{{.*}})
+// CHECK-DAG:     aie.rule(31, 2, %{{.*}})
+
+module @pathfinder_packet_routing {
+ aie.device(xcvc1902) {
+  %tile22 = aie.tile(2, 2)
+  %tile32 = aie.tile(3, 2)
+  %tile42 = aie.tile(4, 2)
+
+  aie.packet_flow(0x1) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 0>
+  }
+
+  aie.packet_flow(0x2) {
+    aie.packet_source<%tile22, DMA : 0>
+    aie.packet_dest<%tile42, DMA : 1>
+  }
+ }
+}
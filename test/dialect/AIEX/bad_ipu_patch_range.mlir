@@ -0,0 +1,23 @@
+//===- bad_ipu_patch_range.mlir --------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --verify-diagnostics %s
+
+module {
+  aie.device(ipu) {
+    func.func @sequence(%in : memref<64xi32>, %n : i64) {
+      aiex.ipu.shimtile_push_queue {metadata = @of_fromMem, issue_token = false, repeat_count = 0 : i32, bd_id = 0 : i32 }
+      // expected-error@+1 {{range [0:256] does not fit the mask.}}
+      aiex.ipu.patch {bias = -1 : i64, coefficients = array<i64: 1>, mask = 255 : ui32, max = 256 : i64, min = 0 : i64, shift = 16 : i32, terms = [array<i32: 1>], word = 2 : i32}
+      return
+    }
+    aie.shim_dma_allocation @of_fromMem (MM2S, 0, 0)
+  }
+}
@@ -0,0 +1,47 @@
+//===- bad_legalize.mlir ---------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-legalize-dma --split-input-file --verify-diagnostics %s
+
+aie.device(ipu) {
+  func.func @sequence(%a: memref<4096xi32>, %n: i64) {
+    // expected-error@+1 {{exceeds the limits of a shim BD and can only be split with static sizes and offsets.}}
+    aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][128, 1, 1, %n][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<4096xi32>
+    return
+  }
+  aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+}
+
+// -----
+
+// The token of the first output has not been waited for, so the second one
+// cannot wait for its own transfers to free task queue slots.
+aie.device(ipu) {
+  func.func @sequence(%a: memref<37748736xi32>) {
+    aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @out} : memref<37748736xi32>
+    // expected-error@+1 {{needs 18 transfers, but only 4 can be pushed to the channel without waiting and it has outstanding tokens to wait for.}}
+    aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 18, 4][0, 0, 2097152]) {id = 1 : i64, metadata = @out} : memref<37748736xi32>
+    return
+  }
+  aie.shim_dma_allocation @out (S2MM, 0, 0)
+}
+
+// -----
+
+// A dynamic size next to static sizes beyond the limits is rejected here,
+// before --aie-dma-to-ipu could emit a BD whose fields the host patches.
+aie.device(ipu) {
+  func.func @sequence(%a: memref<65536xi32>, %n: i64) {
+    // expected-error@+1 {{exceeds the limits of a shim BD and can only be split with static sizes and offsets.}}
+    aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 2048, %n][0, 0, 32]) {id = 0 : i64, metadata = @in0} : memref<65536xi32>
+    return
+  }
+  aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+}
@@ -0,0 +1,47 @@
+//===- bd_exhaustion.mlir --------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-legalize-dma="queue-depth=0" %s | FileCheck %s
+
+// Unrolling the rows takes 18 transfers but the shim tile only has 16 BDs:
+// with an unbounded task queue, the last two wait for the oldest ones and take
+// over their BDs.
+// CHECK-LABEL: func.func @sequence
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 2097152][1, 1, 1, 4][0, 0, 0]) {id = 1 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 4194304][1, 1, 1, 4][0, 0, 0]) {id = 2 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 6291456][1, 1, 1, 4][0, 0, 0]) {id = 3 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 8388608][1, 1, 1, 4][0, 0, 0]) {id = 4 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 10485760][1, 1, 1, 4][0, 0, 0]) {id = 5 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 12582912][1, 1, 1, 4][0, 0, 0]) {id = 6 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 14680064][1, 1, 1, 4][0, 0, 0]) {id = 7 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 16777216][1, 1, 1, 4][0, 0, 0]) {id = 8 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 18874368][1, 1, 1, 4][0, 0, 0]) {id = 9 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 20971520][1, 1, 1, 4][0, 0, 0]) {id = 10 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 23068672][1, 1, 1, 4][0, 0, 0]) {id = 11 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 25165824][1, 1, 1, 4][0, 0, 0]) {id = 12 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 27262976][1, 1, 1, 4][0, 0, 0]) {id = 13 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 29360128][1, 1, 1, 4][0, 0, 0]) {id = 14 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 31457280][1, 1, 1, 4][0, 0, 0]) {id = 15 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 33554432][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 35651584][1, 1, 1, 4][0, 0, 0]) {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+module {
+  aie.device(ipu) {
+    func.func @sequence(%a: memref<37748736xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 18, 4][0, 0, 2097152]) {id = 0 : i64, metadata = @in0} : memref<37748736xi32>
+      return
+    }
+    aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+  }
+}
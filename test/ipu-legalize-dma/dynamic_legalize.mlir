@@ -0,0 +1,33 @@
+//===- dynamic_legalize.mlir -----------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-legalize-dma %s | FileCheck %s
+// RUN: aie-opt --aie-ipu-legalize-dma --aie-dma-to-ipu %s | aie-translate --aie-ipu-patch-table | FileCheck %s --check-prefix=TABLE
+
+// A dynamic size can't be split, so a transfer within the limits for its
+// static sizes is left alone and the patch of its size carries the range of
+// the BD field, for the host to reject larger values rather than truncate
+// them.
+// CHECK-LABEL: func.func @dynamic
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 1, 4, %arg1][0, 0, 64]) {id = 0 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// TABLE:      "mask": 1023,
+// TABLE-NEXT: "max": 1023,
+// TABLE-NEXT: "min": 0,
+// TABLE-NEXT: "shift": 20,
+
+aie.device(ipu) {
+  func.func @dynamic(%a: memref<4096xi32>, %n: i64) {
+    aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 4, %n][0, 0, 64]) {id = 0 : i64, metadata = @in0} : memref<4096xi32>
+    return
+  }
+  aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+}
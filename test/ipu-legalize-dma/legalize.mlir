@@ -0,0 +1,87 @@
+//===- legalize.mlir -------------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-legalize-dma %s | FileCheck %s
+
+// Transfers that fit a BD are left alone.
+// CHECK-LABEL: func.func @legal
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 16][4, 2, 2, 8][0, 16, 8]) {id = 3 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// Contiguous dimensions are merged and the repetitions split into chunks of
+// 64, the second one on a free BD.
+// CHECK-LABEL: func.func @repeat
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][64, 1, 1, 32][0, 0, 0]) {id = 0 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][64, 1, 1, 32][0, 0, 0]) {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// A row longer than 1023 elements is factored into a free BD dimension.
+// CHECK-LABEL: func.func @factor
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 512, 4, 512][0, 4096, 512]) {id = 0 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// Iterations that move through memory become the outermost BD dimension,
+// whose wrap is not limited.
+// CHECK-LABEL: func.func @fold_iteration
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 100, 42, 1000][0, 4096, 1000]) {id = 0 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// A stride beyond 1M elements is unrolled. Only the last transfer issues the
+// token of the output.
+// CHECK-LABEL: func.func @unroll
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 1, 1, 2][0, 0, 0]) {id = 0 : i64, issue_token = false, metadata = @out}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 2097152][1, 1, 1, 2][0, 0, 0]) {id = 1 : i64, metadata = @out}
+// CHECK-NEXT: aiex.ipu.sync
+// CHECK-NEXT: return
+
+// Only four transfers are pushed to a channel without waiting: the fifth and
+// sixth wait for the oldest ones, even though free BDs are left.
+// CHECK-LABEL: func.func @queue_depth
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 0][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 2097152][1, 1, 1, 4][0, 0, 0]) {id = 1 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 4194304][1, 1, 1, 4][0, 0, 0]) {id = 2 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 6291456][1, 1, 1, 4][0, 0, 0]) {id = 3 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 8388608][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, issue_token = false, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}}%arg0[0, 0, 0, 10485760][1, 1, 1, 4][0, 0, 0]) {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+module {
+  aie.device(ipu) {
+    func.func @legal(%a: memref<128x4x2x8xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 16][4, 2, 2, 8][0, 16, 8]) {id = 3 : i64, metadata = @in0} : memref<128x4x2x8xi32>
+      return
+    }
+    func.func @repeat(%a: memref<128x4x2x8xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][128, 2, 2, 8][0, 16, 8]) {id = 0 : i64, metadata = @in0} : memref<128x4x2x8xi32>
+      return
+    }
+    func.func @factor(%a: memref<1024x4096xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 512, 2048][0, 0, 4096]) {id = 0 : i64, metadata = @in0} : memref<1024x4096xi32>
+      return
+    }
+    func.func @fold_iteration(%a: memref<16777216xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][100, 3, 2000, 7][4096, 0, 7]) {id = 0 : i64, metadata = @in0} : memref<16777216xi32>
+      return
+    }
+    func.func @unroll(%a: memref<8388608xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 2, 2][0, 0, 2097152]) {id = 0 : i64, metadata = @out} : memref<8388608xi32>
+      aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      return
+    }
+    func.func @queue_depth(%a: memref<12582912xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 6, 4][0, 0, 2097152]) {id = 0 : i64, metadata = @in0} : memref<12582912xi32>
+      return
+    }
+    aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+    aie.shim_dma_allocation @out (S2MM, 0, 0)
+  }
+}
@@ -0,0 +1,77 @@
+//===- peephole.mlir -------------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-peephole="report" %s 2>&1 | FileCheck %s
+
+// CHECK: remark: ipu instructions: 4 (48 bytes), was 6 (72 bytes)
+// CHECK: remark: ipu instructions: 7 (76 bytes), was 7 (76 bytes)
+// CHECK: remark: ipu instructions: 4 (32 bytes), was 7 (56 bytes)
+
+// Overwritten and repeated writes to the same register are removed.
+// CHECK-LABEL: func.func @dead_writes
+// CHECK-NEXT: aiex.ipu.write32 {address = 1540 : ui32, column = 0 : i32, row = 2 : i32, value = 7 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 1536 : ui32, column = 1 : i32, row = 2 : i32, value = 2 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 3 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 1540 : ui32, column = 0 : i32, row = 3 : i32, value = 7 : ui32}
+// CHECK-NEXT: return
+
+// Writes are not removed across a sync or a task queue write, and task queue
+// writes are never removed.
+// CHECK-LABEL: func.func @barriers
+// CHECK-NEXT: aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 1 : ui32}
+// CHECK-NEXT: aiex.ipu.sync
+// CHECK-NEXT: aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 1 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 119316 : ui32, column = 0 : i32, row = 0 : i32, value = 0 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 119316 : ui32, column = 0 : i32, row = 0 : i32, value = 0 : ui32}
+// CHECK-NEXT: aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 2 : ui32}
+// CHECK-NEXT: aiex.ipu.sync
+// CHECK-NEXT: return
+
+// Syncs over neighbouring columns or rows are merged, overlapping ones are not.
+// CHECK-LABEL: func.func @syncs
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 3 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.sync {channel = 1 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.sync {channel = 1 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 2 : i32, column_num = 1 : i32, direction = 1 : i32, row = 2 : i32, row_num = 2 : i32}
+// CHECK-NEXT: return
+
+module {
+  aie.device(ipu) {
+    func.func @dead_writes() {
+      aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 1 : ui32}
+      aiex.ipu.write32 {address = 1540 : ui32, column = 0 : i32, row = 2 : i32, value = 7 : ui32}
+      aiex.ipu.write32 {address = 1536 : ui32, column = 1 : i32, row = 2 : i32, value = 2 : ui32}
+      aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 3 : ui32}
+      aiex.ipu.write32 {address = 1540 : ui32, column = 0 : i32, row = 3 : i32, value = 7 : ui32}
+      aiex.ipu.write32 {address = 1540 : ui32, column = 0 : i32, row = 3 : i32, value = 7 : ui32}
+      return
+    }
+    func.func @barriers() {
+      aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 1 : ui32}
+      aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 1 : ui32}
+      aiex.ipu.write32 {address = 119316 : ui32, column = 0 : i32, row = 0 : i32, value = 0 : ui32}
+      aiex.ipu.write32 {address = 119316 : ui32, column = 0 : i32, row = 0 : i32, value = 0 : ui32}
+      aiex.ipu.write32 {address = 1536 : ui32, column = 0 : i32, row = 2 : i32, value = 2 : ui32}
+      aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      return
+    }
+    func.func @syncs() {
+      aiex.ipu.sync {channel = 0 : i32, column = 1 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 0 : i32, column = 2 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 1 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 1 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 0 : i32, column = 2 : i32, column_num = 1 : i32, direction = 1 : i32, row = 2 : i32, row_num = 1 : i32}
+      aiex.ipu.sync {channel = 0 : i32, column = 2 : i32, column_num = 1 : i32, direction = 1 : i32, row = 3 : i32, row_num = 1 : i32}
+      return
+    }
+  }
+}
@@ -0,0 +1,65 @@
+//===- bd_exhaustion.mlir --------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-schedule-dma="queue-depth=0" %s | FileCheck %s
+
+// BD 15 is programmed by hand and never handed out. Once the other 15 shim BDs
+// are in flight, each further transfer waits for the oldest one and reuses its
+// BD.
+// CHECK-LABEL: func.func @sequence
+// CHECK-NEXT: aiex.ipu.writebd_shimtile
+// CHECK-SAME: bd_id = 15 : i32
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 2 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 3 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 4 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 5 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 6 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 7 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 8 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 9 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 10 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 11 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 12 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 13 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 14 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+module {
+  aie.device(ipu) {
+    func.func @sequence(%a: memref<64xi32>) {
+      aiex.ipu.writebd_shimtile {bd_id = 15 : i32, buffer_length = 0 : i32, buffer_offset = 0 : i32, column = 0 : i32, column_num = 1 : i32, d0_size = 0 : i32, d0_stride = 0 : i32, d1_size = 0 : i32, d1_stride = 0 : i32, d2_stride = 0 : i32, ddr_id = 0 : i32, enable_packet = 0 : i32, iteration_current = 0 : i32, iteration_size = 0 : i32, iteration_stride = 0 : i32, lock_acq_enable = 0 : i32, lock_acq_id = 0 : i32, lock_acq_val = 0 : i32, lock_rel_id = 0 : i32, lock_rel_val = 0 : i32, next_bd = 0 : i32, out_of_order_id = 0 : i32, packet_id = 0 : i32, packet_type = 0 : i32, use_next_bd = 0 : i32, valid_bd = 1 : i32}
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 4][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 8][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 12][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 16][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 20][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 24][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 28][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 32][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 36][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 40][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 44][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 48][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 52][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 56][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 60][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 4][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      return
+    }
+    aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+  }
+}
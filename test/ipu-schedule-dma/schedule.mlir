@@ -0,0 +1,85 @@
+//===- schedule.mlir -------------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-ipu-schedule-dma %s | FileCheck %s
+
+// Independent transfers get their own BDs and only the outputs are waited for
+// at the end.
+// CHECK-LABEL: func.func @overlap
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, metadata = @in1}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 2 : i64, metadata = @out}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 3 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 4 : i64, metadata = @in1}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 5 : i64, metadata = @out}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: return
+
+// Reading back an output on another channel waits for it first.
+// CHECK-LABEL: func.func @read_after_write
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, metadata = @out}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// An existing sync already retires the output.
+// CHECK-LABEL: func.func @existing_sync
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, metadata = @out}
+// CHECK-NEXT: aiex.ipu.sync
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+// A full task queue waits for the oldest transfer, which is made to issue a
+// token.
+// CHECK-LABEL: func.func @queue_depth
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 0 : i64, issue_token = true, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 1 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 2 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 3 : i64, metadata = @in0}
+// CHECK-NEXT: aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 1 : i32, row = 0 : i32, row_num = 1 : i32}
+// CHECK-NEXT: aiex.ipu.dma_memcpy_nd{{.*}} {id = 4 : i64, metadata = @in0}
+// CHECK-NEXT: return
+
+module {
+  aie.device(ipu) {
+    func.func @overlap(%a: memref<64xi32>, %b: memref<64xi32>, %c: memref<64xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %b[0, 0, 0, 0][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @in1} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 0][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @out} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 32][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %b[0, 0, 0, 32][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @in1} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 32][1, 1, 1, 32][0, 0, 0]) {id = 0 : i64, metadata = @out} : memref<64xi32>
+      return
+    }
+    func.func @read_after_write(%c: memref<64xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 0][1, 1, 1, 64][0, 0, 0]) {id = 0 : i64, metadata = @out} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 0][1, 1, 1, 64][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      return
+    }
+    func.func @existing_sync(%c: memref<64xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 0][1, 1, 1, 64][0, 0, 0]) {id = 0 : i64, metadata = @out} : memref<64xi32>
+      aiex.ipu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.ipu.dma_memcpy_nd(0, 0, %c[0, 0, 0, 0][1, 1, 1, 64][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      return
+    }
+    func.func @queue_depth(%a: memref<64xi32>) {
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 16][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 16][1, 1, 1, 16][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 32][1, 1, 1, 16][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 48][1, 1, 1, 16][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      aiex.ipu.dma_memcpy_nd(0, 0, %a[0, 0, 0, 0][1, 1, 1, 64][0, 0, 0]) {id = 0 : i64, metadata = @in0} : memref<64xi32>
+      return
+    }
+    aie.shim_dma_allocation @in0 (MM2S, 0, 0)
+    aie.shim_dma_allocation @in1 (MM2S, 1, 0)
+    aie.shim_dma_allocation @out (S2MM, 0, 0)
+  }
+}
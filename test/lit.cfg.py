@@ -221,6 +221,8 @@ tools = [
     "opt",
     "xchesscc_wrapper",
 ]
+if config.has_cdo_direct_generation:
+    tools.append("aie2xclbin")
 
 llvm_config.add_tool_substitutions(tools, tool_dirs)
 
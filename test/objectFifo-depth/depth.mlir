@@ -0,0 +1,84 @@
+//===- depth.mlir ----------------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --verify-diagnostics --aie-objectFifo-depth %s
+// RUN: aie-opt --aie-objectFifo-depth=rewrite=true %s 2>/dev/null | FileCheck %s
+// RUN: aie-opt --aie-objectFifo-depth -mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+
+// @of0 is shared by adjacent tiles and ping-pongs: a depth of 2 is enough.
+// @of1 goes through DMAs between cores. The stateful transform sizes the pool
+// of each core from its acquires, so its depth changes nothing. @of2 starts in
+// a memtile, whose pool is sized by the depth: a ping-pong pair is enough.
+
+// CHECK: aie.objectfifo @of0(%{{.*}}, {%{{.*}}}, 2 : i32)
+// CHECK: aie.objectfifo @of1(%{{.*}}, {%{{.*}}}, 2 : i32)
+// CHECK: aie.objectfifo @of2(%{{.*}}, {%{{.*}}}, 2 : i32)
+
+// STATS-DAG: (S) 3 objectfifos-resized
+// STATS-DAG: (S) 192 bytes-saved
+
+module @depth {
+ aie.device(xcve2302) {
+    // expected-remark @below {{objectFifo depths save 64 bytes}}
+    %tile21 = aie.tile(2, 1)
+    // expected-remark @below {{objectFifo depths save 128 bytes}}
+    %tile12 = aie.tile(1, 2)
+    %tile13 = aie.tile(1, 3)
+    %tile33 = aie.tile(3, 3)
+
+    // expected-remark @below {{depth 4, 2 for full overlap (producer holds 1, consumers hold 1), 8 objects per run, saves 128 bytes}}
+    aie.objectfifo @of0 (%tile12, {%tile13}, 4 : i32) : !aie.objectfifo<memref<16xi32>>
+    // expected-warning @below {{producer releases 8 objects per run, but the consumer in tile(3, 3) releases 4}}
+    // expected-remark @below {{depth 4, 2 for full overlap (producer holds 2, consumers hold 1), 8 objects per run, saves 0 bytes}}
+    aie.objectfifo @of1 (%tile12, {%tile33}, 4 : i32) : !aie.objectfifo<memref<16xi32>>
+    // expected-remark @below {{depth 3, 2 for full overlap (producer holds 1, consumers hold 1), saves 64 bytes}}
+    aie.objectfifo @of2 (%tile21, {%tile33}, 3 : i32) : !aie.objectfifo<memref<16xi32>>
+
+    %core12 = aie.core(%tile12) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c4 = arith.constant 4 : index
+      %c8 = arith.constant 8 : index
+      scf.for %i = %c0 to %c8 step %c1 {
+        %subview = aie.objectfifo.acquire @of0 (Produce, 1) : !aie.objectfifosubview<memref<16xi32>>
+        aie.objectfifo.release @of0 (Produce, 1)
+      }
+      scf.for %i = %c0 to %c4 step %c1 {
+        %subview = aie.objectfifo.acquire @of1 (Produce, 2) : !aie.objectfifosubview<memref<16xi32>>
+        aie.objectfifo.release @of1 (Produce, 2)
+      }
+      aie.end
+    }
+
+    %core13 = aie.core(%tile13) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c8 = arith.constant 8 : index
+      scf.for %i = %c0 to %c8 step %c1 {
+        %subview = aie.objectfifo.acquire @of0 (Consume, 1) : !aie.objectfifosubview<memref<16xi32>>
+        aie.objectfifo.release @of0 (Consume, 1)
+      }
+      aie.end
+    }
+
+    %core33 = aie.core(%tile33) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c4 = arith.constant 4 : index
+      scf.for %i = %c0 to %c4 step %c1 {
+        %subview = aie.objectfifo.acquire @of1 (Consume, 1) : !aie.objectfifosubview<memref<16xi32>>
+        aie.objectfifo.release @of1 (Consume, 1)
+        %subview2 = aie.objectfifo.acquire @of2 (Consume, 1) : !aie.objectfifosubview<memref<16xi32>>
+        aie.objectfifo.release @of2 (Consume, 1)
+      }
+      aie.end
+    }
+ }
+}
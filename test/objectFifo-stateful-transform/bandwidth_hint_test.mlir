@@ -0,0 +1,28 @@
+//===- bandwidth_hint_test.mlir --------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-objectFifo-stateful-transform %s | FileCheck %s
+
+// CHECK: %[[T12:.*]] = aie.tile(1, 2)
+// CHECK: %[[T33:.*]] = aie.tile(3, 3)
+// CHECK: %[[T32:.*]] = aie.tile(3, 2)
+// CHECK-DAG: aie.flow(%[[T12]], DMA : 0, %[[T33]], DMA : 0) {bandwidth = 4 : i32}
+// CHECK-DAG: aie.flow(%[[T12]], DMA : 1, %[[T32]], DMA : 0){{$}}
+
+module @bandwidthHint {
+ aie.device(xcve2302) {
+    %tile12 = aie.tile(1, 2)
+    %tile33 = aie.tile(3, 3)
+    %tile32 = aie.tile(3, 2)
+
+    aie.objectfifo @hot (%tile12, {%tile33}, 2 : i32) {bandwidth = 4 : i32} : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @cold (%tile12, {%tile32}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+ }
+}
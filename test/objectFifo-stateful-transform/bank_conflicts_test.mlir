@@ -0,0 +1,55 @@
+//===- bank_conflicts_test.mlir --------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2023 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-objectFifo-stateful-transform=bank-conflicts=true %s | FileCheck %s
+
+// The elements of a FIFO conflict with each other. The elements that a core
+// reads also conflict with those of the other FIFOs the core reads from the
+// same tile: core (1, 3) reads of2 and of3, and core (3, 3) reads of1 and of4.
+// Buffers that only a DMA reads, such as of4 in tile (1, 3), conflict with
+// nothing else.
+
+// CHECK: %[[TILE12:.*]] = aie.tile(1, 2)
+// CHECK: %[[TILE13:.*]] = aie.tile(1, 3)
+// CHECK: %[[TILE32:.*]] = aie.tile(3, 2)
+// CHECK: %[[TILE33:.*]] = aie.tile(3, 3)
+// CHECK: aie.buffer(%[[TILE33]]) {bank_conflicts = [@of1_cons_buff_0, @of1_cons_buff_1], sym_name = "of4_cons_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE33]]) {bank_conflicts = [@of4_cons_buff_0, @of1_cons_buff_0, @of1_cons_buff_1], sym_name = "of4_cons_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {sym_name = "of4_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {bank_conflicts = [@of4_buff_0], sym_name = "of4_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {bank_conflicts = [@of2_cons_buff_0, @of2_cons_buff_1], sym_name = "of3_cons_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {bank_conflicts = [@of3_cons_buff_0, @of2_cons_buff_0, @of2_cons_buff_1], sym_name = "of3_cons_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE32]]) {sym_name = "of3_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE32]]) {bank_conflicts = [@of3_buff_0], sym_name = "of3_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {sym_name = "of2_cons_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE13]]) {bank_conflicts = [@of2_cons_buff_0], sym_name = "of2_cons_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE33]]) {sym_name = "of2_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE33]]) {bank_conflicts = [@of2_buff_0], sym_name = "of2_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE33]]) {sym_name = "of1_cons_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE33]]) {bank_conflicts = [@of1_cons_buff_0], sym_name = "of1_cons_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE12]]) {sym_name = "of1_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE12]]) {bank_conflicts = [@of1_buff_0], sym_name = "of1_buff_1"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE12]]) {sym_name = "of0_buff_0"} : memref<16xi32>
+// CHECK: aie.buffer(%[[TILE12]]) {bank_conflicts = [@of0_buff_0], sym_name = "of0_buff_1"} : memref<16xi32>
+
+module @bankConflicts {
+ aie.device(xcve2302) {
+    %tile12 = aie.tile(1, 2)
+    %tile13 = aie.tile(1, 3)
+    %tile32 = aie.tile(3, 2)
+    %tile33 = aie.tile(3, 3)
+
+    aie.objectfifo @of0 (%tile12, {%tile13}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @of1 (%tile12, {%tile33}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @of2 (%tile33, {%tile13}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @of3 (%tile32, {%tile13}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @of4 (%tile13, {%tile33}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+ }
+}
@@ -0,0 +1,64 @@
+# Copyright (C) 2023, Advanced Micro Devices, Inc.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+# RUN: %PYTHON %s | FileCheck %s
+
+# Cores whose bodies only differ in their buffers canonicalize to the same
+# module, and are bound back to their buffers at link time.
+
+# CHECK: core (1, 3): {'__aie_core': 'core_1_3', '__aie_core_buf0': 'in13', '__aie_core_buf1': 'out13'}
+# CHECK: core (2, 3): {'__aie_core': 'core_2_3', '__aie_core_buf0': 'in23', '__aie_core_buf1': 'out23'}
+# CHECK: core (3, 3): {'__aie_core': 'core_3_3', '__aie_core_buf0': 'in33', '__aie_core_buf1': 'out33'}
+# CHECK: (1, 3) and (2, 3) identical: True
+# CHECK: (1, 3) and (3, 3) identical: False
+
+import aie.compiler.aiecc.main as aiecc
+
+module = """
+module {
+  aie.device(xcvc1902) {
+    %13 = aie.tile(1, 3)
+    %23 = aie.tile(2, 3)
+    %33 = aie.tile(3, 3)
+    %in13 = aie.buffer(%13) {sym_name = "in13"} : memref<16xi32>
+    %out13 = aie.buffer(%13) {sym_name = "out13"} : memref<16xi32>
+    %in23 = aie.buffer(%23) {sym_name = "in23"} : memref<16xi32>
+    %out23 = aie.buffer(%23) {sym_name = "out23"} : memref<16xi32>
+    %in33 = aie.buffer(%33) {sym_name = "in33"} : memref<16xi32>
+    %out33 = aie.buffer(%33) {sym_name = "out33"} : memref<16xi32>
+    %c13 = aie.core(%13) {
+      %c0 = arith.constant 0 : index
+      %0 = memref.load %in13[%c0] : memref<16xi32>
+      memref.store %0, %out13[%c0] : memref<16xi32>
+      aie.end
+    }
+    %c23 = aie.core(%23) {
+      %c0 = arith.constant 0 : index
+      %0 = memref.load %in23[%c0] : memref<16xi32>
+      memref.store %0, %out23[%c0] : memref<16xi32>
+      aie.end
+    }
+    %c33 = aie.core(%33) {
+      %c1 = arith.constant 1 : index
+      %0 = memref.load %in33[%c1] : memref<16xi32>
+      memref.store %0, %out33[%c1] : memref<16xi32>
+      aie.end
+    }
+  }
+}
+"""
+
+canonical = {}
+for core in [(1, 3, None), (2, 3, None), (3, 3, None)]:
+    lowered = aiecc.run_passes(
+        "builtin.module(aie.device(aie-localize-locks,aie-normalize-address-spaces),"
+        "aie-standard-lowering{tilecol=%d tilerow=%d},aiex-standard-lowering)"
+        % core[0:2],
+        module,
+    )
+    lowered = aiecc.run_passes(str(aiecc.LOWER_TO_LLVM_PIPELINE), lowered)
+    canonical[core[0:2]], symbols = aiecc.canonicalize_core(lowered, core)
+    print(f"core {core[0:2]}: {symbols}")
+
+print("(1, 3) and (2, 3) identical:", canonical[(1, 3)] == canonical[(2, 3)])
+print("(1, 3) and (3, 3) identical:", canonical[(1, 3)] == canonical[(3, 3)])
@@ -24,16 +24,23 @@
 #include "mlir/Conversion/SCFToControlFlow/SCFToControlFlow.h"
 #include "mlir/Conversion/VectorToLLVM/ConvertVectorToLLVMPass.h"
 #include "mlir/Dialect/MemRef/Transforms/Passes.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/FileUtilities.h"
 #include "mlir/Target/LLVMIR/Export.h"
 #include "mlir/Transforms/Passes.h"
+#include "mlir/Transforms/RegionUtils.h"
 
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 
 #include <regex>
@@ -96,17 +103,19 @@ void xilinx::findVitis(XCLBinGenConfig &TK) {
   }
 }
 
-static void addAIELoweringPasses(OpPassManager &pm) {
+static void addAIELoweringPasses(OpPassManager &pm,
+                                 const XCLBinGenConfig &TK) {
   pm.addPass(createLowerAffinePass());
   pm.addPass(AIE::createAIECanonicalizeDevicePass());
   OpPassManager &devicePM = pm.nest<AIE::DeviceOp>();
   devicePM.addPass(AIE::createAIEAssignLockIDsPass());
   devicePM.addPass(AIE::createAIEObjectFifoRegisterProcessPass());
-  devicePM.addPass(AIE::createAIEObjectFifoStatefulTransformPass());
+  bool bankAware = TK.AllocScheme == "bank-aware";
+  devicePM.addPass(AIE::createAIEObjectFifoStatefulTransformPass(bankAware));
   devicePM.addPass(AIEX::createAIEBroadcastPacketPass());
   devicePM.addPass(AIE::createAIERoutePacketFlowsPass());
   devicePM.addPass(AIEX::createAIELowerMulticastPass());
-  devicePM.addPass(AIE::createAIEAssignBufferAddressesPass());
+  devicePM.addPass(AIE::createAIEAssignBufferAddressesPass(TK.AllocScheme));
   pm.addPass(createConvertSCFToCFPass());
 }
 
@@ -127,20 +136,32 @@ static void addLowerToLLVMPasses(OpPassManager &pm) {
   pm.addPass(createCSEPass());
 }
 
+// Lower the core of tile (col, row) to the llvm dialect. With col and row -1,
+// lower all the cores.
+static void addCoreToLLVMPasses(OpPassManager &pm, int col = -1,
+                                int row = -1) {
+  pm.addPass(AIE::createAIECoreToStandardPass(col, row));
+  pm.addPass(AIEX::createAIEXToStandardPass());
+  addLowerToLLVMPasses(pm);
+}
+
+// Run Program with Args. The trace printed with Verbose goes to Log, which
+// lets concurrent callers collect it and print it in a deterministic order.
 int runTool(StringRef Program, ArrayRef<std::string> Args, bool Verbose,
-            std::optional<ArrayRef<StringRef>> Env = std::nullopt) {
+            std::optional<ArrayRef<StringRef>> Env = std::nullopt,
+            raw_ostream &Log = llvm::outs()) {
   if (Verbose) {
-    llvm::outs() << "Run:";
+    Log << "Run:";
     if (Env) {
       for (auto &s : *Env) {
-        llvm::outs() << " " << s;
+        Log << " " << s;
       }
     }
-    llvm::outs() << " " << Program;
+    Log << " " << Program;
     for (auto &s : Args) {
-      llvm::outs() << " " << s;
+      Log << " " << s;
     }
-    llvm::outs() << "\n";
+    Log << "\n";
   }
   std::string err_msg;
   sys::ProcessStatistics stats;
@@ -150,11 +171,11 @@ int runTool(StringRef Program, ArrayRef<std::string> Args, bool Verbose,
   int result = sys::ExecuteAndWait(Program, PArgs, Env, {}, 0, 0, &err_msg,
                                    nullptr, &opt_stats);
   if (Verbose) {
-    llvm::outs() << (result == 0 ? "Succeeded " : "Failed ") << "in "
-                 << std::chrono::duration_cast<std::chrono::duration<float>>(
-                        stats.TotalTime)
-                        .count()
-                 << " code: " << result << "\n";
+    Log << (result == 0 ? "Succeeded " : "Failed ") << "in "
+        << std::chrono::duration_cast<std::chrono::duration<float>>(
+               stats.TotalTime)
+               .count()
+        << " code: " << result << "\n";
   }
   return result;
 }
@@ -169,8 +190,239 @@ static void aieTargetDefines(SmallVector<std::string, N> &Args,
   }
 }
 
-// Generate the elf files for the core
-static LogicalResult generateCoreElfFiles(ModuleOp moduleOp,
+namespace {
+// The linking of one core's elf file. Jobs run concurrently and keep their
+// output and errors to themselves, so they can be reported in tile order.
+struct CoreElfJob {
+  AIE::CoreOp coreOp;
+  int col;
+  int row;
+  std::string elfFileName;
+  std::string log;
+  std::string error;
+  // The object file of the core alone, empty when linking the object file
+  // shared by all cores.
+  std::string objFile;
+};
+} // namespace
+
+// A module holding only what the lowering of the core at (col, row) of
+// moduleOp reads: the core, the tiles, buffers and locks it uses and the
+// symbols it refers to, such as the functions it calls, in their original
+// order. Only reads moduleOp, so the cores can be extracted concurrently.
+static ModuleOp extractCore(ModuleOp moduleOp, int col, int row) {
+  AIE::DeviceOp deviceOp = *moduleOp.getOps<AIE::DeviceOp>().begin();
+  SmallPtrSet<Operation *, 16> needed;
+  SmallVector<Operation *> worklist;
+  auto require = [&](Operation *op) {
+    if (op && op->getParentOp() == deviceOp.getOperation() &&
+        needed.insert(op).second)
+      worklist.push_back(op);
+  };
+  for (auto coreOp : deviceOp.getOps<AIE::CoreOp>())
+    if (coreOp.colIndex() == col && coreOp.rowIndex() == row)
+      require(coreOp);
+  while (!worklist.empty()) {
+    Operation *op = worklist.pop_back_val();
+    for (Value operand : op->getOperands())
+      require(operand.getDefiningOp());
+    SetVector<Value> usedAbove;
+    getUsedValuesDefinedAbove(op->getRegions(), usedAbove);
+    for (Value value : usedAbove)
+      require(value.getDefiningOp());
+    op->walk([&](Operation *nested) {
+      for (NamedAttribute attr : nested->getAttrs())
+        attr.getValue().walk([&](SymbolRefAttr ref) {
+          require(SymbolTable::lookupNearestSymbolFrom(nested, ref));
+        });
+    });
+  }
+
+  ModuleOp extracted = ModuleOp::create(moduleOp.getLoc());
+  extracted->setAttrs(moduleOp->getAttrDictionary());
+  OpBuilder builder = OpBuilder::atBlockEnd(extracted.getBody());
+  IRMapping mapping;
+  for (Operation &op : *moduleOp.getBody()) {
+    if (&op != deviceOp.getOperation()) {
+      builder.clone(op, mapping);
+      continue;
+    }
+    Operation *device = builder.cloneWithoutRegions(op, mapping);
+    builder.createBlock(&device->getRegion(0));
+    for (Operation &deviceChild : *deviceOp.getBody())
+      if (needed.contains(&deviceChild))
+        builder.clone(deviceChild, mapping);
+    builder.setInsertionPointAfter(device);
+  }
+  return extracted;
+}
+
+// Lower the core of the job from a module of its own to an object file. Runs
+// concurrently with the other cores, so the dialects used by the lowering
+// must already be loaded.
+static void compileCoreObjectFile(MLIRContext *ctx, ModuleOp moduleOp,
+                                  const XCLBinGenConfig &TK, CoreElfJob &job) {
+  raw_string_ostream log(job.log);
+  std::string core =
+      "core(" + std::to_string(job.col) + "," + std::to_string(job.row) + ")";
+
+  // The other cores and what only they use would be converted along with the
+  // core for nothing, so each job only copies and lowers its own part.
+  ModuleOp copy = extractCore(moduleOp, job.col, job.row);
+  auto eraseCopy = llvm::make_scope_exit([&] { copy->erase(); });
+
+  PassManager pm(ctx, ModuleOp::getOperationName());
+  addCoreToLLVMPasses(pm, job.col, job.row);
+  if (failed(pm.run(copy))) {
+    job.error = "failed to lower " + core + " to LLVM";
+    return;
+  }
+
+  std::string errorMessage;
+  SmallString<64> LLVMIRFile(TK.TempDir);
+  sys::path::append(LLVMIRFile, job.elfFileName + ".ll");
+  {
+    auto output = openOutputFile(LLVMIRFile, &errorMessage);
+    if (!output) {
+      job.error = errorMessage;
+      return;
+    }
+    llvm::LLVMContext llvmContext;
+    auto llvmModule = translateModuleToLLVMIR(copy, llvmContext);
+    if (!llvmModule) {
+      job.error = "failed to translate " + core + " to LLVMIR";
+      return;
+    }
+    llvmModule->print(output->os(), nullptr);
+    output->keep();
+  }
+
+  SmallString<64> peanoOptBin(TK.PeanoDir);
+  sys::path::append(peanoOptBin, "bin", "opt");
+  SmallString<64> peanoLLCBin(TK.PeanoDir);
+  sys::path::append(peanoLLCBin, "bin", "llc");
+  SmallString<64> OptLLVMIRFile(TK.TempDir);
+  sys::path::append(OptLLVMIRFile, job.elfFileName + ".opt.ll");
+  SmallString<64> objFile(TK.TempDir);
+  sys::path::append(objFile, job.elfFileName + ".o");
+  if (runTool(peanoOptBin,
+              {"-O2", "--inline-threshold=10", "-S", std::string(LLVMIRFile),
+               "-o", std::string(OptLLVMIRFile)},
+              TK.Verbose, std::nullopt, log) != 0) {
+    job.error = "failed to optimize " + core;
+    return;
+  }
+  if (runTool(peanoLLCBin,
+              {std::string(OptLLVMIRFile), "-O2",
+               "--march=" + StringRef(TK.TargetArch).lower(),
+               "--function-sections", "--filetype=obj", "-o",
+               std::string(objFile)},
+              TK.Verbose, std::nullopt, log) != 0) {
+    job.error = "failed to assemble " + core;
+    return;
+  }
+  job.objFile = std::string(objFile);
+}
+
+// Lower each core from its own copy of moduleOp, in parallel on the thread
+// pool of the context. The passes shared by all the cores run once, before the
+// module is copied.
+static LogicalResult compileCoreObjectFiles(MLIRContext *ctx, ModuleOp moduleOp,
+                                            const XCLBinGenConfig &TK,
+                                            MutableArrayRef<CoreElfJob> jobs) {
+  ModuleOp prepared = moduleOp.clone();
+  auto erasePrepared = llvm::make_scope_exit([&] { prepared->erase(); });
+  {
+    PassManager pm(ctx, ModuleOp::getOperationName());
+    pm.addNestedPass<AIE::DeviceOp>(AIE::createAIELocalizeLocksPass());
+    pm.addNestedPass<AIE::DeviceOp>(AIE::createAIENormalizeAddressSpacesPass());
+    if (failed(pm.run(prepared)))
+      return moduleOp.emitOpError("Failed to prepare cores for lowering");
+  }
+
+  // Dialects cannot be loaded while running in parallel: load those of the
+  // core lowering up front.
+  {
+    PassManager pm(ctx, ModuleOp::getOperationName());
+    addCoreToLLVMPasses(pm);
+    DialectRegistry registry;
+    pm.getDependentDialects(registry);
+    ctx->appendDialectRegistry(registry);
+    for (StringRef name : registry.getDialectNames())
+      ctx->getOrLoadDialect(name);
+  }
+
+  if (TK.Verbose) {
+    PassManager pm(ctx, ModuleOp::getOperationName());
+    addCoreToLLVMPasses(pm, jobs.front().col, jobs.front().row);
+    llvm::outs() << "Running per core: ";
+    pm.printAsTextualPipeline(llvm::outs());
+    llvm::outs() << "\n";
+  }
+
+  parallelForEach(ctx, jobs, [&](CoreElfJob &job) {
+    compileCoreObjectFile(ctx, prepared, TK, job);
+  });
+  return success();
+}
+
+// Write the ld script of the core and link its elf file.
+static void linkCoreElfFile(ModuleOp moduleOp, const StringRef objFile,
+                            const XCLBinGenConfig &TK, CoreElfJob &job) {
+  raw_string_ostream log(job.log);
+  std::string errorMessage;
+  SmallString<64> ldscript_path(TK.TempDir);
+  sys::path::append(ldscript_path, job.elfFileName + ".ld");
+  {
+    auto ldscript_output = openOutputFile(ldscript_path, &errorMessage);
+    if (!ldscript_output) {
+      job.error = errorMessage;
+      return;
+    }
+
+    if (failed(AIE::AIETranslateToLdScript(moduleOp, ldscript_output->os(),
+                                           job.col, job.row))) {
+      job.error = "failed to generate ld script for core (" +
+                  std::to_string(job.col) + "," + std::to_string(job.row) +
+                  ")";
+      return;
+    }
+    ldscript_output->keep();
+  }
+
+  // We are running a clang command for now, but really this is an lld
+  // command.
+  SmallString<64> elfFile(TK.TempDir);
+  sys::path::append(elfFile, job.elfFileName);
+  std::string targetLower = StringRef(TK.TargetArch).lower();
+  SmallVector<std::string, 10> flags;
+  flags.push_back("-O2");
+  std::string targetFlag = "--target=" + targetLower + "-none-elf";
+  flags.push_back(targetFlag);
+  flags.emplace_back(job.objFile.empty() ? objFile : StringRef(job.objFile));
+  SmallString<64> meBasicPath(TK.InstallDir);
+  sys::path::append(meBasicPath, "aie_runtime_lib", TK.TargetArch,
+                    "me_basic.o");
+  flags.emplace_back(meBasicPath);
+  SmallString<64> libcPath(TK.PeanoDir);
+  sys::path::append(libcPath, "lib", targetLower + "-none-unknown-elf",
+                    "libc.a");
+  flags.emplace_back(libcPath);
+  flags.push_back("-Wl,--gc-sections");
+  std::string ldScriptFlag = "-Wl,-T," + std::string(ldscript_path);
+  flags.push_back(ldScriptFlag);
+  flags.push_back("-o");
+  flags.emplace_back(elfFile);
+  SmallString<64> clangBin(TK.PeanoDir);
+  sys::path::append(clangBin, "bin", "clang");
+  if (runTool(clangBin, flags, TK.Verbose, std::nullopt, log) != 0)
+    job.error = "failed to link elf file for core(" + std::to_string(job.col) +
+                "," + std::to_string(job.row) + ")";
+}
+
+// Generate the elf files for the core. Without objFile, each core is compiled
+// to an object file of its own first.
+static LogicalResult generateCoreElfFiles(MLIRContext *ctx, ModuleOp moduleOp,
                                           const StringRef objFile,
                                           XCLBinGenConfig &TK) {
   auto deviceOps = moduleOp.getOps<AIE::DeviceOp>();
@@ -181,8 +433,8 @@ static LogicalResult generateCoreElfFiles(ModuleOp moduleOp,
   AIE::DeviceOp deviceOp = *deviceOps.begin();
   auto tileOps = deviceOp.getOps<AIE::TileOp>();
 
-  std::string errorMessage;
-
+  // Name the elf files up front; the jobs below only read the module.
+  std::vector<CoreElfJob> jobs;
   for (auto tileOp : tileOps) {
     int col = tileOp.colIndex();
     int row = tileOp.rowIndex();
@@ -201,53 +453,39 @@ static LogicalResult generateCoreElfFiles(ModuleOp moduleOp,
       coreOp.setElfFile(elfFileName);
     }
 
-    SmallString<64> ldscript_path(TK.TempDir);
-    sys::path::append(ldscript_path, elfFileName + ".ld");
-    {
-      auto ldscript_output = openOutputFile(ldscript_path, &errorMessage);
-      if (!ldscript_output) {
-        return coreOp.emitOpError(errorMessage);
-      }
+    // Cores sharing an elf file would write it concurrently; as when linking
+    // one core at a time, the last of them provides it.
+    llvm::erase_if(jobs, [&](const CoreElfJob &job) {
+      return job.elfFileName == elfFileName;
+    });
+    jobs.push_back({coreOp, col, row, elfFileName, "", "", ""});
+  }
 
-      if (failed(AIE::AIETranslateToLdScript(moduleOp, ldscript_output->os(),
-                                             col, row))) {
-        return coreOp.emitOpError("failed to generate ld script for core (")
-               << col << "," << row << ")";
-      }
-      ldscript_output->keep();
+  if (objFile.empty() && !jobs.empty()) {
+    if (failed(compileCoreObjectFiles(ctx, moduleOp, TK, jobs)))
+      return failure();
+    for (CoreElfJob &job : jobs) {
+      if (job.error.empty())
+        continue;
+      llvm::outs() << job.log;
+      return job.coreOp.emitOpError(job.error);
     }
+  }
 
-    // We are running a clang command for now, but really this is an lld
-    // command.
-    SmallString<64> elfFile(TK.TempDir);
-    sys::path::append(elfFile, elfFileName);
-    {
-      std::string targetLower = StringRef(TK.TargetArch).lower();
-      SmallVector<std::string, 10> flags;
-      flags.push_back("-O2");
-      std::string targetFlag = "--target=" + targetLower + "-none-elf";
-      flags.push_back(targetFlag);
-      flags.emplace_back(objFile);
-      SmallString<64> meBasicPath(TK.InstallDir);
-      sys::path::append(meBasicPath, "aie_runtime_lib", TK.TargetArch,
-                        "me_basic.o");
-      flags.emplace_back(meBasicPath);
-      SmallString<64> libcPath(TK.PeanoDir);
-      sys::path::append(libcPath, "lib", targetLower + "-none-unknown-elf",
-                        "libc.a");
-      flags.emplace_back(libcPath);
-      flags.push_back("-Wl,--gc-sections");
-      std::string ldScriptFlag = "-Wl,-T," + std::string(ldscript_path);
-      flags.push_back(ldScriptFlag);
-      flags.push_back("-o");
-      flags.emplace_back(elfFile);
-      SmallString<64> clangBin(TK.PeanoDir);
-      sys::path::append(clangBin, "bin", "clang");
-      if (runTool(clangBin, flags, TK.Verbose) != 0) {
-        return coreOp.emitOpError("failed to link elf file for core(")
-               << col << "," << row << ")";
-      }
-    }
+  if (TK.Jobs == 1 || jobs.size() < 2) {
+    for (CoreElfJob &job : jobs)
+      linkCoreElfFile(moduleOp, objFile, TK, job);
+  } else {
+    ThreadPool pool(hardware_concurrency(TK.Jobs));
+    for (CoreElfJob &job : jobs)
+      pool.async([&] { linkCoreElfFile(moduleOp, objFile, TK, job); });
+    pool.wait();
+  }
+
+  for (CoreElfJob &job : jobs) {
+    llvm::outs() << job.log;
+    if (!job.error.empty())
+      return job.coreOp.emitOpError(job.error);
   }
   return success();
 }
@@ -259,7 +497,8 @@ static LogicalResult generateCDO(MLIRContext *context, ModuleOp moduleOp,
   // This corresponds to `process_host_cgen`, which is listed as host
   // compilation in aiecc.py... not sure we need this.
   PassManager passManager(context, ModuleOp::getOperationName());
-  passManager.addNestedPass<AIE::DeviceOp>(AIE::createAIEPathfinderPass());
+  passManager.addNestedPass<AIE::DeviceOp>(
+      AIE::createAIEPathfinderPass(TK.RoutingCacheDir));
   passManager.addNestedPass<AIE::DeviceOp>(
       AIEX::createAIEBroadcastPacketPass());
   passManager.addNestedPass<AIE::DeviceOp>(
@@ -498,7 +737,7 @@ LogicalResult xilinx::aie2xclbin(MLIRContext *ctx, ModuleOp moduleOp,
                                  XCLBinGenConfig &TK, StringRef OutputIPU,
                                  StringRef OutputXCLBin) {
   PassManager pm(ctx, moduleOp.getOperationName());
-  addAIELoweringPasses(pm);
+  addAIELoweringPasses(pm, TK);
 
   if (TK.Verbose) {
     llvm::outs() << "Running: ";
@@ -526,6 +765,7 @@ LogicalResult xilinx::aie2xclbin(MLIRContext *ctx, ModuleOp moduleOp,
   // generateIPUInstructions
   {
     PassManager pm(ctx, moduleOp.getOperationName());
+    pm.addNestedPass<AIE::DeviceOp>(AIEX::createAIEIpuLegalizeDmaPass());
     pm.addNestedPass<AIE::DeviceOp>(AIEX::createAIEDmaToIpuPass());
     ModuleOp copy = moduleOp.clone();
     if (failed(pm.run(copy))) {
@@ -553,15 +793,14 @@ LogicalResult xilinx::aie2xclbin(MLIRContext *ctx, ModuleOp moduleOp,
   sys::path::append(peanoLLCBin, "bin", "llc");
 
   // generateObjectFile
-  SmallString<64> unifiedObj(TK.TempDir);
-  sys::path::append(unifiedObj, "input.o");
-  {
+  SmallString<64> unifiedObj;
+  if (TK.Unified) {
+    unifiedObj = TK.TempDir;
+    sys::path::append(unifiedObj, "input.o");
     PassManager pm(ctx, moduleOp.getOperationName());
     pm.addNestedPass<AIE::DeviceOp>(AIE::createAIELocalizeLocksPass());
     pm.addNestedPass<AIE::DeviceOp>(AIE::createAIENormalizeAddressSpacesPass());
-    pm.addPass(AIE::createAIECoreToStandardPass());
-    pm.addPass(AIEX::createAIEXToStandardPass());
-    addLowerToLLVMPasses(pm);
+    addCoreToLLVMPasses(pm);
 
     if (TK.Verbose) {
       llvm::outs() << "Running: ";
@@ -610,7 +849,7 @@ LogicalResult xilinx::aie2xclbin(MLIRContext *ctx, ModuleOp moduleOp,
     copy->erase();
   }
 
-  if (failed(generateCoreElfFiles(moduleOp, unifiedObj, TK))) {
+  if (failed(generateCoreElfFiles(ctx, moduleOp, unifiedObj, TK))) {
     return moduleOp.emitOpError("Failed to generate core ELF file(s)");
   }
 
@@ -26,6 +26,16 @@ struct XCLBinGenConfig {
   std::string AIEToolsDir;
   std::string TempDir;
   bool Verbose;
+  // Number of cores to link concurrently, 0 for one per hardware thread.
+  unsigned Jobs = 0;
+  // Compile all cores into one object file. Otherwise each core is lowered
+  // from its own copy of the module, in parallel on the context thread pool.
+  bool Unified = true;
+  // Buffer allocation scheme: basic-sequential or bank-aware. The latter
+  // also has the objectFifo lowering annotate bank conflicts.
+  std::string AllocScheme = "basic-sequential";
+  // Directory for caching routing solutions across runs, empty to disable.
+  std::string RoutingCacheDir;
   std::string HostArch;
   std::string XCLBinKernelName;
   std::string XCLBinKernelID;
@@ -54,6 +54,24 @@ cl::opt<std::string>
     TmpDir("tmpdir", cl::desc("Directory used for temporary file storage"),
            cl::cat(AIE2XCLBinCat));
 cl::opt<bool> Verbose("v", cl::desc("Trace commands as they are executed"));
+cl::opt<unsigned>
+    Jobs("j",
+         cl::desc("Number of cores to link in parallel (0: one per thread)"),
+         cl::init(0), cl::cat(AIE2XCLBinCat));
+cl::opt<bool>
+    Unified("unified",
+            cl::desc("Compile all cores into a single object file (false: "
+                     "lower each core in-process, in parallel)"),
+            cl::init(true), cl::cat(AIE2XCLBinCat));
+cl::opt<std::string>
+    AllocScheme("alloc-scheme",
+                cl::desc("Buffer allocation scheme (basic-sequential or "
+                         "bank-aware)"),
+                cl::init("basic-sequential"), cl::cat(AIE2XCLBinCat));
+cl::opt<std::string> RoutingCacheDir(
+    "routing-cache-dir",
+    cl::desc("Directory for caching routing solutions across runs"),
+    cl::cat(AIE2XCLBinCat));
 cl::opt<std::string>
     Peano("peano", cl::desc("Root directory where peano compiler is installed"),
           cl::Required, cl::cat(AIE2XCLBinCat));
@@ -91,6 +109,10 @@ int main(int argc, char *argv[]) {
   cl::ParseCommandLineOptions(argc, argv);
   XCLBinGenConfig TK;
   TK.Verbose = Verbose;
+  TK.Jobs = Jobs;
+  TK.Unified = Unified;
+  TK.AllocScheme = AllocScheme;
+  TK.RoutingCacheDir = RoutingCacheDir;
   TK.HostArch = HostArch;
   TK.XCLBinKernelName = XCLBinKernelName;
   TK.XCLBinKernelID = XCLBinKernelID;
@@ -0,0 +1,419 @@
+#!/usr/bin/env python3
+"""Benchmark the scaling of the AIE routing passes.
+
+Synthesizes routing problems (random point-to-point, broadcast and shim
+traffic) for every device target model, runs each routing pass on them with
+aie-opt and reports wall time, peak memory and the pass statistics (for
+aie-create-pathfinder-flows: Pathfinder iterations and Dijkstra calls) as
+JSON.
+
+Example usage:
+$ routing-benchmark.py --aie-opt build/bin/aie-opt -o routing.json
+$ routing-benchmark.py --devices ipu --flows 8,32 --baseline routing.json
+
+With --baseline, the run is compared to an earlier report and the script
+exits with a non-zero status when a benchmark got slower than the tolerance
+allows, needed more iterations or Dijkstra calls, or stopped routing.
+"""
+
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# (c) Copyright 2023 Advanced Micro Devices, Inc.
+
+import argparse
+import json
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+# columns, rows, first core row and shim NOC columns of each target model
+DEVICES = {
+    "xcvc1902": (
+        50,
+        9,
+        1,
+        [2, 3, 6, 7, 10, 11, 18, 19, 26, 27, 34, 35, 42, 43, 46, 47],
+    ),
+    "xcve2302": (17, 4, 2, [2, 3, 6, 7, 10, 11]),
+    "xcve2802": (38, 11, 3, [2, 3, 6, 7, 14, 15, 22, 23, 30, 31, 34, 35]),
+    "ipu": (5, 6, 2, [0, 1, 2, 3]),
+}
+
+PASSES = {
+    "pathfinder": "aie-create-pathfinder-flows",
+    "packet": "aie-create-packet-flows",
+    "herd": "aie-herd-routing",
+}
+
+PATTERNS = {
+    "pathfinder": ["random", "broadcast", "shim"],
+    "packet": ["random"],
+    "herd": ["random"],
+}
+
+# DMA channels in each direction of a core tile and a shim NOC tile
+DMA_CHANNELS = 2
+BROADCAST_FANOUT = 4
+# packet ids are 5 bits wide
+MAX_PACKET_IDS = 32
+
+
+def tile(col, row):
+    return "%%tile_%d_%d" % (col, row)
+
+
+def core_tiles(device):
+    cols, rows, first_core_row, _ = DEVICES[device]
+    return [(c, r) for c in range(cols) for r in range(first_core_row, rows)]
+
+
+def shim_tiles(device):
+    return [(c, 0) for c in DEVICES[device][3]]
+
+
+def ports(tiles):
+    return [(t, ch) for t in tiles for ch in range(DMA_CHANNELS)]
+
+
+# Each generator returns a list of (source, [destinations]) connections, where
+# every end point is a (tile, DMA channel) pair. Destinations are never shared.
+def random_connections(device, count, rng):
+    srcs = ports(core_tiles(device))
+    dsts = ports(core_tiles(device))
+    rng.shuffle(srcs)
+    rng.shuffle(dsts)
+    connections = []
+    for src in srcs:
+        if len(connections) == count:
+            break
+        for i, dst in enumerate(dsts):
+            if dst[0] != src[0]:
+                connections.append((src, [dsts.pop(i)]))
+                break
+    return connections
+
+
+def broadcast_connections(device, count, rng):
+    srcs = ports(core_tiles(device))
+    dsts = ports(core_tiles(device))
+    rng.shuffle(srcs)
+    rng.shuffle(dsts)
+    connections = []
+    remaining = count
+    for src in srcs:
+        fanout = [d for d in dsts if d[0] != src[0]][
+            : min(BROADCAST_FANOUT, remaining)
+        ]
+        if not fanout:
+            break
+        for d in fanout:
+            dsts.remove(d)
+        connections.append((src, fanout))
+        remaining -= len(fanout)
+        if remaining == 0:
+            break
+    return connections
+
+
+# Traffic between every shim NOC tile and the core tiles: half of the flows
+# read from the shims, the other half write back to them.
+def shim_connections(device, count, rng):
+    shims = ports(shim_tiles(device))
+    cores = ports(core_tiles(device))
+    rng.shuffle(cores)
+    reads = {}
+    for i, dst in enumerate(cores[: (count + 1) // 2]):
+        reads.setdefault(shims[i % len(shims)], []).append(dst)
+    connections = list(reads.items())
+    for src, dst in zip(cores, shims[: count // 2]):
+        connections.append((src, [dst]))
+    return connections
+
+
+GENERATORS = {
+    "random": random_connections,
+    "broadcast": broadcast_connections,
+    "shim": shim_connections,
+}
+
+
+def tile_ops(device, connections):
+    tiles = set()
+    for src, dsts in connections:
+        tiles.add(src[0])
+        tiles.update(d[0] for d in dsts)
+    return [
+        "    %s = aie.tile(%d, %d)" % (tile(*t), t[0], t[1]) for t in sorted(tiles)
+    ]
+
+
+def circuit_design(device, connections):
+    body = tile_ops(device, connections)
+    for (s, sch), dsts in connections:
+        for d, dch in dsts:
+            body.append(
+                "    aie.flow(%s, DMA : %d, %s, DMA : %d)"
+                % (tile(*s), sch, tile(*d), dch)
+            )
+    return body
+
+
+def packet_design(device, connections):
+    body = tile_ops(device, connections)
+    for i, ((s, sch), dsts) in enumerate(connections[:MAX_PACKET_IDS]):
+        body.append("    aie.packet_flow(%d) {" % i)
+        body.append("      aie.packet_source<%s, DMA : %d>" % (tile(*s), sch))
+        for d, dch in dsts:
+            body.append("      aie.packet_dest<%s, DMA : %d>" % (tile(*d), dch))
+        body.append("    }")
+    return body
+
+
+# One pair of single tile herds per point-to-point connection, placed as far
+# apart as the tiles of the connection.
+def herd_design(device, connections):
+    body = ["    %it = aie.iter(0, 1, 1)"]
+    for i, ((s, sch), dsts) in enumerate(connections):
+        d, dch = dsts[0]
+        body += [
+            '    %%t%d = aie.herd[1][1] { sym_name = "t%d" }' % (i, i),
+            '    %%s%d = aie.herd[1][1] { sym_name = "s%d" }' % (i, i),
+            "    %%ts%d = aie.select(%%t%d, %%it, %%it)" % (i, i),
+            "    %%ss%d = aie.select(%%s%d, %%it, %%it)" % (i, i),
+            "    aie.place(%%t%d, %%s%d, %d, %d)"
+            % (i, i, abs(d[0] - s[0]), abs(d[1] - s[1])),
+            "    aie.route(<%%ts%d, DMA : %d>, <%%ss%d, DMA : %d>)" % (i, sch, i, dch),
+        ]
+    return body
+
+
+DESIGNS = {
+    "pathfinder": circuit_design,
+    "packet": packet_design,
+    "herd": herd_design,
+}
+
+
+def synthesize(router, device, pattern, count, seed):
+    rng = random.Random("%s-%s-%d-%d" % (device, pattern, count, seed))
+    connections = GENERATORS[pattern](device, count, rng)
+    if router == "packet":
+        connections = connections[:MAX_PACKET_IDS]
+    body = DESIGNS[router](device, connections)
+    flows = sum(len(dsts) for _, dsts in connections)
+    text = "module {\n  aie.device(%s) {\n%s\n  }\n}\n" % (device, "\n".join(body))
+    return text, flows
+
+
+STATISTIC = re.compile(r"\(S\)\s+(\d+)\s+([\w-]+)\s+-")
+
+
+def run_pass(aie_opt, pass_arg, design):
+    with tempfile.TemporaryDirectory() as tmp:
+        input_path = os.path.join(tmp, "design.mlir")
+        stderr_path = os.path.join(tmp, "stderr.txt")
+        with open(input_path, "w") as f:
+            f.write(design)
+        with open(stderr_path, "w") as err:
+            start = time.perf_counter()
+            proc = subprocess.Popen(
+                [
+                    aie_opt,
+                    "--" + pass_arg,
+                    "--mlir-pass-statistics",
+                    "--mlir-pass-statistics-display=list",
+                    input_path,
+                ],
+                stdout=subprocess.DEVNULL,
+                stderr=err,
+            )
+            # wait4 reports the resource usage of this process alone
+            _, status, usage = os.wait4(proc.pid, 0)
+            wall_time = time.perf_counter() - start
+            if os.WIFEXITED(status):
+                proc.returncode = os.WEXITSTATUS(status)
+            else:
+                proc.returncode = -os.WTERMSIG(status)
+        with open(stderr_path) as err:
+            stderr = err.read()
+    statistics = {name: int(value) for value, name in STATISTIC.findall(stderr)}
+    return {
+        "status": "ok" if proc.returncode == 0 else "error",
+        "wall_time_s": wall_time,
+        # kilobytes on Linux
+        "peak_rss_kb": usage.ru_maxrss,
+        "statistics": statistics,
+        "error": "" if proc.returncode == 0 else stderr.strip()[-2000:],
+    }
+
+
+def benchmark(args):
+    results = []
+    for router in args.passes:
+        pass_arg = PASSES[router]
+        if router == "pathfinder" and args.pathfinder_options:
+            pass_arg += "=" + args.pathfinder_options
+        for device in args.devices:
+            for pattern in PATTERNS[router]:
+                for count in args.flows:
+                    design, flows = synthesize(
+                        router, device, pattern, count, args.seed
+                    )
+                    runs = [
+                        run_pass(args.aie_opt, pass_arg, design)
+                        for _ in range(args.repeat)
+                    ]
+                    # the fastest run is the least disturbed by the machine
+                    result = min(runs, key=lambda r: r["wall_time_s"])
+                    result["peak_rss_kb"] = max(r["peak_rss_kb"] for r in runs)
+                    stats = result["statistics"]
+                    result = {
+                        "pass": PASSES[router],
+                        "device": device,
+                        "pattern": pattern,
+                        "requested_flows": count,
+                        "flows": flows,
+                        "iterations": stats.get("iterations"),
+                        "dijkstra_calls": stats.get("dijkstra-calls"),
+                        **result,
+                    }
+                    results.append(result)
+                    print(
+                        "%-28s %-9s %-10s %5d flows: %-5s %8.3fs %8d KB"
+                        % (
+                            result["pass"],
+                            device,
+                            pattern,
+                            flows,
+                            result["status"],
+                            result["wall_time_s"],
+                            result["peak_rss_kb"],
+                        ),
+                        file=sys.stderr,
+                    )
+    return results
+
+
+def key(result):
+    return (result["pass"], result["device"], result["pattern"], result["flows"])
+
+
+def compare(results, baseline, tolerance, min_time):
+    old = {key(r): r for r in baseline["results"]}
+    regressions = []
+    for new in results:
+        base = old.get(key(new))
+        if base is None:
+            continue
+        name = "%s %s %s %d flows" % key(new)
+        if base["status"] == "ok" and new["status"] != "ok":
+            regressions.append("%s: no longer routes" % name)
+            continue
+        limit = max(
+            base["wall_time_s"] * (1 + tolerance), base["wall_time_s"] + min_time
+        )
+        if new["wall_time_s"] > limit:
+            regressions.append(
+                "%s: wall time %.3fs -> %.3fs"
+                % (name, base["wall_time_s"], new["wall_time_s"])
+            )
+        for counter in ["iterations", "dijkstra_calls"]:
+            if base.get(counter) is not None and new.get(counter) is not None:
+                if new[counter] > base[counter]:
+                    regressions.append(
+                        "%s: %s %d -> %d" % (name, counter, base[counter], new[counter])
+                    )
+    return regressions
+
+
+def comma_list(choices=None, type=str):
+    def parse(text):
+        values = [type(v) for v in text.split(",") if v]
+        for v in values:
+            if choices is not None and v not in choices:
+                raise argparse.ArgumentTypeError(
+                    "invalid choice: %s (choose from %s)" % (v, ", ".join(choices))
+                )
+        return values
+
+    return parse
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("--aie-opt", default="aie-opt", help="aie-opt to benchmark")
+    parser.add_argument(
+        "--passes",
+        type=comma_list(PASSES),
+        default=list(PASSES),
+        help="comma separated routers to run (%s)" % ", ".join(PASSES),
+    )
+    parser.add_argument(
+        "--devices",
+        type=comma_list(DEVICES),
+        default=list(DEVICES),
+        help="comma separated devices to synthesize designs for",
+    )
+    parser.add_argument(
+        "--flows",
+        type=comma_list(type=int),
+        default=[16, 64, 256],
+        help="comma separated flow counts; capped by the ports of the device",
+    )
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument(
+        "--repeat", type=int, default=1, help="runs per benchmark, the fastest is kept"
+    )
+    parser.add_argument(
+        "--pathfinder-options",
+        default="",
+        help="options for aie-create-pathfinder-flows, e.g. incremental=true",
+    )
+    parser.add_argument(
+        "-o", "--output", default="-", help="JSON report, stdout by default"
+    )
+    parser.add_argument("--baseline", help="JSON report to check for regressions")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=0.25,
+        help="allowed relative wall time increase over the baseline",
+    )
+    parser.add_argument(
+        "--min-time",
+        type=float,
+        default=0.05,
+        help="wall time increase in seconds below which timing is noise",
+    )
+    args = parser.parse_args()
+
+    results = benchmark(args)
+    report = json.dumps(
+        {"aie_opt": args.aie_opt, "seed": args.seed, "results": results}, indent=2
+    )
+    if args.output == "-":
+        print(report)
+    else:
+        with open(args.output, "w") as f:
+            f.write(report + "\n")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.tolerance, args.min_time)
+        for r in regressions:
+            print("regression: " + r, file=sys.stderr)
+        if regressions:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()